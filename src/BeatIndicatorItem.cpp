@@ -11,16 +11,50 @@ BeatIndicatorItem::BeatIndicatorItem(QQuickItem* parent)
     setAntialiasing(true);
 }
 
-int BeatIndicatorItem::lcmHelper(int a, int b)
+const BeatIndicatorItem::GridLayout& BeatIndicatorItem::gridLayout(int w, int h)
 {
-    if (a == 0 || b == 0) return 0;
-    int x = a, y = b;
-    while (y != 0) {
-        int t = y;
-        y = x % y;
-        x = t;
+    GridLayout& g = m_grid;
+    if (g.main == m_polyMain && g.poly == m_polySub && g.size == QSize(w, h))
+        return g;
+
+    g.main = m_polyMain;
+    g.poly = m_polySub;
+    g.size = QSize(w, h);
+    g.hits = polyrhythmHits(m_polyMain, m_polySub);
+    g.lines.clear();
+
+    const int columns = std::max(polyrhythmColumns(m_polyMain, m_polySub), 1);
+    const qreal maxCellSize  = 32;
+    const qreal minRowHeight = 12;   // keeps very wide grids readable
+    const qreal minLinedCell = 4;    // narrower columns are drawn without borders
+    const int   rows = 2;
+
+    // Square whole-pixel cells while they fit; past one pixel per column the
+    // columns go fractional and the rows keep a usable height.
+    qreal cell = std::min({maxCellSize, qreal(w) / columns, qreal(h) / rows});
+    if (cell >= 1) cell = std::floor(cell);
+    g.cellW = cell;
+    g.cellH = std::max(cell, std::min(minRowHeight, qreal(h) / rows));
+
+    const qreal gridW = g.cellW * columns;
+    const qreal gridH = g.cellH * rows;
+    g.frame = QRectF(std::floor((w - gridW) / 2), std::floor((h - gridH) / 2), gridW, gridH);
+
+    if (g.cellW >= minLinedCell) {
+        g.lines.reserve(columns + 1 + rows + 1);
+        for (int col = 0; col <= columns; ++col) {
+            const qreal x = g.frame.left() + col * g.cellW;
+            g.lines.append(QLineF(x, g.frame.top(), x, g.frame.bottom()));
+        }
+    } else {
+        g.lines.append(QLineF(g.frame.topLeft(), g.frame.bottomLeft()));
+        g.lines.append(QLineF(g.frame.topRight(), g.frame.bottomRight()));
+    }
+    for (int row = 0; row <= rows; ++row) {
+        const qreal y = g.frame.top() + row * g.cellH;
+        g.lines.append(QLineF(g.frame.left(), y, g.frame.right(), y));
     }
-    return (a / x) * b;
+    return g;
 }
 
 void BeatIndicatorItem::setBeats(int v)        { if (m_beats != v)        { m_beats = qMax(1,v);         emit beatsChanged();         update(); } }
@@ -47,56 +81,31 @@ void BeatIndicatorItem::paint(QPainter* p)
     if (m_mode == 1 && m_polyMain > 0 && m_polySub > 0) {
         p->setRenderHint(QPainter::Antialiasing, false);
 
-        int columns = lcmHelper(m_polyMain, m_polySub);
-        if (columns == 0) columns = std::max(m_polyMain, m_polySub);
-
-        const int maxCellSize = 32;
-        const int rows = 2;
-
-        int cellSize = std::min({maxCellSize, w / std::max(columns, 1), h / rows});
-
-        int gridW = cellSize * columns;
-        int gridH = cellSize * rows;
-        int x0 = (w - gridW) / 2;
-        int y0 = (h - gridH) / 2;
-
-        std::vector<bool> mainHits(columns, false);
-        std::vector<bool> polyHits(columns, false);
-        for (int i = 0; i < m_polyMain; ++i)
-            mainHits[(i * columns) / m_polyMain] = true;
-        for (int i = 0; i < m_polySub; ++i)
-            polyHits[(i * columns) / m_polySub] = true;
-
-        for (int col = 0; col < columns; ++col) {
-            for (int row = 0; row < rows; ++row) {
-                int x = x0 + col * cellSize;
-                int y = y0 + row * cellSize;
-                QRect cell(x, y, cellSize, cellSize);
-
-                bool isMain    = (row == 1) && mainHits[col];
-                bool isPoly    = (row == 0) && polyHits[col];
-                bool isCoincide = mainHits[col] && polyHits[col];
-
-                QColor color(100, 100, 100);
-                if (isCoincide)
-                    color = m_accentColor.lighter(120);
-                else if (isMain)
-                    color = m_accentColor.darker(200);
-                else if (isPoly)
-                    color = m_accentColor.darker(120);
-
-                if (col == m_gridHighlight && (isMain || isPoly))
-                    color = Qt::white;
-
-                p->fillRect(cell, color);
-            }
+        const GridLayout& g = gridLayout(w, h);
+
+        // Empty cells are one fill; only the main + poly - gcd hit columns are
+        // drawn individually, poly on the top row and main below it.
+        p->fillRect(g.frame, QColor(100, 100, 100));
+
+        const QColor white(Qt::white);
+        const QColor coincide  = m_accentColor.lighter(120);
+        const QColor mainColor = m_accentColor.darker(200);
+        const QColor polyColor = m_accentColor.darker(120);
+        const qreal  cellW = std::max<qreal>(g.cellW, 1);
+        for (const PolyrhythmHit& hit : g.hits) {
+            const qreal x = g.frame.left() + hit.column * g.cellW;
+            const bool highlighted = (hit.column == m_gridHighlight);
+            const bool both = hit.isMain && hit.isPoly;
+            if (hit.isPoly)
+                p->fillRect(QRectF(x, g.frame.top(), cellW, g.cellH),
+                            highlighted ? white : both ? coincide : polyColor);
+            if (hit.isMain)
+                p->fillRect(QRectF(x, g.frame.top() + g.cellH, cellW, g.cellH),
+                            highlighted ? white : both ? coincide : mainColor);
         }
 
         p->setPen(QPen(QColor(0, 0, 0), 1));
-        for (int col = 0; col <= columns; ++col)
-            p->drawLine(x0 + col * cellSize, y0, x0 + col * cellSize, y0 + gridH);
-        for (int row = 0; row <= rows; ++row)
-            p->drawLine(x0, y0 + row * cellSize, x0 + gridW, y0 + row * cellSize);
+        p->drawLines(g.lines);
         return;
     }
 
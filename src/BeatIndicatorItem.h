@@ -2,6 +2,12 @@
 
 #include <QQuickPaintedItem>
 #include <QColor>
+#include <QLineF>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include <vector>
+#include "subdivisionpattern.h"
 
 class BeatIndicatorItem : public QQuickPaintedItem {
     Q_OBJECT
@@ -75,5 +81,19 @@ private:
     int m_polySub = 2;
     int m_gridHighlight = -1;
 
-    static int lcmHelper(int a, int b);
+    // Polyrhythm grid geometry, rebuilt only when the ratio or the item size
+    // changes; highlight moves just repaint from it.
+    struct GridLayout {
+        int    main = 0;
+        int    poly = 0;
+        QSize  size;
+        QRectF frame;                       // both rows
+        qreal  cellW = 0;
+        qreal  cellH = 0;
+        std::vector<PolyrhythmHit> hits;    // column order
+        QVector<QLineF> lines;              // row and column borders
+    };
+    GridLayout m_grid;
+
+    const GridLayout& gridLayout(int w, int h);
 };
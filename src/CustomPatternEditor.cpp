@@ -404,7 +404,7 @@ void CustomPatternEditor::startPreview() {
     double totalBeats = 0.0;
     for (const auto& p : m_pattern.pulses)
         totalBeats += noteValueBeatFraction(p.noteValue, m_compound);
-    int    bpm  = m_engine->currentTempo();
+    double bpm  = m_engine->currentTempo();
     if (bpm <= 0) bpm = 120;
     double barMs = totalBeats * 60000.0 / bpm;
 
@@ -4,15 +4,21 @@
 #include "noteassembler.h"
 #include "CustomPatternEditor.h"
 #include "updatechecker.h"
+#include "offlinerenderer.h"
+#include "soundsets.h"
 #include <QCoreApplication>
 #include <QStandardPaths>
 #include <QDir>
+#include <QThread>
+#include <QUrl>
 #include <QSettings>
 #include <QFile>
 #include <QDateTime>
 #include <QMessageBox>
 #include <QVariantMap>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <numeric>
 
 // ─────────────────────────────────────────────────────────────────────────────
@@ -140,6 +146,12 @@ static const struct {
     {"Speeeeed!",   209, 300},
 };
 
+// Whole tempos print without a fraction, others to at most 2 places.
+/*static*/ QString MetronomeController::formatTempo(double bpm)
+{
+    return QString::number(std::round(bpm * 100.0) / 100.0, 'g', 6);
+}
+
 /*static*/ QString MetronomeController::getTempoMarkings(int bpm)
 {
     QStringList names;
@@ -149,24 +161,6 @@ static const struct {
     return names.join(" / ");
 }
 
-static int sectionBeatCount(const MetronomeSection& s)
-{
-    if (s.denominator == 8 && s.numerator % 3 == 0 && s.numerator > 3)
-        return qMax(1, s.numerator / 3);
-    return qMax(1, s.numerator);
-}
-
-static Polyrhythm enginePolyrhythmForSection(const MetronomeSection& s)
-{
-    Polyrhythm p = s.polyrhythm;
-    if (s.polyrhythmPerBeat) {
-        const int beats = sectionBeatCount(s);
-        p.primaryBeats *= beats;
-        p.secondaryBeats *= beats;
-    }
-    return p;
-}
-
 // ─────────────────────────────────────────────────────────────────────────────
 // Construction / destruction
 // ─────────────────────────────────────────────────────────────────────────────
@@ -187,6 +181,21 @@ MetronomeController::MetronomeController(QObject* parent)
     m_obsPulseTimer->setInterval(80);
     connect(m_obsPulseTimer, &QTimer::timeout, this, &MetronomeController::onObsPulseReset);
 
+    // Engine stats poll (only while the performance overlay is shown)
+    m_engineStatsTimer = new QTimer(this);
+    m_engineStatsTimer->setInterval(250);
+    connect(m_engineStatsTimer, &QTimer::timeout, this, &MetronomeController::onEngineStatsTick);
+
+    // Timing feedback poll (only while input analysis is on)
+    m_timingTimer = new QTimer(this);
+    m_timingTimer->setInterval(250);
+    connect(m_timingTimer, &QTimer::timeout, this, &MetronomeController::onTimingTick);
+
+    // Tempo detection poll (only while listening)
+    m_tempoListenTimer = new QTimer(this);
+    m_tempoListenTimer->setInterval(100);
+    connect(m_tempoListenTimer, &QTimer::timeout, this, &MetronomeController::onTempoListenTick);
+
     // Tap-tempo resume timer
     m_tapTempoResumeTimer = new QTimer(this);
     m_tapTempoResumeTimer->setSingleShot(true);
@@ -204,8 +213,20 @@ MetronomeController::MetronomeController(QObject* parent)
             this, &MetronomeController::onMetronomePulse);
     connect(&metronome, &MetronomeEngine::tempoSteppedUp,
             this, &MetronomeController::onTempoSteppedUp);
+    connect(&metronome, &MetronomeEngine::trackPulse, this, [this](AudioPulseEvent ev) {
+        if (ev.isBeat) emit trackPulse(ev.track, ev.accent);
+    });
+    connect(metronome.audioEngine(), &AudioEngine::outputInfoChanged,
+            this, &MetronomeController::outputInfoChanged);
+    connect(metronome.audioEngine(), &AudioEngine::outputInfoChanged,
+            this, &MetronomeController::applyOutputRouting);
+    // Remember the device so the next launch opens it without probing.
+    connect(metronome.audioEngine(), &AudioEngine::deviceProfileChanged,
+            this, &MetronomeController::saveSettings);
 
     loadSettings();
+    if (m_perfHudVisible)
+        m_engineStatsTimer->start();
 
     // Load presets and select first (or create default)
     m_presetManager.loadFromDisk(presetFilePath());
@@ -280,6 +301,11 @@ MetronomeController::MetronomeController(QObject* parent)
 MetronomeController::~MetronomeController()
 {
     metronome.stop();
+    if (m_renderThread) {
+        m_renderCancel.store(true);
+        m_renderThread->wait();
+        delete m_renderThread;
+    }
 }
 
 // ─────────────────────────────────────────────────────────────────────────────
@@ -290,7 +316,7 @@ QString MetronomeController::settingsPath() const
     return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/settings.ini";
 }
 
-QString MetronomeController::presetFilePath() const
+QString MetronomeController::presetFilePath()
 {
     return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/presets.json";
 }
@@ -298,12 +324,31 @@ QString MetronomeController::presetFilePath() const
 // ─────────────────────────────────────────────────────────────────────────────
 // Settings
 // ─────────────────────────────────────────────────────────────────────────────
+// Settings keys of the output routes, in AudioEngine::RouteClass order.
+static const char* const kRouteKeys[] = { "accent", "click", "polyAccent", "countIn" };
+
+// A route destination is "all", a 1-based channel "n" or a pan pair "l+r";
+// anything else falls back to every channel.
+static QString validRouteDest(const QString& dest)
+{
+    auto channelOk = [](const QString& n) {
+        bool ok = false;
+        const int ch = n.toInt(&ok);
+        return ok && ch >= 1 && ch <= VoicePool::kMaxChannels;
+    };
+    const QStringList parts = dest.split('+');
+    if (parts.size() == 1 && channelOk(parts[0])) return dest;
+    if (parts.size() == 2 && channelOk(parts[0]) && channelOk(parts[1]) && parts[0] != parts[1]) return dest;
+    return QStringLiteral("all");
+}
+
 void MetronomeController::loadSettings()
 {
     QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
     QSettings s(settingsPath(), QSettings::IniFormat);
     m_accentColor = QColor(s.value("accentColor", "#960000").toString());
     m_soundSet    = s.value("soundSet", "Default").toString();
+    m_polySoundSet = s.value("polySoundSet").toString();
     m_obsHidden   = s.value("obsHidden", true).toBool();
     m_alwaysOnTop = s.value("alwaysOnTop", false).toBool();
     m_beatWindowAuto = s.value("beatWindowAuto", false).toBool();
@@ -312,6 +357,31 @@ void MetronomeController::loadSettings()
     if (m_beatWindowPolyrhythmStyle != 0 && m_beatWindowPolyrhythmStyle != 5)
         m_beatWindowPolyrhythmStyle = 5;
     m_volume      = s.value("volume", 90).toInt();
+    m_perfHudVisible = s.value("perfHudVisible", false).toBool();
+    m_lowLatencyMode = s.value("lowLatencyMode", false).toBool();
+    m_outputPeriodFrames = qBound(0, s.value("outputPeriodFrames", 0).toInt(), 4096);
+    m_outputChannels     = qBound(0, s.value("outputChannels", 0).toInt(), 32);
+    applyOutputMode();
+    for (int i = 0; i < kOutputRoutes; ++i) {
+        const QString key = QStringLiteral("outputRoute/") + QLatin1String(kRouteKeys[i]);
+        m_outputRoutes[i].dest = validRouteDest(s.value(key, "all").toString());
+        m_outputRoutes[i].pan  = qBound(-1.0, s.value(key + "Pan", 0.0).toDouble(), 1.0);
+    }
+    applyOutputRouting();
+    m_uiLatencyOffsetMs = qBound(-kMaxUiLatencyOffsetMs, s.value("uiLatencyOffsetMs", 0).toInt(), kMaxUiLatencyOffsetMs);
+    metronome.audioEngine()->setUiLatencyOffsetMs(m_uiLatencyOffsetMs);
+    m_maxVoices = qBound(1, s.value("maxVoices", VoicePool::kDefaultPolyphony).toInt(), VoicePool::kMaxPolyphony);
+    metronome.audioEngine()->setMaxVoices(m_maxVoices);
+    m_inputLatencyOffsetMs = qBound(-kMaxInputLatencyOffsetMs, s.value("inputLatencyOffsetMs", 0).toInt(),
+                                    kMaxInputLatencyOffsetMs);
+    metronome.audioEngine()->inputAnalyzer().setCalibrationMs(m_inputLatencyOffsetMs);
+    m_tempoListenAutoStart = s.value("tempoListenAutoStart", false).toBool();
+    // Before the samples load, so they are decoded at the device's rate.
+    AudioEngine::DeviceProfile profile;
+    profile.backend    = s.value("deviceBackend").toString();
+    profile.deviceName = s.value("deviceName").toString();
+    profile.sampleRate = s.value("deviceSampleRate", 0).toInt();
+    metronome.audioEngine()->setDeviceProfile(profile);
     m_terminology = s.value("terminology", "Piece").toString();
     if (m_terminology != "Piece" && m_terminology != "Song" && m_terminology != "Preset")
         m_terminology = "Piece";
@@ -320,7 +390,17 @@ void MetronomeController::loadSettings()
     metronome.loadSample("click",  soundFileForSet(m_soundSet, false));
     metronome.setAccentSound("accent");
     metronome.setClickSound("click");
+    applyPolySound();
     metronome.setVolume(m_volume / 100.0f);
+
+    // Only the selected set loads up front; the rest decode in the background
+    // so switching sets in applySettings() is a cache hit.
+    QStringList otherSets;
+    for (const SoundSet& set : kSoundSets) {
+        if (m_soundSet == QLatin1String(set.name)) continue;
+        otherSets << QString::fromLatin1(set.accent) << QString::fromLatin1(set.click);
+    }
+    metronome.audioEngine()->prefetchSamples(otherSets);
 }
 
 void MetronomeController::saveSettings()
@@ -328,12 +408,30 @@ void MetronomeController::saveSettings()
     QSettings s(settingsPath(), QSettings::IniFormat);
     s.setValue("accentColor", m_accentColor.name());
     s.setValue("soundSet",    m_soundSet);
+    s.setValue("polySoundSet", m_polySoundSet);
     s.setValue("obsHidden",   m_obsHidden);
     s.setValue("alwaysOnTop", m_alwaysOnTop);
     s.setValue("beatWindowAuto", m_beatWindowAuto);
     s.setValue("beatWindowSubdivisionStyle", m_beatWindowSubdivisionStyle);
     s.setValue("beatWindowPolyrhythmStyle", m_beatWindowPolyrhythmStyle);
     s.setValue("volume",      m_volume);
+    s.setValue("perfHudVisible", m_perfHudVisible);
+    s.setValue("lowLatencyMode", m_lowLatencyMode);
+    s.setValue("outputPeriodFrames", m_outputPeriodFrames);
+    s.setValue("outputChannels", m_outputChannels);
+    for (int i = 0; i < kOutputRoutes; ++i) {
+        const QString key = QStringLiteral("outputRoute/") + QLatin1String(kRouteKeys[i]);
+        s.setValue(key, m_outputRoutes[i].dest);
+        s.setValue(key + "Pan", m_outputRoutes[i].pan);
+    }
+    s.setValue("uiLatencyOffsetMs", m_uiLatencyOffsetMs);
+    s.setValue("maxVoices", m_maxVoices);
+    s.setValue("inputLatencyOffsetMs", m_inputLatencyOffsetMs);
+    s.setValue("tempoListenAutoStart", m_tempoListenAutoStart);
+    const AudioEngine::DeviceProfile profile = metronome.audioEngine()->deviceProfile();
+    s.setValue("deviceBackend", profile.backend);
+    s.setValue("deviceName", profile.deviceName);
+    s.setValue("deviceSampleRate", profile.sampleRate);
     s.setValue("terminology", m_terminology);
     s.sync();
 }
@@ -349,22 +447,24 @@ SubdivisionPattern MetronomeController::getDefaultSubdivisionPattern() const
     return p;
 }
 
-QString MetronomeController::soundFileForSet(const QString& set, bool accent) const
+QString MetronomeController::soundFileForSet(const QString& set, bool accent)
+{
+    // Names older settings files may still hold
+    const QString name = set == "Woodblock" ? QStringLiteral("Wooden")
+                       : set == "Woodblock 2" ? QStringLiteral("Wooden 3") : set;
+    for (const SoundSet& s : kSoundSets) {
+        if (name == QLatin1String(s.name))
+            return QString::fromLatin1(accent ? s.accent : s.click);
+    }
+    return QString::fromLatin1(accent ? kSoundSets[0].accent : kSoundSets[0].click);
+}
+
+QStringList MetronomeController::soundSets() const
 {
-    if (set == "Default")   return accent ? ":/resources/accent.wav"          : ":/resources/click.wav";
-    if (set == "Wooden" || set == "Woodblock")
-        return accent ? ":/resources/woodblock_accent.wav" : ":/resources/woodblock.wav";
-    if (set == "Wooden 2")
-        return accent ? ":/resources/wooden_accent.wav" : ":/resources/wooden.wav";
-    if (set == "Wooden 3" || set == "Woodblock 2")
-        return accent ? ":/resources/wooden2_accent.wav" : ":/resources/wooden2.wav";
-    if (set == "Bongo")     return accent ? ":/resources/bongo_accent.wav"     : ":/resources/bongo.wav";
-    if (set == "Cowbell")   return accent ? ":/resources/cowbell_accent.wav"   : ":/resources/cowbell.wav";
-    if (set == "Digital")   return accent ? ":/resources/digital_accent.wav"   : ":/resources/digital.wav";
-    if (set == "Drum")      return accent ? ":/resources/drum_accent.wav"      : ":/resources/drum.wav";
-    if (set == "Hihat")     return accent ? ":/resources/hihat_accent.wav"     : ":/resources/hihat.wav";
-    if (set == "Metal")     return accent ? ":/resources/metal_accent.wav"     : ":/resources/metal.wav";
-    return accent ? ":/resources/accent.wav" : ":/resources/click.wav";
+    QStringList names;
+    for (const SoundSet& s : kSoundSets)
+        names << QString::fromLatin1(s.name);
+    return names;
 }
 
 void MetronomeController::updateStartStopLabel(const QString& label)
@@ -408,6 +508,257 @@ void MetronomeController::onObsPulseReset()
     emit obsPulseChanged();
 }
 
+void MetronomeController::onEngineStatsTick()
+{
+    AudioEngine* audio = metronome.audioEngine();
+    if (!audio) return;
+    m_engineStats     = audio->stats();
+    m_engineUnderruns = audio->producerUnderruns();
+    emit engineStatsChanged();
+}
+
+void MetronomeController::setPerfHudVisible(bool visible)
+{
+    if (m_perfHudVisible == visible) return;
+    m_perfHudVisible = visible;
+    if (visible) {
+        onEngineStatsTick();
+        m_engineStatsTimer->start();
+    } else {
+        m_engineStatsTimer->stop();
+    }
+    saveSettings();
+    emit perfHudVisibleChanged();
+}
+
+void MetronomeController::resetEngineStats()
+{
+    if (AudioEngine* audio = metronome.audioEngine())
+        audio->resetStats();
+    onEngineStatsTick();
+}
+
+void MetronomeController::setOutputMode(bool lowLatency, int periodFrames, int channels)
+{
+    periodFrames = qBound(0, periodFrames, 4096);
+    channels     = qBound(0, channels, 32);
+    if (lowLatency == m_lowLatencyMode && periodFrames == m_outputPeriodFrames &&
+        channels == m_outputChannels)
+        return;
+    m_lowLatencyMode     = lowLatency;
+    m_outputPeriodFrames = periodFrames;
+    m_outputChannels     = channels;
+    applyOutputMode();
+    saveSettings();
+    emit outputModeChanged();
+}
+
+void MetronomeController::setUiLatencyOffsetMs(int ms)
+{
+    ms = qBound(-kMaxUiLatencyOffsetMs, ms, kMaxUiLatencyOffsetMs);
+    if (ms == m_uiLatencyOffsetMs) return;
+    m_uiLatencyOffsetMs = ms;
+    metronome.audioEngine()->setUiLatencyOffsetMs(ms);
+    saveSettings();
+    emit uiLatencyOffsetChanged();
+}
+
+void MetronomeController::setMaxVoices(int voices)
+{
+    voices = qBound(1, voices, VoicePool::kMaxPolyphony);
+    if (voices == m_maxVoices) return;
+    m_maxVoices = voices;
+    metronome.audioEngine()->setMaxVoices(voices);
+    saveSettings();
+    emit maxVoicesChanged();
+}
+
+void MetronomeController::setPolySoundSet(const QString& set)
+{
+    const QString s = soundSets().contains(set) ? set : QString();
+    if (s == m_polySoundSet) return;
+    m_polySoundSet = s;
+    applyPolySound();
+    saveSettings();
+    emit polySoundSetChanged();
+}
+
+// Routes the polyrhythm's second layer to its own sound, or back to the accent.
+void MetronomeController::applyPolySound()
+{
+    SoundRouting routing = metronome.soundRouting();
+    routing.polyAccent = -1;
+    if (!m_polySoundSet.isEmpty() &&
+        metronome.loadSample("polyAccent", soundFileForSet(m_polySoundSet, true)))
+        routing.polyAccent = metronome.audioEngine()->soundId("polyAccent");
+    metronome.setSoundRouting(routing);
+}
+
+void MetronomeController::applyOutputMode()
+{
+    AudioEngine::OutputConfig config;
+    config.lowLatency   = m_lowLatencyMode;
+    config.periodFrames = m_outputPeriodFrames;
+    config.channels     = m_outputChannels;
+    config.captureInput = m_inputAnalysisEnabled || m_tempoListening;
+    metronome.audioEngine()->setOutputConfig(config);
+}
+
+void MetronomeController::setOutputRoute(int route, const QString& dest, double pan)
+{
+    if (route < 0 || route >= kOutputRoutes) return;
+    OutputRoute& r = m_outputRoutes[route];
+    const QString d = validRouteDest(dest);
+    pan = qBound(-1.0, pan, 1.0);
+    if (d == r.dest && pan == r.pan) return;
+    r.dest = d;
+    r.pan  = pan;
+    applyOutputRouting();
+    saveSettings();
+    emit outputRoutingChanged();
+}
+
+void MetronomeController::applyOutputRouting()
+{
+    using Routing = AudioEngine::OutputRouting;
+    // A route to a channel the open device lacks plays everywhere instead of
+    // going silent; this runs again whenever the device is reopened.
+    const int channels = outputDeviceChannels();
+    auto gainsFor = [channels](const QString& dest, double pan, Routing::Gains& gains) {
+        const QStringList parts = dest.split('+');
+        int highest = 0;
+        for (const QString& p : parts) highest = qMax(highest, p.toInt());
+        if (channels > 0 && highest > channels)
+            return false;
+        if (parts.size() == 2)
+            gains = Routing::pan(float(pan), parts[0].toInt() - 1, parts[1].toInt() - 1);
+        else if (dest != QLatin1String("all"))
+            gains = Routing::only(dest.toInt() - 1);
+        else
+            return false;
+        return true;
+    };
+    Routing routing;
+    for (int i = 0; i < kOutputRoutes; ++i)
+        gainsFor(m_outputRoutes[i].dest, m_outputRoutes[i].pan, routing.classes[i]);
+    // A routed polymeter track plays all its pulses there; the others follow
+    // the event-class rows above.
+    if (m_currentSectionIdx >= 0 &&
+        m_currentSectionIdx < static_cast<int>(m_currentPreset.sections.size())) {
+        const auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+        for (int t = 0; t < int(tracks.size()); ++t) {
+            Routing::Gains gains;
+            if (gainsFor(tracks[t].dest, tracks[t].pan, gains))
+                routing.setTrack(t + 1, gains);
+        }
+    }
+    metronome.audioEngine()->setOutputRouting(routing);
+}
+
+QVariantList MetronomeController::outputRoutes() const
+{
+    static const char* const names[kOutputRoutes] = { "Accent", "Click", "Poly accent", "Count-in" };
+    QVariantList list;
+    for (int i = 0; i < kOutputRoutes; ++i) {
+        QVariantMap m;
+        m["name"] = QString::fromLatin1(names[i]);
+        m["dest"] = m_outputRoutes[i].dest;
+        m["pan"]  = m_outputRoutes[i].pan;
+        list.append(m);
+    }
+    return list;
+}
+
+int MetronomeController::outputDeviceChannels() const
+{
+    return qMin(metronome.audioEngine()->outputInfo().channels, VoicePool::kMaxChannels);
+}
+
+void MetronomeController::setInputAnalysisEnabled(bool enabled)
+{
+    if (enabled == m_inputAnalysisEnabled) return;
+    m_inputAnalysisEnabled = enabled;
+    // The analyzer's worker starts and stops with playback.
+    metronome.audioEngine()->inputAnalyzer().setEnabled(enabled);
+    applyOutputMode();
+    if (enabled) {
+        onTimingTick();
+        m_timingTimer->start();
+    } else {
+        m_timingTimer->stop();
+    }
+    emit inputAnalysisEnabledChanged();
+}
+
+void MetronomeController::setInputLatencyOffsetMs(int ms)
+{
+    ms = qBound(-kMaxInputLatencyOffsetMs, ms, kMaxInputLatencyOffsetMs);
+    if (ms == m_inputLatencyOffsetMs) return;
+    m_inputLatencyOffsetMs = ms;
+    metronome.audioEngine()->inputAnalyzer().setCalibrationMs(ms);
+    saveSettings();
+    emit inputLatencyOffsetChanged();
+}
+
+bool MetronomeController::inputCapturing() const
+{
+    return metronome.audioEngine()->outputInfo().capturing;
+}
+
+void MetronomeController::onTimingTick()
+{
+    m_timing = metronome.audioEngine()->inputAnalyzer().report();
+    emit timingStatsChanged();
+}
+
+void MetronomeController::resetTimingStats()
+{
+    metronome.audioEngine()->inputAnalyzer().resetStatistics();
+    m_timing = TimingReport();
+    emit timingStatsChanged();
+}
+
+void MetronomeController::setTempoListenAutoStart(bool on)
+{
+    if (on == m_tempoListenAutoStart) return;
+    m_tempoListenAutoStart = on;
+    saveSettings();
+    emit tempoListenAutoStartChanged();
+}
+
+QVariantList MetronomeController::timingStats() const
+{
+    QVariantList list;
+    for (const TimingReport::Pulse& s : m_timing.pulses) {
+        QVariantMap m;
+        m["idx"]    = s.idx;
+        m["beat"]   = s.beat;
+        m["isBeat"] = s.isBeat;
+        m["count"]  = s.count;
+        m["meanMs"] = s.meanMs;
+        m["sdMs"]   = s.sdMs;
+        list.append(m);
+    }
+    return list;
+}
+
+double MetronomeController::outputLatencyMs() const
+{
+    return metronome.audioEngine()->outputInfo().latencyMs;
+}
+
+// e.g. "wasapi, s16, 2 ch, 48000 Hz, 3 x 128 frames"; empty until the device opens
+QString MetronomeController::outputDeviceInfo() const
+{
+    const AudioEngine::OutputInfo info = metronome.audioEngine()->outputInfo();
+    if (info.backend.isEmpty())
+        return QString();
+    return QStringLiteral("%1, %2, %3 ch, %4 Hz, %5 x %6 frames")
+        .arg(info.backend, info.format)
+        .arg(info.channels).arg(info.sampleRate)
+        .arg(info.periods).arg(info.periodFrames);
+}
+
 void MetronomeController::resetSpeedTrainer()
 {
     m_speedTrainerCountingIn    = false;
@@ -462,6 +813,8 @@ void MetronomeController::loadSectionToEngine(int idx)
         Polyrhythm enginePoly = enginePolyrhythmForSection(s);
         metronome.setPolyrhythm(enginePoly.primaryBeats, enginePoly.secondaryBeats);
     }
+    metronome.setTracks(engineTracks(s));
+    applyOutputRouting();
 
     m_playingBarCounter   = 0;
     m_polyrhythmCycleActive = false;
@@ -509,7 +862,7 @@ bool MetronomeController::running() const
 
 QString MetronomeController::tempoMarkings() const
 {
-    return getTempoMarkings(m_tempo);
+    return getTempoMarkings(qRound(m_tempo));
 }
 
 QString MetronomeController::timerRemainingString() const
@@ -673,9 +1026,9 @@ QPixmap MetronomeController::sectionSubdivisionPixmap(int idx, const QSize& size
 // ─────────────────────────────────────────────────────────────────────────────
 // Setters
 // ─────────────────────────────────────────────────────────────────────────────
-void MetronomeController::setTempo(int tempo)
+void MetronomeController::setTempo(double tempo)
 {
-    tempo = qBound(1, tempo, 300);
+    tempo = qBound(1.0, std::round(tempo * 100.0) / 100.0, 300.0);
     if (m_tempo == tempo) return;
     m_tempo = tempo;
 
@@ -758,7 +1111,7 @@ void MetronomeController::startStop()
         if (m_speedEnabled && m_currentSectionIdx >= 0 &&
             m_currentSectionIdx < static_cast<int>(m_currentPreset.sections.size()))
         {
-            int restoreTempo = m_currentPreset.sections[m_currentSectionIdx].tempo;
+            double restoreTempo = m_currentPreset.sections[m_currentSectionIdx].tempo;
             m_speedTrainerStartTempo = restoreTempo; // resetSpeedTrainer() will sync CurrentTempo
             m_tempo = restoreTempo;
             metronome.setTempo(restoreTempo);
@@ -773,6 +1126,10 @@ void MetronomeController::startStop()
     }
 
     // ---- START ----
+    if (m_tempoListening) {
+        stopTempoListening();
+        applyOutputMode();
+    }
     m_lastBarIdx = -1;
     m_speedTrainerTotalBarCounter = 0;
 
@@ -856,6 +1213,79 @@ void MetronomeController::tapTempo()
     m_tapTempoResumeTimer->start(tapResetMs);
 }
 
+void MetronomeController::toggleTempoListening()
+{
+    if (m_tempoListening) {
+        stopTempoListening();
+        applyOutputMode();
+        return;
+    }
+    if (metronome.isRunning() || m_speedTrainerCountingIn)
+        startStop();
+
+    // The device reopens full-duplex for this.
+    AudioEngine* engine = metronome.audioEngine();
+    const bool compound = m_denominator == 8 && m_numerator % 3 == 0 && m_numerator > 3;
+    m_tempoListening = true;
+    applyOutputMode();
+    engine->inputAnalyzer().setBeatsPerBar(compound ? m_numerator / 3 : m_numerator);
+    engine->inputAnalyzer().setTempoDetection(true);
+    if (!engine->startListening()) {   // no input device
+        engine->inputAnalyzer().setTempoDetection(false);
+        m_tempoListening = false;
+        applyOutputMode();
+        return;
+    }
+    m_detectedTempo = TempoEstimate();
+    m_tempoListenTimer->start();
+    emit detectedTempoChanged();
+    emit tempoListeningChanged();
+}
+
+void MetronomeController::stopTempoListening()
+{
+    m_tempoListenTimer->stop();
+    metronome.audioEngine()->stopListening();
+    metronome.audioEngine()->inputAnalyzer().setTempoDetection(false);
+    m_tempoListening = false;
+    emit tempoListeningChanged();
+}
+
+void MetronomeController::onTempoListenTick()
+{
+    AudioEngine* engine = metronome.audioEngine();
+    if (!engine->isListening()) {   // the device was closed under us
+        stopTempoListening();
+        applyOutputMode();
+        return;
+    }
+    const TempoEstimate e = engine->inputAnalyzer().tempo();
+    if (e.bpm != m_detectedTempo.bpm || e.confidence != m_detectedTempo.confidence) {
+        m_detectedTempo = e;
+        emit detectedTempoChanged();
+    }
+    if (!e.stable) return;
+
+    // The device stays open full-duplex until the next stop, so an aligned
+    // start does not wait for it to reopen.
+    stopTempoListening();
+    setTempo(e.bpm);
+    if (m_tempoListenAutoStart && e.downbeatNs != 0) {
+        // The player's next downbeat far enough ahead to restart the device.
+        const int     beats   = engine->inputAnalyzer().beatsPerBar();
+        const int64_t barNs   = int64_t(60e9 * beats / m_tempo);
+        const int64_t nowNs   = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        const int64_t earliest = nowNs + int64_t(kTempoStartLeadMs) * 1000000;
+        int64_t at = e.downbeatNs;
+        if (at < earliest)
+            at += (earliest - at + barNs - 1) / barNs * barNs;
+        engine->setStartAlignment(at);
+        startStop();
+    }
+    applyOutputMode();
+}
+
 // ─────────────────────────────────────────────────────────────────────────────
 // Invokables — time signature
 // ─────────────────────────────────────────────────────────────────────────────
@@ -1045,6 +1475,144 @@ void MetronomeController::setPolyrhythm(int primary, int secondary, bool perBeat
     emit currentSectionChanged();
 }
 
+// ─────────────────────────────────────────────────────────────────────────────
+// Invokables — polymeter tracks
+// ─────────────────────────────────────────────────────────────────────────────
+static bool isCompoundTrack(const SectionTrack& t)
+{
+    return t.denominator == 8 && t.numerator % 3 == 0 && t.numerator > 3;
+}
+
+QVariantList MetronomeController::tracks() const
+{
+    QVariantList list;
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return list;
+    for (const SectionTrack& t : m_currentPreset.sections[m_currentSectionIdx].tracks) {
+        QVariantMap m;
+        m["numerator"]   = t.numerator;
+        m["denominator"] = t.denominator;
+        m["gain"]        = double(t.gain);
+        m["subdivision"] = t.subdivision.name;
+        m["soundSet"]    = t.soundSet;
+        // A track picks from the standard subdivisions of its own meter
+        QStringList subdivisions;
+        for (const SubdivisionPattern& p : pickerStandard(isCompoundTrack(t)))
+            subdivisions << p.name;
+        m["subdivisions"] = subdivisions;
+        m["dest"]        = t.dest;
+        m["pan"]         = double(t.pan);
+        list.append(m);
+    }
+    return list;
+}
+
+void MetronomeController::addTrack(int numerator, int denominator)
+{
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return;
+    auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+    if (int(tracks.size()) >= EngineParams::kMaxTracks) return;
+    tracks.push_back(SectionTrack{});
+    setTrack(int(tracks.size()) - 1, numerator, denominator, 1.0);
+}
+
+void MetronomeController::setTrack(int index, int numerator, int denominator, double gain)
+{
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return;
+    auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+    if (index < 0 || index >= static_cast<int>(tracks.size())) return;
+    SectionTrack& t = tracks[index];
+    const bool wasCompound = isCompoundTrack(t);
+    t.numerator   = qBound(1, numerator, 32);
+    t.denominator = (denominator == 2 || denominator == 8 || denominator == 16) ? denominator : 4;
+    t.gain        = float(qBound(0.0, gain, 1.0));
+    // The standard subdivisions differ between simple and compound time
+    if (isCompoundTrack(t) != wasCompound)
+        t.subdivision = pickerStandard(isCompoundTrack(t)).first();
+    commitSectionTracks();
+}
+
+void MetronomeController::setTrackSubdivision(int index, const QString& name)
+{
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return;
+    auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+    if (index < 0 || index >= static_cast<int>(tracks.size())) return;
+    SectionTrack& t = tracks[index];
+    for (const SubdivisionPattern& p : pickerStandard(isCompoundTrack(t))) {
+        if (p.name == name) {
+            t.subdivision = p;
+            commitSectionTracks();
+            return;
+        }
+    }
+}
+
+// An empty or unknown set plays the track on the main accent and click.
+void MetronomeController::setTrackSoundSet(int index, const QString& set)
+{
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return;
+    auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+    if (index < 0 || index >= static_cast<int>(tracks.size())) return;
+    tracks[index].soundSet = soundSets().contains(set) ? set : QString();
+    commitSectionTracks();
+}
+
+void MetronomeController::setTrackRoute(int index, const QString& dest, double pan)
+{
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return;
+    auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+    if (index < 0 || index >= static_cast<int>(tracks.size())) return;
+    SectionTrack& t = tracks[index];
+    t.dest = validRouteDest(dest);
+    t.pan  = float(qBound(-1.0, pan, 1.0));
+    commitSectionTracks();
+}
+
+void MetronomeController::removeTrack(int index)
+{
+    if (m_currentSectionIdx < 0 ||
+        m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()))
+        return;
+    auto& tracks = m_currentPreset.sections[m_currentSectionIdx].tracks;
+    if (index < 0 || index >= static_cast<int>(tracks.size())) return;
+    tracks.erase(tracks.begin() + index);
+    commitSectionTracks();
+}
+
+// A running metronome picks the tracks up at its next bar line.
+void MetronomeController::commitSectionTracks()
+{
+    const MetronomeSection& s = m_currentPreset.sections[m_currentSectionIdx];
+    metronome.setTracks(engineTracks(s));
+    applyOutputRouting();
+    m_presetManager.savePreset(m_currentPreset);
+    m_presetManager.saveToDisk(presetFilePath());
+    emit currentSectionChanged();
+}
+
+// The section's tracks with their sound sets loaded into the live bank.
+std::vector<TrackParams> MetronomeController::engineTracks(const MetronomeSection& s)
+{
+    return engineTracksForSection(s, [this](const QString& file) {
+        if (!m_trackSounds.contains(file)) {
+            if (!metronome.loadSample(file, file)) return -1;
+            m_trackSounds.insert(file, metronome.audioEngine()->soundId(file));
+        }
+        return m_trackSounds.value(file);
+    });
+}
+
 // ─────────────────────────────────────────────────────────────────────────────
 // Invokables — accents
 // ─────────────────────────────────────────────────────────────────────────────
@@ -1115,7 +1683,7 @@ void MetronomeController::onTimerTick()
         if (m_speedEnabled && m_currentSectionIdx >= 0 &&
             m_currentSectionIdx < static_cast<int>(m_currentPreset.sections.size()))
         {
-            int restoreTempo = m_currentPreset.sections[m_currentSectionIdx].tempo;
+            double restoreTempo = m_currentPreset.sections[m_currentSectionIdx].tempo;
             m_tempo = restoreTempo;
             metronome.setTempo(restoreTempo);
             emit tempoChanged();
@@ -1160,21 +1728,21 @@ void MetronomeController::addSection()
     m_presetManager.saveToDisk(presetFilePath());
 }
 
-void MetronomeController::addSectionRange(int targetTempo, int stepSize)
+void MetronomeController::addSectionRange(double targetTempo, int stepSize)
 {
     if (m_currentSectionIdx < 0 ||
         m_currentSectionIdx >= static_cast<int>(m_currentPreset.sections.size()) ||
         stepSize <= 0) return;
 
     MetronomeSection base = m_currentPreset.sections[m_currentSectionIdx];
-    int startTempo = base.tempo;
+    double startTempo = base.tempo;
     if (targetTempo == startTempo) return;
 
     bool goingUp = (targetTempo > startTempo);
 
     // Build the list of new sections stepping from start toward target
     QVector<MetronomeSection> newSections;
-    int t = startTempo + (goingUp ? stepSize : -stepSize);
+    double t = startTempo + (goingUp ? stepSize : -stepSize);
     int labelBase = static_cast<int>(m_currentPreset.sections.size()) + 1;
     int i = 0;
     while (goingUp ? (t <= targetTempo) : (t >= targetTempo)) {
@@ -1545,7 +2113,7 @@ void MetronomeController::checkForUpdates()
 // ─────────────────────────────────────────────────────────────────────────────
 // Called when the audio thread's speed trainer steps up the tempo.
 // We just update display state here — no audio restarts needed.
-void MetronomeController::onTempoSteppedUp(int newTempo)
+void MetronomeController::onTempoSteppedUp(double newTempo)
 {
     // Tempo update only — bar counter and count-in transitions are handled
     // in onMetronomePulse when ev.newTempo > 0 arrives in sync with audio.
@@ -1688,6 +2256,59 @@ bool MetronomeController::exportPresetsToFile(const QStringList& names, const QS
     return m_presetManager.exportToFile(names, filePath);
 }
 
+void MetronomeController::renderPresetToWav(const QString& presetName, const QString& filePath,
+                                            int sampleRate, int barsPerSection)
+{
+    if (m_renderThread) {
+        emit renderFinished(false, tr("A render is already running"));
+        return;
+    }
+    MetronomePreset preset;
+    if (presetName.isEmpty())
+        preset = m_currentPreset;
+    else if (!m_presetManager.loadPreset(presetName, preset)) {
+        emit renderFinished(false, tr("Unknown preset \"%1\"").arg(presetName));
+        return;
+    }
+
+    // Same sounds, volume, count-in and speed trainer as live playback.
+    OfflineRenderOptions opt;
+    opt.sampleRate     = sampleRate;
+    opt.barsPerSection = qMax(1, barsPerSection);
+    opt.countIn        = m_countInEnabled;
+    opt.speedEnabled   = m_speedEnabled;
+    opt.barsPerStep    = m_speedBarsPerStep;
+    opt.tempoStep      = m_speedTempoStep;
+    opt.maxTempo       = m_speedMaxTempo;
+    opt.accentSound    = soundFileForSet(m_soundSet, true);
+    opt.clickSound     = soundFileForSet(m_soundSet, false);
+    if (!m_polySoundSet.isEmpty())
+        opt.polyAccentSound = soundFileForSet(m_polySoundSet, true);
+    opt.volume         = m_volume / 100.0f;
+    opt.cancel         = &m_renderCancel;
+
+    QUrl url(filePath);
+    const QString path = url.isLocalFile() ? url.toLocalFile() : filePath;
+
+    m_renderCancel.store(false);
+    m_renderThread = QThread::create([this, preset, opt, path] {
+        OfflineRenderResult r = ::renderPresetToWav(preset, opt, path);
+        QString message = r.ok
+            ? tr("Rendered %1 s in %2 s (%3x realtime)")
+                  .arg(r.audioSeconds, 0, 'f', 1)
+                  .arg(r.renderSeconds, 0, 'f', 2)
+                  .arg(r.realtimeMultiple(), 0, 'f', 0)
+            : r.error;
+        QMetaObject::invokeMethod(this, [this, ok = r.ok, message] {
+            m_renderThread->wait();
+            delete m_renderThread;
+            m_renderThread = nullptr;
+            emit renderFinished(ok, message);
+        }, Qt::QueuedConnection);
+    });
+    m_renderThread->start(QThread::LowPriority);
+}
+
 QStringList MetronomeController::presetsInFile(const QString& filePath) const
 {
     return PresetManager::presetsInFile(filePath);
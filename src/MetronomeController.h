@@ -6,6 +6,7 @@
 #include <QDateTime>
 #include <QSettings>
 #include <QVariant>
+#include <QHash>
 #include "metronomeengine.h"
 #include "presetmanager.h"
 #include "subdivisionpattern.h"
@@ -14,6 +15,7 @@
 #include "CustomPatternEditor.h"
 
 class SectionListModel;
+class QThread;
 
 class MetronomeController : public QObject {
     Q_OBJECT
@@ -23,7 +25,8 @@ class MetronomeController : public QObject {
     Q_PROPERTY(QString startStopLabel READ startStopLabel NOTIFY startStopLabelChanged)
 
     // Tempo
-    Q_PROPERTY(int tempo READ tempo WRITE setTempo NOTIFY tempoChanged)
+    Q_PROPERTY(double tempo READ tempo WRITE setTempo NOTIFY tempoChanged)   // BPM to 1/100
+    Q_PROPERTY(QString tempoText READ tempoText NOTIFY tempoChanged)        // "120", "119.5"
     Q_PROPERTY(QString tempoMarkings READ tempoMarkings NOTIFY tempoChanged)
 
     // Time signature
@@ -53,6 +56,9 @@ class MetronomeController : public QObject {
     Q_PROPERTY(int polyPrimaryBeats READ polyPrimaryBeats NOTIFY currentSectionChanged)
     Q_PROPERTY(int polySecondaryBeats READ polySecondaryBeats NOTIFY currentSectionChanged)
     Q_PROPERTY(bool polyrhythmPerBeat READ polyrhythmPerBeat NOTIFY currentSectionChanged)
+
+    // Polymeter tracks of the current section: {numerator, denominator, gain}
+    Q_PROPERTY(QVariantList tracks READ tracks NOTIFY currentSectionChanged)
 
     // Accents
     Q_PROPERTY(QVariantList accents READ accents NOTIFY accentsChanged)
@@ -101,12 +107,63 @@ class MetronomeController : public QObject {
 
     // Persistent settings
     Q_PROPERTY(QString soundSet    READ soundSet    NOTIFY soundSetChanged)
+    Q_PROPERTY(QStringList soundSets READ soundSets CONSTANT)
+    Q_PROPERTY(QString polySoundSet READ polySoundSet WRITE setPolySoundSet NOTIFY polySoundSetChanged)   // "" = the accent
     Q_PROPERTY(bool obsEnabled     READ obsEnabled  NOTIFY obsEnabledChanged)
     Q_PROPERTY(bool alwaysOnTop    READ alwaysOnTop NOTIFY alwaysOnTopChanged)
     Q_PROPERTY(bool beatWindowAuto READ beatWindowAuto NOTIFY beatWindowAutoChanged)
     Q_PROPERTY(int beatWindowSubdivisionStyle READ beatWindowSubdivisionStyle NOTIFY beatWindowStyleChanged)
     Q_PROPERTY(int beatWindowPolyrhythmStyle READ beatWindowPolyrhythmStyle NOTIFY beatWindowStyleChanged)
     Q_PROPERTY(QString terminology READ terminology NOTIFY terminologyChanged)
+
+    // Engine health (performance overlay); refreshed while perfHudVisible
+    Q_PROPERTY(bool perfHudVisible READ perfHudVisible WRITE setPerfHudVisible NOTIFY perfHudVisibleChanged)
+    Q_PROPERTY(double engineCallbackUs    READ engineCallbackUs    NOTIFY engineStatsChanged)
+    Q_PROPERTY(double engineCallbackP99Us READ engineCallbackP99Us NOTIFY engineStatsChanged)
+    Q_PROPERTY(double engineCallbackMaxUs READ engineCallbackMaxUs NOTIFY engineStatsChanged)
+    Q_PROPERTY(double engineDeadlineUs    READ engineDeadlineUs    NOTIFY engineStatsChanged)
+    Q_PROPERTY(double engineHeadroomUs    READ engineHeadroomUs    NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineLoadPercent      READ engineLoadPercent   NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineDeadlineMisses   READ engineDeadlineMisses NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineXruns            READ engineXruns         NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineUnderruns        READ engineUnderruns     NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineVoices           READ engineVoices        NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineBacklog          READ engineBacklog       NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineStolenVoices     READ engineStolenVoices  NOTIFY engineStatsChanged)
+    Q_PROPERTY(int engineWorstCaseMix     READ engineWorstCaseMix  NOTIFY engineStatsChanged)
+
+    // Output device (low-latency mode applies the next time playback starts)
+    Q_PROPERTY(bool lowLatencyMode     READ lowLatencyMode     NOTIFY outputModeChanged)
+    Q_PROPERTY(int outputPeriodFrames  READ outputPeriodFrames NOTIFY outputModeChanged)
+    Q_PROPERTY(int outputChannels      READ outputChannels     NOTIFY outputModeChanged)
+    Q_PROPERTY(double outputLatencyMs  READ outputLatencyMs    NOTIFY outputInfoChanged)
+    Q_PROPERTY(QString outputDeviceInfo READ outputDeviceInfo  NOTIFY outputInfoChanged)
+    Q_PROPERTY(int outputDeviceChannels READ outputDeviceChannels NOTIFY outputInfoChanged)   // routable channels of the open device
+    // Where each kind of pulse plays in a multichannel mix: per route, its
+    // name, dest ("all", a channel "3" or a pair "3+4", 1-based) and pan (-1..1, pairs only)
+    Q_PROPERTY(QVariantList outputRoutes READ outputRoutes NOTIFY outputRoutingChanged)
+    // Calibration added to the estimated audible time of each pulse (ms)
+    Q_PROPERTY(int uiLatencyOffsetMs READ uiLatencyOffsetMs WRITE setUiLatencyOffsetMs NOTIFY uiLatencyOffsetChanged)
+    // Polyphony cap of the voice pool; past it the oldest voice is stolen
+    Q_PROPERTY(int maxVoices READ maxVoices WRITE setMaxVoices NOTIFY maxVoicesChanged)
+
+    // Timing feedback from the input (the device opens full-duplex the next time playback starts)
+    Q_PROPERTY(bool inputAnalysisEnabled READ inputAnalysisEnabled WRITE setInputAnalysisEnabled NOTIFY inputAnalysisEnabledChanged)
+    Q_PROPERTY(bool inputCapturing       READ inputCapturing       NOTIFY outputInfoChanged)
+    // Calibration added to the device round trip before onsets are matched (ms)
+    Q_PROPERTY(int inputLatencyOffsetMs READ inputLatencyOffsetMs WRITE setInputLatencyOffsetMs NOTIFY inputLatencyOffsetChanged)
+    Q_PROPERTY(QVariantList timingStats READ timingStats   NOTIFY timingStatsChanged)   // per pulse: idx, beat, isBeat, count, meanMs, sdMs
+    Q_PROPERTY(int timingOnsets          READ timingOnsets  NOTIFY timingStatsChanged)
+    Q_PROPERTY(int timingMatched         READ timingMatched NOTIFY timingStatsChanged)
+    Q_PROPERTY(double timingMeanMs       READ timingMeanMs  NOTIFY timingStatsChanged)
+    Q_PROPERTY(double timingSdMs         READ timingSdMs    NOTIFY timingStatsChanged)
+    Q_PROPERTY(double timingLastMs       READ timingLastMs  NOTIFY timingStatsChanged)
+    // Tempo from the input: listen with the metronome stopped, take the tempo
+    // once it holds steady, and optionally start on the player's next downbeat
+    Q_PROPERTY(bool tempoListening       READ tempoListening  NOTIFY tempoListeningChanged)
+    Q_PROPERTY(double detectedTempo      READ detectedTempo   NOTIFY detectedTempoChanged)   // 0 = none yet
+    Q_PROPERTY(double tempoConfidence    READ tempoConfidence NOTIFY detectedTempoChanged)
+    Q_PROPERTY(bool tempoListenAutoStart READ tempoListenAutoStart WRITE setTempoListenAutoStart NOTIFY tempoListenAutoStartChanged)
 
 public:
     explicit MetronomeController(QObject* parent = nullptr);
@@ -115,7 +172,8 @@ public:
     // ---- Getters ----
     bool running() const;
     QString startStopLabel() const { return m_startStopLabel; }
-    int tempo() const { return m_tempo; }
+    double tempo() const { return m_tempo; }
+    QString tempoText() const { return formatTempo(m_tempo); }
     QString tempoMarkings() const;
     int numerator() const { return m_numerator; }
     int denominator() const { return m_denominator; }
@@ -133,6 +191,7 @@ public:
     int polyPrimaryBeats() const;
     int polySecondaryBeats() const;
     bool polyrhythmPerBeat() const;
+    QVariantList tracks() const;
     QVariantList accents() const;
     bool showAccents() const;
     int subdivisionRevision() const { return m_subdivisionRevision; }
@@ -168,34 +227,86 @@ public:
     QString presetName() const { return m_currentPreset.songName; }
     QStringList presetNames() const { return m_presetManager.listPresetNames(); }
     QString soundSet()    const { return m_soundSet; }
+    QStringList soundSets() const;
+    QString polySoundSet() const { return m_polySoundSet; }
     bool obsEnabled()     const { return !m_obsHidden; }
     bool alwaysOnTop()    const { return m_alwaysOnTop; }
     bool beatWindowAuto() const { return m_beatWindowAuto; }
     int beatWindowSubdivisionStyle() const { return m_beatWindowSubdivisionStyle; }
     int beatWindowPolyrhythmStyle() const { return m_beatWindowPolyrhythmStyle; }
     QString terminology() const { return m_terminology; }
+    bool perfHudVisible() const { return m_perfHudVisible; }
+    double engineCallbackUs() const    { return m_engineStats.lastUs; }
+    double engineCallbackP99Us() const { return m_engineStats.p99Us; }
+    double engineCallbackMaxUs() const { return m_engineStats.maxUs; }
+    double engineDeadlineUs() const    { return m_engineStats.deadlineUs; }
+    double engineHeadroomUs() const    { return m_engineStats.minHeadroomUs; }
+    int engineLoadPercent() const      { return int(m_engineStats.load() * 100.0 + 0.5); }
+    int engineDeadlineMisses() const   { return int(m_engineStats.deadlineMisses); }
+    int engineXruns() const            { return int(m_engineStats.lateCallbacks); }
+    int engineUnderruns() const        { return int(m_engineUnderruns); }
+    int engineVoices() const           { return m_engineStats.activeVoices; }
+    int engineBacklog() const          { return m_engineStats.eventBacklog; }
+    int engineStolenVoices() const     { return int(m_engineStats.stolenVoices); }
+    int engineWorstCaseMix() const     { return int(m_engineStats.worstCaseMix); }
+    bool lowLatencyMode() const        { return m_lowLatencyMode; }
+    int outputPeriodFrames() const     { return m_outputPeriodFrames; }
+    int outputChannels() const         { return m_outputChannels; }
+    double outputLatencyMs() const;
+    QString outputDeviceInfo() const;
+    int outputDeviceChannels() const;
+    QVariantList outputRoutes() const;
+    int uiLatencyOffsetMs() const      { return m_uiLatencyOffsetMs; }
+    int maxVoices() const              { return m_maxVoices; }
+    bool inputAnalysisEnabled() const  { return m_inputAnalysisEnabled; }
+    bool inputCapturing() const;
+    int inputLatencyOffsetMs() const   { return m_inputLatencyOffsetMs; }
+    QVariantList timingStats() const;
+    int timingOnsets() const           { return m_timing.onsets; }
+    int timingMatched() const          { return m_timing.matched; }
+    double timingMeanMs() const        { return m_timing.meanMs; }
+    double timingSdMs() const          { return m_timing.sdMs; }
+    double timingLastMs() const        { return m_timing.lastMs; }
+    bool tempoListening() const        { return m_tempoListening; }
+    double detectedTempo() const       { return m_detectedTempo.bpm; }
+    double tempoConfidence() const     { return m_detectedTempo.confidence; }
+    bool tempoListenAutoStart() const  { return m_tempoListenAutoStart; }
 
     // ---- Setters (Q_PROPERTY write) ----
-    void setTempo(int tempo);
+    void setTempo(double tempo);
     void setVolume(int volume);
     void setTimerTotalSeconds(int seconds);
     void setSpeedBarsPerStep(int v);
     void setSpeedTempoStep(int v);
     void setSpeedMaxTempo(int v);
+    void setPerfHudVisible(bool visible);
+    void setUiLatencyOffsetMs(int ms);
+    void setMaxVoices(int voices);
+    void setPolySoundSet(const QString& set);
+    void setInputAnalysisEnabled(bool enabled);
+    void setInputLatencyOffsetMs(int ms);
+    void setTempoListenAutoStart(bool on);
 
     // ---- Invokables ----
     Q_INVOKABLE void startStop();
     Q_INVOKABLE void tapTempo();
+    Q_INVOKABLE void toggleTempoListening();
     Q_INVOKABLE void requestTimeSignature(int num, int den);
     Q_INVOKABLE void openSubdivisionPicker();
     Q_INVOKABLE void togglePolyrhythm();
     Q_INVOKABLE void setPolyrhythm(int primary, int secondary, bool perBeat);
+    Q_INVOKABLE void addTrack(int numerator, int denominator);
+    Q_INVOKABLE void setTrack(int index, int numerator, int denominator, double gain);
+    Q_INVOKABLE void setTrackSubdivision(int index, const QString& name);
+    Q_INVOKABLE void setTrackSoundSet(int index, const QString& set);
+    Q_INVOKABLE void setTrackRoute(int index, const QString& dest, double pan = 0.0);
+    Q_INVOKABLE void removeTrack(int index);
     Q_INVOKABLE void setAccent(int index, bool value);
     Q_INVOKABLE void toggleTimer();
     Q_INVOKABLE void toggleSpeed();
     Q_INVOKABLE void toggleCountIn();
     Q_INVOKABLE void addSection();
-    Q_INVOKABLE void addSectionRange(int targetTempo, int stepSize);
+    Q_INVOKABLE void addSectionRange(double targetTempo, int stepSize);
     Q_INVOKABLE void removeSection();
     Q_INVOKABLE void moveSectionUp();
     Q_INVOKABLE void moveSectionDown();
@@ -212,6 +323,10 @@ public:
     Q_INVOKABLE QString sectionLabelAt(int index) const;
     Q_INVOKABLE void setSectionLabel(int index, const QString& label);
     Q_INVOKABLE bool presetNameExists(const QString& name) const;
+    Q_INVOKABLE void resetEngineStats();
+    Q_INVOKABLE void setOutputMode(bool lowLatency, int periodFrames, int channels = 0);
+    Q_INVOKABLE void setOutputRoute(int route, const QString& dest, double pan = 0.0);
+    Q_INVOKABLE void resetTimingStats();
 
     // Custom subdivision management
     Q_INVOKABLE void openNewCustomPattern();
@@ -226,14 +341,23 @@ public:
     Q_INVOKABLE int customPatternsInFile(const QString& filePath) const;
     Q_INVOKABLE bool importPresetsFromFile(const QStringList& names, const QString& filePath);
 
+    // ---- Offline click-track render (runs in the background, see renderFinished) ----
+    Q_INVOKABLE void renderPresetToWav(const QString& presetName, const QString& filePath,
+                                       int sampleRate, int barsPerSection);
+
     // ---- Accessed by NoteImageProvider ----
     QPixmap currentSubdivisionPixmap(const QSize& size) const;
     QPixmap sectionSubdivisionPixmap(int sectionIdx, const QSize& size) const;
     QPixmap pickerPatternPixmap(int cat, int idx, const QSize& size) const;
     QPixmap stagedPatternPixmap(const QSize& size) const;
 
+    // ---- Shared with the headless render mode (main.cpp) ----
+    static QString presetFilePath();
+    static QString soundFileForSet(const QString& set, bool accent);
+
 signals:
     void runningChanged();
+    void trackPulse(int track, bool accent);   // track is 1-based; one per track beat
     void startStopLabelChanged();
     void tempoChanged();
     void timeSignatureChanged();
@@ -258,18 +382,36 @@ signals:
     void presetNameChanged();
     void presetNamesChanged();
     void soundSetChanged();
+    void polySoundSetChanged();
     void obsEnabledChanged();
     void alwaysOnTopChanged();
     void beatWindowAutoChanged();
     void beatWindowStyleChanged();
     void terminologyChanged();
+    void perfHudVisibleChanged();
+    void engineStatsChanged();
+    void outputModeChanged();
+    void outputInfoChanged();
+    void outputRoutingChanged();
+    void uiLatencyOffsetChanged();
+    void maxVoicesChanged();
+    void inputAnalysisEnabledChanged();
+    void inputLatencyOffsetChanged();
+    void timingStatsChanged();
+    void tempoListeningChanged();
+    void detectedTempoChanged();
+    void tempoListenAutoStartChanged();
     void customEditorReady();
+    void renderFinished(bool ok, const QString& message);
 
 private slots:
     void onMetronomePulse(AudioPulseEvent ev);
-    void onTempoSteppedUp(int newTempo);
+    void onTempoSteppedUp(double newTempo);
     void onTimerTick();
     void onObsPulseReset();
+    void onEngineStatsTick();
+    void onTimingTick();
+    void onTempoListenTick();
 
 private:
     MetronomeEngine metronome;
@@ -280,6 +422,8 @@ private:
 
     // Persistent settings
     QString m_soundSet    = "Default";
+    QString m_polySoundSet;   // the polyrhythm's second layer plays this set's accent
+    void applyPolySound();
     QColor  m_accentColor = QColor(150, 0, 0);
     bool    m_obsHidden   = true;
     bool    m_alwaysOnTop = false;
@@ -289,7 +433,7 @@ private:
     QString m_terminology = "Piece";
 
     // Tempo / time signature
-    int m_tempo = 120;
+    double m_tempo = 120;
     int m_numerator = 4;
     int m_denominator = 4;
     int m_volume = 90;
@@ -308,8 +452,8 @@ private:
     int m_speedBarsPerStep = 4;
     int m_speedTempoStep = 2;
     int m_speedMaxTempo = 180;
-    int m_speedTrainerStartTempo = 120;
-    int m_speedTrainerCurrentTempo = 120;
+    double m_speedTrainerStartTempo = 120;
+    double m_speedTrainerCurrentTempo = 120;
     int m_speedTrainerTotalBarCounter = 0;
     bool m_speedTrainerCountingIn = false;
     bool m_speedTrainerPolyFirstCycle = true;
@@ -338,6 +482,52 @@ private:
     bool m_obsPulse = false;
     QTimer* m_obsPulseTimer = nullptr;
 
+    // Offline render: one at a time, cancelled and joined on destruction
+    QThread*          m_renderThread = nullptr;
+    std::atomic<bool> m_renderCancel{false};
+
+    // Performance overlay
+    bool    m_perfHudVisible = false;
+    QTimer* m_engineStatsTimer = nullptr;
+    EngineStatsSnapshot m_engineStats;
+    quint64 m_engineUnderruns = 0;
+
+    // Output device
+    bool m_lowLatencyMode     = false;
+    int  m_outputPeriodFrames = 0;   // 0 = backend default
+    int  m_outputChannels     = 0;   // 0 = mono, or native in low-latency mode
+    int  m_uiLatencyOffsetMs  = 0;
+    static constexpr int kMaxUiLatencyOffsetMs = 250;
+    int  m_maxVoices          = VoicePool::kDefaultPolyphony;
+    void applyOutputMode();
+
+    // Output routing, one entry per AudioEngine::RouteClass
+    struct OutputRoute {
+        QString dest = QStringLiteral("all");
+        double  pan  = 0.0;
+    };
+    static constexpr int kOutputRoutes = int(AudioEngine::RouteClass::Count);
+    OutputRoute m_outputRoutes[kOutputRoutes];
+    void applyOutputRouting();
+
+    // Polymeter track sound sets, loaded into the bank on first use: file -> ID
+    QHash<QString, int> m_trackSounds;
+
+    // Timing feedback
+    bool    m_inputAnalysisEnabled = false;   // not persisted: opens the microphone
+    int     m_inputLatencyOffsetMs = 0;
+    static constexpr int kMaxInputLatencyOffsetMs = 250;
+    QTimer* m_timingTimer = nullptr;
+    TimingReport m_timing;
+
+    // Tempo detection
+    bool    m_tempoListening = false;
+    bool    m_tempoListenAutoStart = false;
+    static constexpr int kTempoStartLeadMs = 250;   // room to restart the device before an aligned start
+    QTimer* m_tempoListenTimer = nullptr;
+    TempoEstimate m_detectedTempo;
+    void stopTempoListening();
+
     // Custom pattern editor
     CustomPatternEditor* m_patternEditor = nullptr;
     int     m_editingPatternIdx = -1;
@@ -361,10 +551,11 @@ private:
 
     // Internal helpers
     QString settingsPath() const;
-    QString presetFilePath() const;
     void loadSettings();
     void saveSettings();
     void loadSectionToEngine(int idx);
+    void commitSectionTracks();
+    std::vector<TrackParams> engineTracks(const MetronomeSection& s);
     void refreshSectionModel();
     void updateStartStopLabel(const QString& label);
     void updateBeatIndicator(int beats, int subs, int beat, int sub,
@@ -372,9 +563,9 @@ private:
                              int polyMain = 0, int polySec = 0);
     void notifySectionTableEnabled();
     void triggerObsPulse();
-    QString soundFileForSet(const QString& set, bool accent) const;
     SubdivisionPattern getDefaultSubdivisionPattern() const;
     static QString getTempoMarkings(int bpm);
+    static QString formatTempo(double bpm);
     void resetSpeedTrainer();
     void startCountIn();
     void stopAll();
@@ -30,6 +30,12 @@ public class InputDialog {
 
     public static void show(Activity activity, String title, String defaultText,
                             boolean numbersOnly, int accentArgb) {
+        show(activity, title, defaultText, numbersOnly, false, accentArgb);
+    }
+
+    // decimal: a numbersOnly field also takes a decimal point
+    public static void show(Activity activity, String title, String defaultText,
+                            boolean numbersOnly, boolean decimal, int accentArgb) {
         activity.runOnUiThread(() -> {
             float dens = activity.getResources().getDisplayMetrics().density;
             int dp4  = Math.round( 4 * dens);
@@ -73,7 +79,8 @@ public class InputDialog {
             editText.setTextSize(TypedValue.COMPLEX_UNIT_SP, 18);
             editText.setImeOptions(EditorInfo.IME_ACTION_DONE);
             if (numbersOnly) {
-                editText.setInputType(InputType.TYPE_CLASS_NUMBER | InputType.TYPE_NUMBER_FLAG_SIGNED);
+                editText.setInputType(InputType.TYPE_CLASS_NUMBER | InputType.TYPE_NUMBER_FLAG_SIGNED
+                                      | (decimal ? InputType.TYPE_NUMBER_FLAG_DECIMAL : 0));
                 editText.setGravity(Gravity.CENTER);
             } else {
                 editText.setInputType(InputType.TYPE_CLASS_TEXT | InputType.TYPE_TEXT_FLAG_CAP_SENTENCES);
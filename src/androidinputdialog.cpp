@@ -68,7 +68,7 @@ void AndroidInputDialog::showText(const QString &title, const QString &defaultTe
 #endif
 }
 
-void AndroidInputDialog::showNumber(const QString &title, int value)
+void AndroidInputDialog::showNumber(const QString &title, double value, bool decimal)
 {
 #ifdef Q_OS_ANDROID
     jint accentArgb = (jint)m_accentColor.rgba();
@@ -76,14 +76,15 @@ void AndroidInputDialog::showNumber(const QString &title, int value)
         "org/qtproject/qt/android/QtNative", "activity", "()Landroid/app/Activity;");
     QJniObject::callStaticMethod<void>(
         "org/qtproject/example/SH4DOWNOME/InputDialog", "show",
-        "(Landroid/app/Activity;Ljava/lang/String;Ljava/lang/String;ZI)V",
+        "(Landroid/app/Activity;Ljava/lang/String;Ljava/lang/String;ZZI)V",
         activity.object(),
         QJniObject::fromString(title).object(),
-        QJniObject::fromString(QString::number(value)).object(),
+        QJniObject::fromString(QString::number(value, 'g', 6)).object(),
         jboolean(true),
+        jboolean(decimal),
         accentArgb);
 #else
-    Q_UNUSED(title); Q_UNUSED(value);
+    Q_UNUSED(title); Q_UNUSED(value); Q_UNUSED(decimal);
 #endif
 }
 
@@ -14,7 +14,7 @@ public:
     void setAccentColor(const QColor &c) { m_accentColor = c; }
 
     Q_INVOKABLE void showText(const QString &title, const QString &defaultText);
-    Q_INVOKABLE void showNumber(const QString &title, int value);
+    Q_INVOKABLE void showNumber(const QString &title, double value, bool decimal = false);
     Q_INVOKABLE void showBulkAdd(int fromTempo);
     Q_INVOKABLE void showImeForFocused();
 
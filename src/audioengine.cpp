@@ -1,37 +1,96 @@
 ﻿#include "audioengine.h"
+#include "resampler.h"
+#include "pcmcache.h"
 #include <QFile>
+#include <QResource>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
 #include <QtEndian>
 #include <cstring>
 #include <qDebug>
 #include <set>
+#include <map>
+#include <memory>
 #include <cmath>
 #include <algorithm>
+#include <numeric>
+#include <chrono>
 
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 
-// Helper: simple linear resampler (kept as fallback)
-void resamplePCMBuffer(std::vector<float>& data, int srcRate, int dstRate) {
-    if (srcRate == dstRate || data.empty()) return;
-
-    double rateRatio = double(dstRate) / srcRate;
-    size_t newLength = std::max<size_t>(1, size_t(data.size() * rateRatio));
-    std::vector<float> resampled(newLength);
+// Decoded samples per (resource, rate), shared by every engine in the
+// process.  Rate 0 holds the file at its own rate; other entries are that
+// decode run through the polyphase resampler, so moving between 44.1 kHz
+// and 48 kHz interfaces only converts each sound once.  Misses fall through
+// to PcmDiskCache, which keeps the same entries across runs.
+namespace {
+class PcmRateCache {
+public:
+    static constexpr size_t kMaxEntries = 64;
+
+    std::shared_ptr<const PcmData> find(const QString& path, int rate) {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.find({path, rate});
+        return it == m_entries.end() ? nullptr : it->second;
+    }
 
-    for (size_t i = 0; i < newLength; ++i) {
-        double srcPos = i / rateRatio;
-        size_t idx0 = size_t(srcPos);
-        size_t idx1 = std::min(idx0 + 1, data.size() - 1);
-        double frac = srcPos - idx0;
-        resampled[i] = float((1.0 - frac) * data[idx0] + frac * data[idx1]);
+    void insert(const QString& path, int rate, std::shared_ptr<const PcmData> pcm) {
+        QMutexLocker lock(&m_mutex);
+        if (m_entries.emplace(std::make_pair(path, rate), std::move(pcm)).second)
+            m_order.push_back({path, rate});
+        while (m_order.size() > kMaxEntries) {   // oldest first
+            m_entries.erase(m_order.front());
+            m_order.pop_front();
+        }
     }
 
-    data.swap(resampled);
+private:
+    QMutex m_mutex;
+    std::map<std::pair<QString, int>, std::shared_ptr<const PcmData>> m_entries;
+    std::deque<std::pair<QString, int>> m_order;
+};
+
+PcmRateCache& pcmCache() {
+    static PcmRateCache cache;
+    return cache;
+}
+
+// The encoded bytes of a sound, without copying them where possible:
+// uncompressed Qt resources are read in place from the binary and files on
+// disk are mapped.  Compressed resources fall back to a read.
+struct EncodedSound {
+    QByteArray bytes;               // may point into the resource or mapping
+    std::unique_ptr<QFile> file;    // keeps a mapping alive
+};
+
+bool openEncoded(const QString& path, EncodedSound& out) {
+    if (path.startsWith(QLatin1Char(':'))) {
+        QResource resource(path);
+        if (resource.isValid() && resource.data() &&
+            resource.compressionAlgorithm() == QResource::NoCompression) {
+            out.bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(resource.data()),
+                                                resource.size());
+            return true;
+        }
+    }
+    out.file = std::make_unique<QFile>(path);
+    if (!out.file->open(QIODevice::ReadOnly))
+        return false;
+    if (uchar* mapped = out.file->map(0, out.file->size())) {
+        out.bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), out.file->size());
+        return true;
+    }
+    out.bytes = out.file->readAll();
+    return true;
 }
+} // namespace
 
 // Decode WAV (or other) resource bytes into float samples using miniaudio decoder.
 // This decodes directly to the requested output sample rate and mono.
-static bool decodeResourceToFloatMono(const QByteArray& wavData, std::vector<float>& outData, int& outSampleRate, int& outChannels, ma_decoder_config desiredConfig) {
+static bool decodeResourceToFloatMono(const QByteArray& wavData, SampleVector& outData, int& outSampleRate, int& outChannels, ma_decoder_config desiredConfig) {
     ma_decoder decoder;
     ma_result r = ma_decoder_init_memory(wavData.constData(), (ma_uint32)wavData.size(), &desiredConfig, &decoder);
     if (r != MA_SUCCESS) {
@@ -49,7 +108,7 @@ static bool decodeResourceToFloatMono(const QByteArray& wavData, std::vector<flo
     }
 
     // Read as floats directly
-    std::vector<float> temp;
+    SampleVector temp;
     temp.resize(size_t(frameCount * outChannels));
     ma_uint64 framesRead = 0;
     r = ma_decoder_read_pcm_frames(&decoder, temp.data(), frameCount, &framesRead);
@@ -77,49 +136,70 @@ static bool decodeResourceToFloatMono(const QByteArray& wavData, std::vector<flo
     return true;
 }
 
-// PCMBuffer::loadFromWavResource updated to store resourcePath and decode in-memory directly to device rate
+// Decode at the file's own rate (mono), then convert to deviceRate with the
+// polyphase resampler rather than miniaudio's linear one.  Both steps are
+// cached per (resource, rate) in memory and per (content, rate) on disk;
+// miniaudio handles WAV, FLAC and MP3 alike.
 bool PCMBuffer::loadFromWavResource(const QString& resourcePath_, int deviceRate) {
     resourcePath = resourcePath_;
-    QFile file(resourcePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        valid = false;
-        return false;
-    }
-    QByteArray wavData = file.readAll();
-    file.close();
-
-    // Preferred: decode to floats directly at deviceRate (mono)
-    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, deviceRate);
-    std::vector<float> decoded;
-    int decodedChannels = 0;
-    int decodedRate = 0;
-    bool ok = decodeResourceToFloatMono(wavData, decoded, decodedRate, decodedChannels, config);
-
-    if (!ok) {
-        // Fallback: try letting decoder choose sample rate then resample
-        ma_decoder_config autoCfg = ma_decoder_config_init(ma_format_f32, 1, 0);
-        ok = decodeResourceToFloatMono(wavData, decoded, decodedRate, decodedChannels, autoCfg);
-        if (!ok) {
+    PcmRateCache& cache = pcmCache();
+    PcmDiskCache& disk  = PcmDiskCache::instance();
+    const int rateKey = deviceRate > 0 ? deviceRate : 0;
+
+    std::shared_ptr<const PcmData> found = cache.find(resourcePath, rateKey);
+    source = Source::MemoryCache;
+    if (!found) {
+        EncodedSound sound;
+        if (!openEncoded(resourcePath, sound)) {
             valid = false;
             return false;
         }
-        // resample to deviceRate
-        if (decodedRate != deviceRate) {
-            resamplePCMBuffer(decoded, decodedRate, deviceRate);
-            decodedRate = deviceRate;
+        const QByteArray& encoded = sound.bytes;
+        const QByteArray key = disk.isEnabled() ? PcmDiskCache::contentKey(encoded) : QByteArray();
+
+        found  = disk.load(key, rateKey);
+        source = Source::DiskCache;
+        if (!found) {
+            std::shared_ptr<const PcmData> native = cache.find(resourcePath, 0);
+            if (!native)
+                native = disk.load(key, 0);
+            if (!native) {
+                SampleVector decoded;
+                int decodedRate = 0, decodedChannels = 0;
+                ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, 0);
+                if (!decodeResourceToFloatMono(encoded, decoded, decodedRate, decodedChannels, config)) {
+                    valid = false;
+                    return false;
+                }
+                native = PcmData::fromSamples(std::move(decoded), decodedRate);
+                disk.store(key, 0, *native);
+                source = Source::Decoded;
+            }
+            cache.insert(resourcePath, 0, native);
+
+            if (rateKey == 0 || native->sampleRate() == rateKey) {
+                found = native;
+            } else {
+                PolyphaseResampler resampler(native->sampleRate(), rateKey);
+                found = PcmData::fromSamples(resampler.process(native->samples(), native->frames()), rateKey);
+                disk.store(key, rateKey, *found);
+                source = Source::Decoded;
+            }
         }
+        cache.insert(resourcePath, rateKey, found);
     }
 
     // Fill PCMBuffer fields
-    data = std::move(decoded);
+    pcm = std::move(found);
     numChannels = 1;
-    sampleRate = decodedRate;
-    valid = !data.empty();
+    sampleRate = pcm->sampleRate();
+    valid = pcm->frames() > 0;
 
     // Find first nonzero sample (startSample)
     startSample = -1;
     const float EPS = 1e-5f;
-    for (size_t i = 0; i < data.size(); ++i) {
+    const float* data = pcm->samples();
+    for (size_t i = 0; i < pcm->frames(); ++i) {
         if (std::fabs(data[i]) > EPS) {
             startSample = int(i);
             break;
@@ -148,14 +228,15 @@ void PCMBuffer::resampleTo(int dstRate)
     int srcRate = sampleRate;
     int oldStart = startSample;
 
-    // Perform resample
-    resamplePCMBuffer(data, srcRate, dstRate);
+    // Perform resample (into a new PcmData: the old one may be shared)
+    PolyphaseResampler resampler(srcRate, dstRate);
+    pcm = PcmData::fromSamples(resampler.process(pcm->samples(), pcm->frames()), dstRate);
 
     if (oldStart >= 0 && srcRate > 0) {
         double ratio = double(dstRate) / double(srcRate);
         startSample = int(std::round(oldStart * ratio));
         if (startSample < 0) startSample = 0;
-        if (startSample >= int(data.size())) startSample = int(data.size()) - 1;
+        if (startSample >= frames()) startSample = frames() - 1;
     } else {
         startSample = 0;
     }
@@ -180,6 +261,16 @@ AudioEngine::AudioEngine(QObject* parent)
     
     // Start with a default, but we'll detect the real rate when we initialize the device
     m_sampleRate = 44100;
+
+    m_pulseDrainTimer = new QTimer(this);
+    m_pulseDrainTimer->setTimerType(Qt::PreciseTimer);
+    m_pulseDrainTimer->setInterval(kPulseDrainIntervalMs);
+    connect(m_pulseDrainTimer, &QTimer::timeout, this, &AudioEngine::drainPulseRing);
+
+    m_presentTimer = new QTimer(this);
+    m_presentTimer->setTimerType(Qt::PreciseTimer);
+    m_presentTimer->setSingleShot(true);
+    connect(m_presentTimer, &QTimer::timeout, this, &AudioEngine::presentDuePulses);
     
     qDebug() << "AudioEngine: Initialized with default sample rate:" << m_sampleRate << "Hz (will auto-detect on start)";
 }
@@ -200,66 +291,82 @@ bool AudioEngine::start(double bpm) {
     // from silence to active output before the first beat fires.  WASAPI (and some
     // other backends) produce a transient click on the very first samples written to
     // a freshly-opened audio session; this tiny delay keeps the first beat clear of it.
-    m_globalSamplePos = -(int64_t)m_bufferFrames;
+    m_globalSamplePos = -int64_t(m_bufferFrames.load());
     m_pendingScheduleSwapSamplePos = -1;
     return true;
 }
 
-// Add this new detection method
-int AudioEngine::detectBestSampleRate() {
-    // Common sample rates in order of preference
-    int preferredRates[] = {48000, 44100, 96000, 88200, 192000};
-    int numRates = sizeof(preferredRates) / sizeof(preferredRates[0]);
-    
-    for (int i = 0; i < numRates; ++i) {
-        ma_device_config testConfig = ma_device_config_init(ma_device_type_playback);
-        testConfig.playback.format = ma_format_f32;
-        testConfig.playback.channels = 1;
-        testConfig.sampleRate = preferredRates[i];
-        testConfig.dataCallback = nullptr; // No callback for test
-        testConfig.pUserData = nullptr;
-        
-        ma_device testDevice;
-        ma_result result = ma_device_init(nullptr, &testConfig, &testDevice);
-        
-        if (result == MA_SUCCESS) {
-            int actualRate = testDevice.sampleRate;
-            ma_device_uninit(&testDevice);
-            
-            // If the device accepted our preferred rate (or close to it), use it
-            if (actualRate == preferredRates[i] || 
-                (actualRate >= preferredRates[i] - 1000 && actualRate <= preferredRates[i] + 1000)) {
-                return actualRate;
-            }
-        }
+// One context query, no device: the default playback device's name and
+// the rate it runs at natively.  Safe from any thread but the callback.
+static bool queryDefaultPlayback(ma_context* context, QString& name, int& nativeRate)
+{
+    ma_device_info info;
+    if (ma_context_get_device_info(context, ma_device_type_playback, nullptr, &info) != MA_SUCCESS)
+        return false;
+    name = QString::fromUtf8(info.name);
+    nativeRate = 0;
+    for (ma_uint32 i = 0; i < info.nativeDataFormatCount; ++i) {
+        const int rate = int(info.nativeDataFormats[i].sampleRate);   // 0 = any rate
+        if (rate == 48000 || rate == 44100) { nativeRate = rate; break; }
+        if (nativeRate == 0) nativeRate = rate;
     }
-    
-    // If none of the preferred rates worked, try auto-detection
-    ma_device_config autoConfig = ma_device_config_init(ma_device_type_playback);
-    autoConfig.playback.format = ma_format_f32;
-    autoConfig.playback.channels = 1;
-    autoConfig.sampleRate = 0; // Let miniaudio choose
-    autoConfig.dataCallback = nullptr;
-    autoConfig.pUserData = nullptr;
-    
-    ma_device autoDevice;
-    ma_result result = ma_device_init(nullptr, &autoConfig, &autoDevice);
-    
-    if (result == MA_SUCCESS) {
-        int autoRate = autoDevice.sampleRate;
-        ma_device_uninit(&autoDevice);
-        return autoRate;
+    return true;
+}
+
+void AudioEngine::setDeviceProfile(const DeviceProfile& profile) {
+    if (m_deviceInitialized) return;
+    m_deviceProfile = profile;
+    if (profile.isValid())
+        m_sampleRate = profile.sampleRate;
+}
+
+// Background re-validation after an open.  The device keeps the rate it was
+// opened with; a changed native rate is recorded for the next open.  The
+// worker queries through a context of its own, since the GUI thread may be
+// opening a device on m_context meanwhile, and always hands back to
+// applyProfileCheck() (with the profile unchanged on failure) so the thread
+// is joined.
+void AudioEngine::startProfileCheck() {
+    if (m_profileCheckThread || !m_contextInitialized) return;
+    m_profileCheckThread = QThread::create([this, current = m_deviceProfile]() {
+        DeviceProfile seen = current;
+        ma_context context;
+        if (ma_context_init(nullptr, 0, nullptr, &context) == MA_SUCCESS) {
+            if (!queryDefaultPlayback(&context, seen.deviceName, seen.sampleRate) || seen.sampleRate <= 0)
+                seen = current;
+            ma_context_uninit(&context);
+        }
+        QMetaObject::invokeMethod(this, [this, seen] { applyProfileCheck(seen); }, Qt::QueuedConnection);
+    });
+    m_profileCheckThread->setObjectName(QStringLiteral("AudioEngine device profile check"));
+    m_profileCheckThread->start(QThread::LowPriority);
+}
+
+void AudioEngine::applyProfileCheck(const DeviceProfile& seen) {
+    if (m_profileCheckThread) {
+        m_profileCheckThread->wait();
+        delete m_profileCheckThread;
+        m_profileCheckThread = nullptr;
     }
-    
-    return -1; // Detection failed
+    if (seen == m_deviceProfile) return;
+    qDebug() << "AudioEngine: Device profile updated:" << seen.deviceName << seen.sampleRate
+             << "Hz (was" << m_deviceProfile.sampleRate << "Hz)";
+    m_deviceProfile = seen;
+    emit deviceProfileChanged();
 }
 
 AudioEngine::~AudioEngine() {
     stop();
-    if (m_deviceInitialized) {
-        ma_device_uninit(&m_device);
-        m_deviceInitialized = false;
+    stopProducer();
+    if (m_reloadThread)
+        finishSampleReload();
+    if (m_profileCheckThread) {
+        m_profileCheckThread->wait();
+        delete m_profileCheckThread;
     }
+    closeDevice();
+    if (m_contextInitialized)
+        ma_context_uninit(&m_context);
 }
 
 void AudioEngine::setVolume(float vol) {
@@ -267,20 +374,145 @@ void AudioEngine::setVolume(float vol) {
 }
 
 bool AudioEngine::loadSample(const QString& name, const QString& resourcePath) {
-    PCMBuffer buf;
+    int id = m_bank.idFor(name);
+    if (id < 0) {
+        qWarning() << "AudioEngine: sample bank full, cannot load" << name;
+        return false;
+    }
+    auto* buf = new PCMBuffer;
     // Prefer decoding directly to the current device sample rate (if device already known)
     int deviceRate = m_sampleRate;
-    if (!buf.loadFromWavResource(resourcePath, deviceRate)) return false;
-    QMutexLocker sampleLock(&m_sampleMutex);
-    m_samples[name] = std::move(buf);
+    QElapsedTimer clock;
+    clock.start();
+    if (!buf->loadFromWavResource(resourcePath, deviceRate)) {
+        delete buf;
+        return false;
+    }
+    static const char* const kSourceNames[] = {"decoded", "memory cache", "disk cache"};
+    qDebug().noquote() << "AudioEngine: Loaded" << name << "from" << resourcePath << "at"
+                       << buf->sampleRate << "Hz in" << QString::number(clock.nsecsElapsed() / 1e6, 'f', 2)
+                       << "ms (" + QString::fromLatin1(kSourceNames[int(buf->source)]) + ")";
+    // A reload in flight or staged may carry the previous sound for this ID;
+    // drop it and reload from what is installed now.
+    ++m_bankSerial;
+    if (m_bank.hasStaged()) {
+        m_bank.cancelStaged();
+        m_reloadSamplesRequested.store(true);
+    }
+    // The choke group belongs to the ID, so it survives reloads.
+    m_bank.install(id, buf);
+    m_bank.reclaim(!m_running.load());
     return true;
 }
 
-void AudioEngine::setAccentSound(const QString& name) {
-    m_accentSample = name;
+void AudioEngine::setChokeGroup(const QString& name, int group) {
+    int id = m_bank.find(name);
+    if (id >= 0)
+        m_bank.setChokeGroup(id, group);
+}
+
+// GUI thread.  Decodes sounds into the shared PCM caches on the global thread
+// pool, several at once, so that a later loadSample() of any of them is a
+// cache hit.  Nothing is installed.  Sounds are decoded for the open (or
+// offline) device's rate, or before it opens for the profiled one; with
+// neither known the prefetch waits for initializeDevice() rather than guess.
+void AudioEngine::prefetchSamples(const QStringList& resourcePaths) {
+    const int rate = m_deviceInitialized || m_offline ? m_sampleRate : m_deviceProfile.sampleRate;
+    if (rate <= 0) {
+        m_pendingPrefetch.append(resourcePaths);
+        return;
+    }
+    for (const QString& path : resourcePaths) {
+        QThreadPool::globalInstance()->start([path, rate] {
+            PCMBuffer buf;
+            buf.loadFromWavResource(path, rate);
+        });
+    }
+}
+
+// GUI thread, device not started.  Re-decodes (or resamples) every loaded
+// sound for the given rate and installs the results straight away.
+void AudioEngine::reloadSamplesForRate(int rate) {
+    for (int id : m_bank.loadedIds()) {
+        const PCMBuffer* cur = m_bank.get(id);
+        if (!cur || !cur->valid || cur->sampleRate == rate) continue;
+        qDebug() << "AudioEngine: Reloading sample" << m_bank.nameOf(id)
+                 << "from" << cur->sampleRate << "Hz to" << rate << "Hz";
+        auto* buf = new PCMBuffer(*cur);
+        if (buf->resourcePath.isEmpty() || !buf->reloadForDevice(rate))
+            buf->resampleTo(rate);
+        m_bank.install(id, buf);
+    }
+    m_bank.reclaim(!m_running.load());
+}
+
+// GUI thread.  A device rate change is handled in three steps: the callback
+// (or a reroute notification) asks for a reload, a worker thread decodes the
+// loaded sounds for the new rate, and the result is staged for the callback
+// to swap in at the next bar line.  With wait the worker is joined here.
+void AudioEngine::serviceSampleReload(bool wait) {
+    if (m_deviceRerouted.exchange(false)) {
+        refreshOutputInfo();
+        m_reloadSamplesRequested.store(true);
+    }
+    if (m_reloadThread && (wait || m_reloadThread->isFinished()))
+        finishSampleReload();
+    if (!m_reloadThread && m_reloadSamplesRequested.exchange(false)) {
+        startSampleReload(m_streamRate.load(std::memory_order_acquire));
+        if (wait && m_reloadThread)
+            finishSampleReload();
+    }
+}
+
+void AudioEngine::startSampleReload(int rate) {
+    std::vector<std::pair<int, PCMBuffer*>> jobs;
+    for (int id : m_bank.loadedIds()) {
+        const PCMBuffer* cur = m_bank.get(id);
+        if (cur && cur->valid && cur->sampleRate != rate)
+            jobs.push_back({id, new PCMBuffer(*cur)});
+    }
+    if (jobs.empty()) return;
+    qDebug() << "AudioEngine: Reloading" << jobs.size() << "samples for" << rate << "Hz in the background";
+
+    m_reloadRate = rate;
+    m_reloadBankSerial = m_bankSerial;
+    m_reloadJobs.swap(jobs);
+    m_reloadThread = QThread::create([this, rate] {
+        for (auto& job : m_reloadJobs) {
+            PCMBuffer* buf = job.second;
+            if (buf->resourcePath.isEmpty() || !buf->reloadForDevice(rate))
+                buf->resampleTo(rate);
+        }
+    });
+    m_reloadThread->setObjectName(QStringLiteral("AudioEngine sample reload"));
+    m_reloadThread->start(QThread::LowPriority);
 }
-void AudioEngine::setClickSound(const QString& name) {
-    m_clickSample = name;
+
+// Join the worker and hand its buffers on: staged for the callback while
+// playing, installed directly otherwise.  Results for a rate the device has
+// since left, or for sounds replaced meanwhile, are dropped and redone.
+void AudioEngine::finishSampleReload() {
+    m_reloadThread->wait();
+    delete m_reloadThread;
+    m_reloadThread = nullptr;
+
+    std::vector<std::pair<int, PCMBuffer*>> results;
+    results.swap(m_reloadJobs);
+    const bool current = m_reloadRate == m_streamRate.load(std::memory_order_acquire)
+                         && m_reloadBankSerial == m_bankSerial;
+    if (!current) {
+        for (auto& r : results)
+            delete r.second;
+        m_reloadSamplesRequested.store(true);
+        return;
+    }
+    m_bank.cancelStaged();   // an older set the callback has not taken yet
+    for (auto& r : results)
+        m_bank.stage(r.first, r.second);
+    if (m_running.load())
+        m_bank.publishStaged();
+    else
+        m_bank.installStaged();
 }
 
 void AudioEngine::requestScheduleChange(const std::vector<AudioPulseEvent>& pulses, double barLengthSeconds, int sampleRate) {
@@ -312,249 +544,536 @@ void AudioEngine::setPulseCallback(PulseCallback cb) {
     m_pulseCallback = cb;
 }
 
-void AudioEngine::emitUiPulse(const AudioPulseEvent& ev) {
-    // Stamp current run ID so the receiver can discard signals from old sessions.
-    AudioPulseEvent tagged = ev;
-    tagged.runId = m_runId.load();
-    emit pulseUiEvent(tagged);
-    if (m_pulseCallback) {
-        m_pulseCallback(ev);
+PulseRecord PulseRecord::fromEvent(const AudioPulseEvent& ev, int runId) {
+    PulseRecord r;
+    r.samplePos      = ev.samplePos;
+    r.audibleNs      = ev.audibleNs;
+    r.samplePosInBar = ev.samplePosInBar;
+    r.runId          = runId;
+    r.idx            = int16_t(ev.idx);
+    r.gridColumn     = int16_t(ev.gridColumn);
+    r.barNumber      = int16_t(ev.barNumber);
+    r.barsPerStep    = int16_t(ev.barsPerStep);
+    r.newTempo       = float(ev.newTempo);
+    r.flags          = uint8_t((ev.accent       ? Accent       : 0) |
+                               (ev.polyAccent   ? PolyAccent   : 0) |
+                               (ev.isBeat       ? IsBeat       : 0) |
+                               (ev.playPulse    ? PlayPulse    : 0) |
+                               (ev.isRest       ? IsRest       : 0) |
+                               (ev.startOfCycle ? StartOfCycle : 0) |
+                               (ev.isFirstInBar ? FirstInBar   : 0));
+    r.track          = uint8_t(ev.track);
+    return r;
+}
+
+AudioPulseEvent PulseRecord::toEvent() const {
+    AudioPulseEvent ev;
+    ev.samplePos      = samplePos;
+    ev.audibleNs      = audibleNs;
+    ev.idx            = idx;
+    ev.accent         = flags & Accent;
+    ev.polyAccent     = flags & PolyAccent;
+    ev.isBeat         = flags & IsBeat;
+    ev.playPulse      = flags & PlayPulse;
+    ev.isRest         = flags & IsRest;
+    ev.gridColumn     = gridColumn;
+    ev.samplePosInBar = samplePosInBar;
+    ev.startOfCycle   = flags & StartOfCycle;
+    ev.barNumber      = barNumber;
+    ev.barsPerStep    = barsPerStep;
+    ev.isFirstInBar   = flags & FirstInBar;
+    ev.newTempo       = newTempo;
+    ev.runId          = runId;
+    ev.track          = track;
+    return ev;
+}
+
+// Audio thread: stamp the current run ID (so the receiver can discard pulses
+// from old sessions) and the click's timing, and enqueue.  Never allocates or
+// blocks.
+void AudioEngine::emitUiPulse(const AudioPulseEvent& ev, int64_t samplePos, int64_t audibleNs) {
+    if (m_offline) return;
+    PulseRecord rec = PulseRecord::fromEvent(ev, m_runId.load(std::memory_order_relaxed));
+    rec.samplePos = samplePos;
+    rec.audibleNs = audibleNs;
+    m_pulseRing.push(rec);
+}
+
+// GUI thread: deliver everything the callback has queued since the last tick.
+void AudioEngine::drainPulseRing() {
+    m_rtLog.flush("AudioEngine:");
+    serviceSampleReload(false);
+    m_bank.reclaim();
+
+    PulseRecord rec;
+    bool received = false;
+    while (m_pulseRing.pop(rec)) {
+        m_presentQueue.push_back(rec);
+        received = true;
+    }
+    if (received && !m_presentTimer->isActive())
+        presentDuePulses();
+
+    quint64 overflows = m_pulseRing.overflowCount();
+    if (overflows != m_reportedPulseOverflows) {
+        qWarning() << "AudioEngine: pulse ring overflowed," << (overflows - m_reportedPulseOverflows)
+                   << "UI pulses dropped (total" << overflows << ")";
+        m_reportedPulseOverflows = overflows;
     }
 }
 
-PCMBuffer* AudioEngine::currentSample(bool accent) {
-    QString key = accent ? m_accentSample : m_clickSample;
-    QMutexLocker sampleLock(&m_sampleMutex);
-    if (!m_samples.contains(key)) return nullptr;
-    return &m_samples[key];
+// GUI thread: emit every queued pulse whose click is audible by now, then
+// sleep until the next one.  Records arrive in time order.
+void AudioEngine::presentDuePulses() {
+    using namespace std::chrono;
+    const int64_t now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    while (!m_presentQueue.empty()) {
+        const PulseRecord& rec = m_presentQueue.front();
+        if (rec.audibleNs != 0) {
+            const int64_t wait = rec.audibleNs + m_uiLatencyOffsetNs - now;
+            // Within half a millisecond is on time; beyond a second the stamp is bogus.
+            if (wait > 500000 && wait < kMaxPresentDelayNs) {
+                m_presentTimer->start(int((wait + 999999) / 1000000));
+                return;
+            }
+        }
+        AudioPulseEvent ev = rec.toEvent();
+        m_presentQueue.pop_front();
+        emit pulseUiEvent(ev);
+        if (m_pulseCallback) {
+            m_pulseCallback(ev);
+        }
+    }
 }
 
 void AudioEngine::stop() {
+    stopListening();
+    m_startAlignNs.store(0);
     if (!m_running.load()) return;
     m_running.store(false);
     if (m_deviceInitialized) {
         ma_device_stop(&m_device);
     }
+    stopProducer();
+    m_input.stopWorker();
+    m_pulseDrainTimer->stop();
+    m_pulseRing.clear();
+    m_presentTimer->stop();
+    m_presentQueue.clear();
     m_globalSamplePos = 0;
-    activeSamples.clear();
+    m_voices.clear();
     m_pendingScheduleSwapSamplePos = -1;
+    // Nothing is playing now: finish any reload and install it directly, and
+    // free every retired buffer.
+    serviceSampleReload(true);
+    m_bank.installStaged();
+    m_bank.reclaim(true);
+    if (m_outputConfigDirty)
+        closeDevice();
 }
 
 void AudioEngine::setBpm(double bpm) {
     // No-op, sample rate and scheduling handled elsewhere
 }
 
-void AudioEngine::miniAudioDataCallback(ma_device* pDevice, void* pOutput, const void* /*pInput*/, ma_uint32 frameCount) {
+void AudioEngine::miniAudioDataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
     AudioEngine* engine = reinterpret_cast<AudioEngine*>(pDevice->pUserData);
-    engine->doAudioCallback(reinterpret_cast<float*>(pOutput), frameCount);
+    const float* input  = static_cast<const float*>(pInput);   // duplex only: mono f32
+    if (pDevice->playback.format == ma_format_f32 && int(pDevice->playback.channels) == engine->m_mixChannels)
+        engine->doAudioCallback(reinterpret_cast<float*>(pOutput), frameCount, input);
+    else
+        engine->writeDeviceOutput(pOutput, input, frameCount);
+}
+
+// miniaudio notification (backend thread; on some backends the audio thread
+// itself).  Only raises a flag; drainPulseRing() looks at the device again.
+void AudioEngine::miniAudioNotificationCallback(const ma_device_notification* pNotification) {
+    if (pNotification->type != ma_device_notification_type_rerouted) return;
+    AudioEngine* engine = reinterpret_cast<AudioEngine*>(pNotification->pDevice->pUserData);
+    engine->m_deviceRerouted.store(true, std::memory_order_release);
+}
+
+// Audio thread, native-format devices: mix in chunks, pad the mix with silent
+// channels if the device has more than VoicePool::kMaxChannels and convert to
+// the device format.
+void AudioEngine::writeDeviceOutput(void* out, const float* in, unsigned frames) {
+    const ma_format format = m_device.playback.format;
+    const int channels     = int(m_device.playback.channels);
+    const int mixChannels  = m_mixChannels;
+    const int bytesPerSample = int(ma_get_bytes_per_sample(format));
+    const MixKernel& kernel  = m_voices.mixKernel();
+    auto* dst = static_cast<uint8_t*>(out);
+
+    const auto callbackStart = std::chrono::steady_clock::now();
+    m_chunkedOutput = true;
+    for (unsigned done = 0; done < frames; ) {
+        const int n = int(std::min<unsigned>(frames - done, kConvertChunkFrames));
+        doAudioCallback(m_mixScratch.data(), unsigned(n), in ? in + done : nullptr, done);
+
+        const float* src = m_mixScratch.data();
+        if (channels > mixChannels) {
+            float* wide = m_fanScratch.data();
+            for (int i = 0; i < n; ++i, src += mixChannels, wide += channels) {
+                std::copy(src, src + mixChannels, wide);
+                std::fill(wide + mixChannels, wide + channels, 0.0f);
+            }
+            src = m_fanScratch.data();
+        }
+        const int samples = n * channels;
+        switch (format) {
+        case ma_format_f32: std::memcpy(dst, src, size_t(samples) * sizeof(float)); break;
+        case ma_format_s16: kernel.toS16(reinterpret_cast<int16_t*>(dst), src, samples); break;
+        case ma_format_s32: kernel.toS32(reinterpret_cast<int32_t*>(dst), src, samples); break;
+        case ma_format_s24: convertToS24(dst, src, samples); break;
+        default:            std::memset(dst, 0, size_t(samples) * size_t(bytesPerSample)); break;
+        }
+        dst  += size_t(samples) * size_t(bytesPerSample);
+        done += unsigned(n);
+    }
+    m_chunkedOutput = false;
+    if (m_running.load())
+        recordCallback(callbackStart, frames);
 }
 
 // =============================================================================
 // FREE FUNCTION: buildBarSchedule
 // =============================================================================
-// Compute the pulse schedule for one bar given engine params.
+// Compute the pulse schedule for one bar of a track at the given tempo.
 // isCountIn = true  â†’ produce count-in beats (idx < 0) at the bar tempo
 // isCountIn = false â†’ produce normal subdivision / polyrhythm pulses
 // All samplePosInBar values are relative (0 = bar start).
 // This is the implementation for the declaration in audioengine.h.
 
-static int bbs_lcm(int a, int b) {
-    if (a == 0 || b == 0) return 0;
-    int x = a, y = b;
-    while (y != 0) { int t = y; y = x % y; x = t; }
-    return (a / x) * b;
+TickRate TickRate::of(double bpm, int sampleRate) {
+    TickRate r;
+    const int64_t tempo = std::llround(bpm * double(kTempoScale));
+    if (tempo <= 0 || sampleRate <= 0) return r;
+    // samples per tick = sampleRate * 60 / (bpm * kTicksPerBeat)
+    const int64_t num = int64_t(sampleRate) * 60 * kTempoScale;
+    const int64_t den = tempo * kTicksPerBeat;
+    const int64_t g   = std::gcd(num, den);
+    r.num = num / g;
+    r.den = den / g;
+    return r;
 }
 
-BarSchedule buildBarSchedule(const EngineParams& params, bool isCountIn, int sampleRate) {
-    BarSchedule result;
+int64_t BarClock::remIn(int64_t d) const {
+    if (d == den || rem == 0) return rem;
+    return std::min<int64_t>(d - 1, int64_t(double(rem) / double(den) * double(d)));
+}
 
-    bool compound      = (params.denominator == 8) &&
-                         (params.numerator % 3 == 0) &&
-                         (params.numerator > 3);
-    int  beatsPerBar   = compound ? (params.numerator / 3) : params.numerator;
-    double secPerBeat  = 60.0 / params.bpm;
-    int    smpPerBeat  = int(sampleRate * secPerBeat);
-    double barLenSec   = beatsPerBar * secPerBeat;
-    int    barLenSmp   = beatsPerBar * smpPerBeat;
+int64_t BarClock::at(int64_t offset, int64_t offsetDen) const {
+    return sample + (remIn(offsetDen) + offset) / offsetDen;
+}
 
-    // â”€â”€ COUNT-IN bar â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    if (isCountIn) {
-        int pulseCount = beatsPerBar;      // compound: dotted-quarter beats; simple: quarter beats
-        for (int i = 0; i < pulseCount; ++i) {
+void BarClock::advance(int64_t length, int64_t lengthDen) {
+    const int64_t total = remIn(lengthDen) + length;
+    sample += total / lengthDen;
+    rem     = total % lengthDen;
+    den     = lengthDen;
+}
+
+void BarClock::rescale(int fromRate, int toRate) {
+    const double pos = (double(sample) + double(rem) / double(den)) * toRate / fromRate;
+    sample = int64_t(std::floor(pos));
+    rem    = std::min<int64_t>(den - 1, int64_t((pos - double(sample)) * double(den)));
+}
+
+// The bar layouts buildBarSchedule knows.  classifyBar() picks one from the
+// params and each has its own generator below.
+enum class BarShape { CountIn, Polyrhythm, Standard, Custom };
+
+// Meter and tick length resolved once for a generator; place() records a
+// pulse at an exact offset (ticks * rate.num, in 1/rate.den samples).
+struct BarContext {
+    const BarParams& params;
+    TickRate     rate;
+    bool         compound;
+    int          beatsPerBar;
+    BarSchedule& out;
+
+    void place(const AudioPulseEvent& ev, int64_t offset) const {
+        out.pulses.push_back(ev);
+        out.pulses.back().samplePosInBar = int(offset / rate.den);
+        out.pulseOffsets.push_back(offset);
+    }
+    void setLength(int64_t ticks) const {
+        out.barTicks         = ticks;
+        out.barLength        = ticks * rate.num;
+        out.barLengthSamples = out.barLength / rate.den;
+    }
+};
+
+static BarShape classifyBar(const BarParams& params, bool isCountIn, bool compound) {
+    if (isCountIn)
+        return BarShape::CountIn;
+    if (params.polyrhythmEnabled && params.polyMain > 0 && params.polySecondary > 0)
+        return BarShape::Polyrhythm;
+
+    return isStandardPattern(params.subdivision, compound) ? BarShape::Standard : BarShape::Custom;
+}
+
+template <BarShape S> static void generateBar(const BarContext& c);
+
+// ── COUNT-IN bar ─────────────────────────────────────────────────────────────
+template <> void generateBar<BarShape::CountIn>(const BarContext& c) {
+    constexpr int64_t kBeat = TickRate::kTicksPerBeat;
+    int pulseCount = c.beatsPerBar;    // compound: dotted-quarter beats; simple: quarter beats
+    for (int i = 0; i < pulseCount; ++i) {
+        AudioPulseEvent ev;
+        ev.idx          = -1000 + i;
+        ev.accent       = (i == 0);
+        ev.polyAccent   = false;
+        ev.isBeat       = true;
+        ev.playPulse    = true;
+        ev.isRest       = false;
+        ev.gridColumn   = -1;
+        ev.startOfCycle = (i == 0);
+        c.place(ev, int64_t(i) * kBeat * c.rate.num);
+    }
+    c.setLength(int64_t(pulseCount) * kBeat);
+}
+
+// ── POLYRHYTHM bar ───────────────────────────────────────────────────────────
+template <> void generateBar<BarShape::Polyrhythm>(const BarContext& c) {
+    const int columns = polyrhythmColumns(c.params.polyMain, c.params.polySecondary);
+    const std::vector<PolyrhythmHit> hits =
+        polyrhythmHits(c.params.polyMain, c.params.polySecondary);
+
+    c.setLength(int64_t(c.beatsPerBar) * TickRate::kTicksPerBeat);
+    const int64_t perColumn = c.out.barLength / columns;
+    const int64_t leftover  = c.out.barLength % columns;
+    for (size_t idx = 0; idx < hits.size(); ++idx) {
+        const PolyrhythmHit& hit = hits[idx];
+        AudioPulseEvent ev;
+        ev.idx          = int(idx);
+        ev.gridColumn   = hit.column;
+        ev.isBeat       = (hit.isMain && idx == 0);
+        ev.accent       = hit.isMain;
+        ev.polyAccent   = hit.isPoly;
+        ev.playPulse    = true;
+        ev.isRest       = false;
+        ev.startOfCycle = (idx == 0);
+        c.place(ev, hit.column * perColumn + hit.column * leftover / columns);
+    }
+}
+
+// ── STANDARD bar: the pattern repeats once per beat ──────────────────────────
+template <> void generateBar<BarShape::Standard>(const BarContext& c) {
+    constexpr int64_t kBeat = TickRate::kTicksPerBeat;
+    const SubdivisionPattern& pat = c.params.subdivision;
+    const int subdivs = int(pat.pulses.size());
+
+    for (int b = 0; b < c.beatsPerBar; ++b) {
+        int64_t tick = int64_t(b) * kBeat;
+        for (int s = 0; s < subdivs; ++s) {
             AudioPulseEvent ev;
-            ev.idx          = -1000 + i;
-            ev.accent       = (i == 0);
-            ev.polyAccent   = false;
-            ev.isBeat       = true;
-            ev.playPulse    = true;
-            ev.isRest       = false;
+            ev.idx          = b * subdivs + s;
             ev.gridColumn   = -1;
-            ev.samplePosInBar = i * smpPerBeat;
-            ev.startOfCycle = (i == 0);
-            result.pulses.push_back(ev);
+            ev.isBeat       = (s == 0);
+            ev.accent       = (s == 0 && int(c.params.accents.size()) > b && c.params.accents[b]);
+            ev.polyAccent   = false;
+            ev.isRest       = pat.pulses[s].isRest;
+            ev.playPulse    = !ev.isRest;
+            ev.startOfCycle = (b == 0 && s == 0);
+            c.place(ev, tick * c.rate.num);
+            tick += noteValueTicks(pat.pulses[s].noteValue, c.compound);
         }
-        result.barLengthSamples = int64_t(pulseCount) * smpPerBeat;
-        return result;
     }
+    c.setLength(int64_t(c.beatsPerBar) * kBeat);
+}
 
-    // â”€â”€ POLYRHYTHM bar â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    if (params.polyrhythmEnabled &&
-        params.polyMain > 0 && params.polySecondary > 0)
-    {
-        int mainBeats = params.polyMain;
-        int polyBeats = params.polySecondary;
-        int columns   = bbs_lcm(mainBeats, polyBeats);
-
-        struct PI { double time; int col; bool isMain, isPoly; };
-        std::vector<PI> pulses;
-        for (int i = 0; i < mainBeats; ++i) {
-            double t = i * barLenSec / mainBeats;
-            int col  = int(std::round(t / barLenSec * columns));
-            pulses.push_back({t, col, true, false});
-        }
-        for (int i = 0; i < polyBeats; ++i) {
-            double t = i * barLenSec / polyBeats;
-            int col  = int(std::round(t / barLenSec * columns));
-            pulses.push_back({t, col, false, true});
+// ── CUSTOM bar: one pass of a variable-length pattern fills the "bar" ────────
+template <> void generateBar<BarShape::Custom>(const BarContext& c) {
+    constexpr int64_t kBeat = TickRate::kTicksPerBeat;
+    const SubdivisionPattern& pat = c.params.subdivision;
+
+    int64_t tick = 0;
+    for (int s = 0; s < int(pat.pulses.size()); ++s) {
+        const auto& p = pat.pulses[s];
+        AudioPulseEvent ev;
+        ev.idx          = s;
+        ev.gridColumn   = -1;
+        ev.isBeat       = (s == 0) || (tick % kBeat == 0 && tick / kBeat < c.beatsPerBar);
+        ev.accent       = p.accent;
+        ev.polyAccent   = false;
+        ev.isRest       = p.isRest;
+        ev.playPulse    = !ev.isRest;
+        ev.startOfCycle = (s == 0);
+        c.place(ev, tick * c.rate.num);
+        tick += noteValueTicks(p.noteValue, c.compound);
+    }
+    c.setLength(tick);
+}
+
+// Resolve each pulse to sample-bank IDs, so the audio thread never has to
+// decide which sound a pulse plays.
+static void assignSounds(BarSchedule& bar, const SoundRouting& r, bool isCountIn)
+{
+    const int subdivision = (r.subdivision >= 0) ? r.subdivision : r.click;
+    const int polyAccent  = (r.polyAccent  >= 0) ? r.polyAccent  : r.click;
+
+    for (AudioPulseEvent& ev : bar.pulses) {
+        ev.soundId      = -1;
+        ev.layerSoundId = -1;
+        if (ev.isRest) {
+            ev.soundId = r.ghost;
+            continue;
         }
-        std::sort(pulses.begin(), pulses.end(),
-                  [](const PI& a, const PI& b){ return a.time < b.time; });
-
-        // Merge coincident pulses
-        std::vector<PI> merged;
-        const double eps = 1e-6;
-        for (const auto& pi : pulses) {
-            if (!merged.empty() && std::abs(pi.time - merged.back().time) < eps) {
-                merged.back().isMain |= pi.isMain;
-                merged.back().isPoly |= pi.isPoly;
-            } else {
-                merged.push_back(pi);
-            }
+        if (!ev.playPulse) continue;
+
+        if (isCountIn) {
+            ev.soundId = (r.countIn >= 0) ? r.countIn : (ev.accent ? r.accent : r.click);
+        } else if (ev.accent) {
+            ev.soundId = r.accent;
+            if (ev.polyAccent && r.polyAccent >= 0)
+                ev.layerSoundId = r.polyAccent;          // both polyrhythm layers land here
+            else if (r.stackClickUnderAccent)
+                ev.layerSoundId = r.click;
+        } else if (ev.polyAccent) {
+            ev.soundId = polyAccent;
+        } else if (ev.gridColumn < 0 && !ev.isBeat) {
+            ev.soundId = subdivision;
+        } else {
+            ev.soundId = r.click;
         }
+        if (ev.layerSoundId == ev.soundId)
+            ev.layerSoundId = -1;
+    }
+}
 
-        for (size_t idx = 0; idx < merged.size(); ++idx) {
-            const auto& pi = merged[idx];
-            AudioPulseEvent ev;
-            ev.idx          = int(idx);
-            ev.gridColumn   = pi.col;
-            ev.isBeat       = (pi.isMain && idx == 0);
-            ev.accent       = pi.isMain;
-            ev.polyAccent   = pi.isPoly;
-            ev.playPulse    = true;
-            ev.isRest       = false;
-            ev.samplePosInBar = int(std::round(pi.time * sampleRate));
-            ev.startOfCycle = (idx == 0);
-            result.pulses.push_back(ev);
-        }
-        result.barLengthSamples = barLenSmp;
-        return result;
-    }
-
-    // â”€â”€ SUBDIVISION bar â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    const SubdivisionPattern& pat = params.subdivision;
-    int subdivs = int(pat.pulses.size());
-    if (subdivs == 0) subdivs = 1;
-
-    double totalPatternDuration = 0.0;
-    for (const auto& p : pat.pulses)
-        totalPatternDuration += noteValueBeatFraction(p.noteValue, compound);
-
-    const double TOLERANCE = 1e-3;
-    bool isStandard = false;
-    if (pat.category == SubdivisionCategory::Custom) {
-        isStandard = false;
-    } else if (compound && pat.pulses.size() == 1 &&
-               std::abs(noteValueBeatFraction(pat.pulses[0].noteValue, compound) - 1.0) < TOLERANCE) {
-        isStandard = true;
-    } else {
-        isStandard = (std::abs(totalPatternDuration - 1.0) < TOLERANCE);
-    }
-
-    if (isStandard) {
-        // Standard: repeat pattern once per beat
-        for (int b = 0; b < beatsPerBar; ++b) {
-            double beatStartSec  = b * secPerBeat;
-            double pulseOffsetSec = 0.0;
-            for (int s = 0; s < subdivs; ++s) {
-                AudioPulseEvent ev;
-                ev.idx        = b * subdivs + s;
-                ev.gridColumn = -1;
-                ev.isBeat     = (s == 0);
-                if (pat.category == SubdivisionCategory::Custom)
-                    ev.accent = pat.pulses[s].accent;
-                else
-                    ev.accent = (s == 0 && int(params.accents.size()) > b && params.accents[b]);
-                ev.polyAccent   = false;
-                ev.isRest       = pat.pulses[s].isRest;
-                ev.playPulse    = !ev.isRest;
-                double dur      = secPerBeat * noteValueBeatFraction(pat.pulses[s].noteValue, compound);
-                ev.samplePosInBar = int(std::round((beatStartSec + pulseOffsetSec) * sampleRate));
-                ev.startOfCycle = (b == 0 && s == 0);
-                pulseOffsetSec += dur;
-                result.pulses.push_back(ev);
-            }
+BarSchedule buildBarSchedule(const BarParams& params, double bpm, bool isCountIn, int sampleRate) {
+    BarSchedule result;
+    const TickRate rate = TickRate::of(bpm, sampleRate);
+    if (rate.num == 0) return result;
+    result.timeDen = rate.den;
+
+    const bool compound = (params.denominator == 8) &&
+                          (params.numerator % 3 == 0) &&
+                          (params.numerator > 3);
+    const BarContext c{params, rate, compound,
+                       compound ? (params.numerator / 3) : params.numerator, result};
+    switch (classifyBar(params, isCountIn, compound)) {
+    case BarShape::CountIn:    generateBar<BarShape::CountIn>(c);    break;
+    case BarShape::Polyrhythm: generateBar<BarShape::Polyrhythm>(c); break;
+    case BarShape::Standard:   generateBar<BarShape::Standard>(c);   break;
+    case BarShape::Custom:     generateBar<BarShape::Custom>(c);     break;
+    }
+    assignSounds(result, params.sounds, isCountIn);
+    return result;
+}
+
+// =============================================================================
+// BarScheduleCache
+// =============================================================================
+
+BarScheduleCache::BarScheduleCache() {
+    m_entries.reserve(kCapacity);
+}
+
+// Everything buildBarSchedule reads, flattened.  m_key keeps its capacity, so
+// a lookup does not allocate once the longest pattern has been seen.
+uint64_t BarScheduleCache::makeKey(const BarParams& p, double bpm, bool isCountIn, int sampleRate) {
+    m_key.clear();
+    m_key.push_back(std::llround(bpm * double(TickRate::kTempoScale)));
+    m_key.push_back(sampleRate);
+    m_key.push_back(isCountIn ? 1 : 0);
+    m_key.push_back(p.numerator);
+    m_key.push_back(p.denominator);
+    m_key.push_back(p.polyrhythmEnabled ? p.polyMain : 0);
+    m_key.push_back(p.polyrhythmEnabled ? p.polySecondary : 0);
+    const SoundRouting& s = p.sounds;
+    m_key.push_back(s.accent);
+    m_key.push_back(s.click);
+    m_key.push_back(s.polyAccent);
+    m_key.push_back(s.subdivision);
+    m_key.push_back(s.ghost);
+    m_key.push_back(s.countIn);
+    m_key.push_back(s.stackClickUnderAccent ? 1 : 0);
+    m_key.push_back(int(p.subdivision.category));
+    m_key.push_back(p.subdivision.pulses.size());
+    for (const SubdivisionPulse& pulse : p.subdivision.pulses)
+        m_key.push_back(int64_t(pulse.noteValue) << 2 | (pulse.isRest ? 2 : 0) | (pulse.accent ? 1 : 0));
+    m_key.push_back(int64_t(p.accents.size()));
+    for (bool a : p.accents)
+        m_key.push_back(a ? 1 : 0);
+
+    uint64_t h = 14695981039346656037ull;   // FNV-1a
+    for (int64_t v : m_key) {
+        h ^= uint64_t(v);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+const BarSchedule& BarScheduleCache::get(const BarParams& params, double bpm,
+                                         bool isCountIn, int sampleRate) {
+    const uint64_t hash = makeKey(params, bpm, isCountIn, sampleRate);
+    ++m_useClock;
+    for (Entry& e : m_entries) {
+        if (e.hash == hash && e.key == m_key) {
+            e.lastUse = m_useClock;
+            ++m_hits;
+            return e.bar;
         }
-        result.barLengthSamples = barLenSmp;
+    }
+
+    ++m_misses;
+    Entry* slot;
+    if (m_entries.size() < kCapacity) {
+        m_entries.emplace_back();
+        slot = &m_entries.back();
     } else {
-        // Custom / variable-length pattern fills one "bar"
-        double actualDurSec = 0.0;
-        for (const auto& p : pat.pulses)
-            actualDurSec += noteValueBeatFraction(p.noteValue, compound) * secPerBeat;
-
-        std::vector<double> beatStartTimes;
-        for (int b = 0; b < beatsPerBar; ++b)
-            beatStartTimes.push_back(b * secPerBeat);
-
-        double pulseOffsetSec = 0.0;
-        for (int s = 0; s < int(pat.pulses.size()); ++s) {
-            const auto& p = pat.pulses[s];
-            AudioPulseEvent ev;
-            ev.idx        = s;
-            ev.gridColumn = -1;
-            ev.isBeat     = false;
-            double pulseStartSec = pulseOffsetSec;
-            for (int b = 0; b < beatsPerBar; ++b) {
-                if (std::abs(pulseStartSec - beatStartTimes[b]) < 1e-6) {
-                    ev.isBeat = true;
-                    break;
-                }
-            }
-            ev.accent       = p.accent;
-            ev.isBeat       = (s == 0) ? true : ev.isBeat;
-            ev.polyAccent   = false;
-            ev.isRest       = p.isRest;
-            ev.playPulse    = !ev.isRest;
-            double dur      = secPerBeat * noteValueBeatFraction(p.noteValue, compound);
-            ev.samplePosInBar = int(std::round(pulseOffsetSec * sampleRate));
-            ev.startOfCycle = (s == 0);
-            pulseOffsetSec += dur;
-            result.pulses.push_back(ev);
-        }
-        result.barLengthSamples = int64_t(std::round(actualDurSec * sampleRate));
+        slot = &*std::min_element(m_entries.begin(), m_entries.end(),
+                                  [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
     }
-    return result;
+    slot->hash    = hash;
+    slot->key     = m_key;
+    slot->bar     = buildBarSchedule(params, bpm, isCountIn, sampleRate);
+    slot->lastUse = m_useClock;
+    return slot->bar;
+}
+
+void BarScheduleCache::clear() {
+    m_entries.clear();
 }
 
 // =============================================================================
 // NEW BAR-ADVANCE STATE MACHINE
 // =============================================================================
 
-// resetStateMachine â€” called under m_schedMutex from startWithParams().
-void AudioEngine::resetStateMachine(const EngineParams& p, bool withCountIn)
+// Tracks beyond kMaxTracks are ignored.
+static size_t playedTracks(const EngineParams& p) {
+    return std::min<size_t>(p.tracks.size(), EngineParams::kMaxTracks);
+}
+
+// resetStateMachine â€” called from startWithParams() while the device is
+// stopped, so it may act as the params reader on the caller's thread.
+void AudioEngine::resetStateMachine(bool withCountIn)
 {
-    m_engineParams         = p;
-    m_currentTempo         = p.bpm;
+    m_paramsBuffer.update();
+    m_currentTempo         = m_paramsBuffer.read().bpm;
     m_paramsChanged        = false;
-    m_scheduledPulses.clear();
-    activeSamples.clear();
+    m_eventQueue.clear();
+    m_mainCursor    = BarCursor();
+    m_lastBarLength = 0;
+    m_producerRate  = m_sampleRate;
+    m_streamRate.store(m_sampleRate);
+    m_voices.clear();
     m_barNumberForUi          = 0;
-    m_playingBarSamplesAccum  = 0;
+    m_playingBarTicksAccum    = 0;
     m_pendingStepUpTempoForTag = 0;  // never carry a stale step-up into a new session
+    m_playheadResetTo.store(kNoPlayheadReset);
+    m_clearVoicesRequested.store(false);
+    m_tracks.clear();
+    m_tracks.resize(playedTracks(m_paramsBuffer.read()));
+    m_trackTempo = 0;
 
     // Pre-roll: one buffer period of silence so the hardware audio session
     // has time to open cleanly before the first beat fires.
-    m_globalSamplePos = -(int64_t)m_bufferFrames;
-    m_nextBarStart    = 0;  // first bar starts at sample 0
+    m_globalSamplePos = -int64_t(m_bufferFrames.load());
+    m_nextBar.reset();      // first bar starts at sample 0
+    m_producerEpoch = m_timelineEpoch.load();
 
     if (withCountIn) {
         m_playState       = EnginePlayState::CountIn;
@@ -564,44 +1083,63 @@ void AudioEngine::resetStateMachine(const EngineParams& p, bool withCountIn)
         m_countInBarsLeft = 0;
     }
 
-    // Pre-generate the first bar so events are ready before playback starts.
-    advanceNextBar();
+    m_playheadPos.store(m_globalSamplePos);
 }
 
-// advanceNextBar â€” called under m_schedMutex.
-// Generates the NEXT bar's events and appends them to m_scheduledPulses.
+// pickUpEngineParams — producer thread.  Adopts the newest snapshot published by
+// setEngineParams(); wait-free, and no copy of EngineParams is made.
+void AudioEngine::pickUpEngineParams()
+{
+    if (!m_paramsBuffer.update()) return;
+    const EngineParams& p = m_paramsBuffer.read();
+    m_paramsChanged = true;
+    // Sync m_currentTempo so tempo changes take effect at the next bar
+    // when the speed trainer is not actively stepping up.
+    if (!p.speedEnabled)
+        m_currentTempo = p.bpm;
+    // Adding or removing tracks restarts all of them at the next main bar line.
+    if (playedTracks(p) != m_tracks.size()) {
+        m_tracks.clear();
+        m_tracks.resize(playedTracks(p));
+    }
+}
+
+// advanceNextBar â€” producer thread (or startWithParams() while stopped).
+// Generates the NEXT main bar into m_mainCursor, for queuePendingPulses() to
+// queue.  Call it only once everything before the bar line has been queued.
+// Returns false if there is no bar (idle or zero-length bar).
 // Also applies the post-generation state transition (count-inâ†’playing,
 // speed-trainer step-up) that affects the bar AFTER the one just generated.
-void AudioEngine::advanceNextBar()
+bool AudioEngine::advanceNextBar()
 {
-    if (m_playState == EnginePlayState::Idle) return;
+    if (m_playState == EnginePlayState::Idle) return false;
 
     bool isCountIn = (m_playState == EnginePlayState::CountIn);
 
-    // Build the bar schedule using current tempo.
-    EngineParams p = m_engineParams;
-    p.bpm = m_currentTempo;
-    BarSchedule bar = buildBarSchedule(p, isCountIn, m_sampleRate);
-    if (bar.barLengthSamples <= 0) return;
-
-    // Tag and append events with absolute sample positions.
-    bool firstPulse = true;
-    for (AudioPulseEvent ev : bar.pulses) {
-        ev.barNumber    = m_barNumberForUi;
-        ev.barsPerStep  = m_engineParams.barsPerStep;
-        ev.isFirstInBar = firstPulse;
-        // Tag the new tempo on the very first pulse of the first post-step-up bar.
-        // This fires on the main thread exactly when that audio plays — not 2 s early.
-        if (firstPulse && m_pendingStepUpTempoForTag > 0) {
-            ev.newTempo = m_pendingStepUpTempoForTag;
-            m_pendingStepUpTempoForTag = 0;
-        }
-        firstPulse      = false;
-        int64_t absPos  = m_nextBarStart + int64_t(ev.samplePosInBar);
-        m_scheduledPulses.push_back({absPos, ev});
+    // Compiled bar for the current tempo; built only on a cache miss.
+    const EngineParams& params = m_paramsBuffer.read();
+    const BarSchedule& bar = m_barCache.get(params, m_currentTempo, isCountIn, m_producerRate);
+    if (bar.barLengthSamples <= 0) return false;
+
+    syncTracks(isCountIn);
+
+    BarCursor& c  = m_mainCursor;
+    c.bar         = &bar;
+    c.next        = 0;
+    c.start       = m_nextBar;
+    c.rate        = m_producerRate;
+    c.barNumber   = m_barNumberForUi;
+    c.barsPerStep = params.barsPerStep;
+    c.newTempo    = 0;
+    // Tag the new tempo on the very first pulse of the first post-step-up bar.
+    // This fires on the main thread exactly when that audio plays — not 2 s early.
+    if (!bar.pulses.empty()) {
+        c.newTempo = m_pendingStepUpTempoForTag;
+        m_pendingStepUpTempoForTag = 0;
     }
 
-    m_nextBarStart += bar.barLengthSamples;
+    m_lastBarLength = bar.barLengthSamples;
+    m_nextBar.advance(bar.barLength, bar.timeDen);
     m_barNumberForUi++;
 
     // â”€â”€ Post-generation state transition â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
@@ -609,198 +1147,565 @@ void AudioEngine::advanceNextBar()
         m_countInBarsLeft--;
         if (m_countInBarsLeft <= 0) {
             m_playState              = EnginePlayState::Playing;
-            m_playingBarSamplesAccum = 0;
+            m_playingBarTicksAccum   = 0;
             m_barNumberForUi         = 0;  // bar counter restarts when main playing begins
         }
     } else {
         // Playing bar just generated -- check speed trainer step-up.
-        bool cpd2    = (p.denominator == 8) && (p.numerator % 3 == 0) && (p.numerator > 3);
-        int  bpbFull = cpd2 ? (p.numerator / 3) : p.numerator;
+        bool cpd2    = (params.denominator == 8) && (params.numerator % 3 == 0) && (params.numerator > 3);
+        int  bpbFull = cpd2 ? (params.numerator / 3) : params.numerator;
 
-        bool isCustomBarPath = (!p.polyrhythmEnabled &&
-                                p.subdivision.category == SubdivisionCategory::Custom);
+        bool isCustomBarPath = (!params.polyrhythmEnabled &&
+                                params.subdivision.category == SubdivisionCategory::Custom);
 
         int64_t target;
         if (isCustomBarPath) {
             // For custom patterns: count playthroughs. One full cycle of the
             // beat indicator (bpb playthroughs) = 1 bar for speed trainer.
             // barsPerStep=1 means all 4 big circles complete once before step-up.
-            m_playingBarSamplesAccum++;
-            target = int64_t(m_engineParams.barsPerStep) * int64_t(bpbFull);
+            m_playingBarTicksAccum++;
+            target = int64_t(params.barsPerStep) * int64_t(bpbFull);
         } else {
-            // Standard/polyrhythm: accumulate actual sample duration.
-            m_playingBarSamplesAccum += bar.barLengthSamples;
-            int64_t smpPerFullBar = int64_t(bpbFull) *
-                                    int64_t(double(m_sampleRate) * 60.0 / double(p.bpm));
-            target = int64_t(m_engineParams.barsPerStep) * smpPerFullBar;
+            // Standard/polyrhythm: accumulate exact bar duration in beat ticks.
+            m_playingBarTicksAccum += bar.barTicks;
+            target = int64_t(params.barsPerStep) * int64_t(bpbFull) * TickRate::kTicksPerBeat;
         }
 
-        if (m_engineParams.speedEnabled
-            && m_currentTempo < m_engineParams.maxTempo
+        if (params.speedEnabled
+            && m_currentTempo < params.maxTempo
             && target > 0
-            && m_playingBarSamplesAccum >= target)
+            && m_playingBarTicksAccum >= target)
         {
-            int newTempo = qMin(m_currentTempo + m_engineParams.tempoStep,
-                                m_engineParams.maxTempo);
+            double newTempo = qMin(m_currentTempo + params.tempoStep,
+                                   params.maxTempo);
             m_currentTempo           = newTempo;
-            m_playingBarSamplesAccum = 0;
+            m_playingBarTicksAccum   = 0;
             m_barNumberForUi         = 0;
 
             // Tag the new tempo on the FIRST PULSE of the next bar so the main
             // thread learns about the step-up exactly when that audio plays.
             m_pendingStepUpTempoForTag = newTempo;
 
-            if (m_engineParams.countInEnabled) {
+            if (params.countInEnabled) {
                 m_playState       = EnginePlayState::CountIn;
                 m_countInBarsLeft = 1;
             }
         }
     }
+    return true;
+}
+
+// syncTracks — producer thread, on the main bar line about to be generated.
+// Tracks rest through count-in bars, and start on the first playing bar line
+// and again on the first one at a new tempo.  Everything before the bar line
+// is queued by now, so a restarted track's pending pulses all lie past it and
+// are dropped.
+void AudioEngine::syncTracks(bool isCountIn)
+{
+    const bool newTempo = (m_currentTempo != m_trackTempo);
+    for (TrackState& t : m_tracks) {
+        if (!isCountIn && t.playing && !newTempo) continue;
+        t.cursor    = BarCursor();
+        t.playing   = !isCountIn;
+        t.nextBar   = m_nextBar;
+        t.barNumber = 0;
+    }
+    if (!isCountIn)
+        m_trackTempo = m_currentTempo;
+}
+
+// advanceTrackBar — producer thread.  Compiles the track's next bar into its
+// cursor.  A track with nothing to play at this tempo stops until the next
+// restart.
+void AudioEngine::advanceTrackBar(TrackState& t, const TrackParams& params, int track)
+{
+    const BarSchedule& bar = t.cache.get(params, m_trackTempo, false, m_producerRate);
+    if (bar.barLength <= 0) {
+        t.playing = false;
+        return;
+    }
+    BarCursor& c = t.cursor;
+    c.bar       = &bar;
+    c.next      = 0;
+    c.start     = t.nextBar;
+    c.rate      = m_producerRate;
+    c.track     = track;
+    c.gain      = params.gain;
+    c.barNumber = t.barNumber++;
+    t.nextBar.advance(bar.barLength, bar.timeDen);
+}
+
+void AudioEngine::queuePulse(BarCursor& c)
+{
+    AudioPulseEvent ev = c.bar->pulses[c.next];
+    ev.track        = c.track;
+    ev.barNumber    = c.barNumber;
+    ev.barsPerStep  = c.barsPerStep;
+    ev.isFirstInBar = (c.next == 0);
+    if (c.next == 0)
+        ev.newTempo = c.newTempo;
+    m_eventQueue.push({c.nextPos(), c.rate, c.gain, m_producerEpoch, ev});
+    ++c.next;
+}
+
+// queuePendingPulses — producer thread (or the offline renderer).  Queues
+// every pending pulse of the main bar and the tracks that falls before the
+// end of the last main bar, earliest first and the main bar first on a tie,
+// compiling track bars as they are reached.  Returns false if the queue
+// filled up first; the rest waits in the cursors for the next call.
+bool AudioEngine::queuePendingPulses()
+{
+    const int64_t until = m_nextBar.sample;
+    const EngineParams& params = m_paramsBuffer.read();
+    // Cursors keep the rate their bar was built at, as queued events do.
+    auto posOf = [this](const BarCursor& c) {
+        const int64_t pos = c.nextPos();
+        return c.rate == m_producerRate ? pos
+             : int64_t(std::round(double(pos) * m_producerRate / c.rate));
+    };
+
+    for (;;) {
+        BarCursor* first    = nullptr;
+        int64_t    firstPos = until;
+        if (m_mainCursor.pending() && posOf(m_mainCursor) < firstPos) {
+            first    = &m_mainCursor;
+            firstPos = posOf(m_mainCursor);
+        }
+        for (size_t i = 0; i < m_tracks.size(); ++i) {
+            TrackState& t = m_tracks[i];
+            while (t.playing && !t.cursor.pending() && t.nextBar.sample < until)
+                advanceTrackBar(t, params.tracks[i], int(i) + 1);
+            if (!t.cursor.pending()) continue;
+            const int64_t pos = posOf(t.cursor);
+            if (pos < firstPos) {
+                first    = &t.cursor;
+                firstPos = pos;
+            }
+        }
+        if (!first) break;
+        if (m_eventQueue.freeSpace() == 0) return false;
+        queuePulse(*first);
+    }
+    m_producedUntil.store(until, std::memory_order_release);
+    return true;
+}
+
+// produceBars — producer thread (or startWithParams() while stopped).
+// Keeps the queue kProducerBarsAhead bars, and at least kMinLeadMs, ahead of
+// the playhead, then tops it up to kLookaheadEvents within kMaxLookaheadMs.
+void AudioEngine::produceBars(int64_t playhead)
+{
+    pickUpEngineParams();
+
+    // The callback has restarted the timeline: what is queued is dropped, and
+    // bars are built again from sample 0.
+    const uint32_t epoch = m_timelineEpoch.load(std::memory_order_acquire);
+    if (epoch != m_producerEpoch) {
+        m_producerEpoch = epoch;
+        restartTimeline();
+    }
+
+    // The callback has moved to a new device rate: re-express our position in
+    // it.  Events already queued carry their own rate and are rescaled on read.
+    int rate = m_streamRate.load(std::memory_order_acquire);
+    if (rate > 0 && rate != m_producerRate) {
+        m_nextBar.rescale(m_producerRate, rate);
+        for (TrackState& t : m_tracks)
+            t.nextBar.rescale(m_producerRate, rate);
+        m_producerRate = rate;
+    }
+
+    int64_t minLead = std::max<int64_t>(int64_t(m_producerRate) * kMinLeadMs / 1000,
+                                        4 * int64_t(m_bufferFrames.load(std::memory_order_relaxed)));
+    int64_t required = playhead + std::max<int64_t>(m_lastBarLength * kProducerBarsAhead, minLead);
+    int64_t horizon  = playhead + int64_t(m_producerRate) * kMaxLookaheadMs / 1000;
+    while (queuePendingPulses() &&   // false: queue full
+           (m_nextBar.sample < required ||
+            (m_eventQueue.size() < kLookaheadEvents && m_nextBar.sample < horizon))) {
+        if (!advanceNextBar()) break;  // idle or zero-length bar
+    }
+}
+
+// restartTimeline — producer thread.  The bar in progress is abandoned; the
+// next one starts at sample 0 and the tracks wait for its bar line.
+void AudioEngine::restartTimeline()
+{
+    m_mainCursor    = BarCursor();
+    m_lastBarLength = 0;
+    m_nextBar.reset();
+    for (TrackState& t : m_tracks) {
+        t.cursor  = BarCursor();
+        t.nextBar.reset();
+        t.playing = false;
+    }
+    const int rate = m_streamRate.load(std::memory_order_acquire);
+    if (rate > 0)
+        m_producerRate = rate;
+    m_producedUntil.store(0, std::memory_order_release);
+}
+
+void AudioEngine::producerLoop()
+{
+    while (m_producerRunning.load(std::memory_order_acquire)) {
+        produceBars(m_playheadPos.load(std::memory_order_acquire));
+
+        QMutexLocker lock(&m_producerMutex);
+        if (m_producerRunning.load(std::memory_order_acquire))
+            m_producerWake.wait(&m_producerMutex, kProducerPollMs);
+    }
+}
+
+void AudioEngine::startProducer()
+{
+    if (m_producerThread) return;
+    m_producerRunning.store(true);
+    m_producerThread = QThread::create([this] { producerLoop(); });
+    m_producerThread->setObjectName(QStringLiteral("AudioEngine bar producer"));
+    m_producerThread->start(QThread::HighPriority);
+}
+
+void AudioEngine::stopProducer()
+{
+    if (!m_producerThread) return;
+    {
+        QMutexLocker lock(&m_producerMutex);
+        m_producerRunning.store(false);
+        m_producerWake.wakeAll();
+    }
+    m_producerThread->wait();
+    delete m_producerThread;
+    m_producerThread = nullptr;
 }
 
-// setEngineParams â€” safe to call from main thread while running.
-// Changes take effect at the next bar boundary.
+// setEngineParams — safe to call from any thread while running.
+// Changes take effect at the next bar boundary.  Only writers contend on
+// m_paramsWriteMutex; the producer thread reads the snapshot lock-free.
 void AudioEngine::setEngineParams(const EngineParams& p)
 {
-    QMutexLocker lock(&m_schedMutex);
-    m_engineParams  = p;
-    m_paramsChanged = true;
-    // Sync m_currentTempo so tempo changes take effect at the next bar
-    // when the speed trainer is not actively stepping up.
-    if (!p.speedEnabled)
-        m_currentTempo = p.bpm;
+    {
+        QMutexLocker lock(&m_paramsWriteMutex);
+        m_paramsBuffer.publish(p);
+    }
+    QMutexLocker wakeLock(&m_producerMutex);
+    m_producerWake.wakeAll();
 }
 
 // startWithParams â€” stops any current playback and restarts with new params.
 void AudioEngine::startWithParams(const EngineParams& p, bool withCountIn)
 {
-    // Stop the device while we reset state (outside m_schedMutex to avoid deadlock).
+    // Stop the device and the producer while we reset state.  ma_device_stop()
+    // returns only after the callback has finished, so the reset below cannot
+    // race either of them.
+    stopListening();
     if (m_running.load()) {
         m_running.store(false);
         if (m_deviceInitialized)
             ma_device_stop(&m_device);
     }
+    stopProducer();
+    m_input.stopWorker();
 
     {
-        QMutexLocker lock(&m_schedMutex);
-        resetStateMachine(p, withCountIn);
+        QMutexLocker lock(&m_paramsWriteMutex);
+        m_paramsBuffer.publish(p);
+        resetStateMachine(withCountIn);
     }
+    // Pre-generate the opening bars so events are ready before playback starts.
+    produceBars(m_globalSamplePos);
 
     // Increment run ID so any queued pulseUiEvent signals from the old session
     // carry a stale ID and will be discarded by MetronomeEngine::onAudioPulse.
     m_runId.fetch_add(1);
 
+    // The callback is stopped, so the GUI thread may reset the ring it consumes.
+    m_pulseRing.clear();
+    m_presentTimer->stop();
+    m_presentQueue.clear();
+    m_input.reset();
+
     if (!m_deviceInitialized) return;
     m_running.store(true);
+    startProducer();
+    if (m_input.isEnabled())
+        m_input.startWorker();
+    m_pulseDrainTimer->start();
     ma_device_start(&m_device);
 }
 
+// =============================================================================
+// OFFLINE RENDERING  (caller's thread; same state machine and callback)
+// =============================================================================
+void AudioEngine::prepareOffline(int sampleRate, int bufferFrames, int channels)
+{
+    stop();
+    m_offline      = true;
+    m_sampleRate   = sampleRate;
+    m_bufferFrames = bufferFrames;
+    m_mixChannels  = std::clamp(channels, 1, VoicePool::kMaxChannels);
+}
+
+void AudioEngine::startOffline(const EngineParams& p, bool withCountIn)
+{
+    {
+        QMutexLocker lock(&m_paramsWriteMutex);
+        m_paramsBuffer.publish(p);
+        resetStateMachine(withCountIn);
+    }
+    m_globalSamplePos = 0;   // no device to warm up, so no pre-roll
+    m_input.reset();
+    m_running.store(true);
+}
+
+bool AudioEngine::renderOfflineBar(SampleVector& out, OfflineBar* info)
+{
+    if (!m_offline || !m_running.load()) return false;
+
+    // New params take effect at bar boundaries, exactly as on the producer.
+    pickUpEngineParams();
+    const bool    countIn = (m_playState == EnginePlayState::CountIn);
+    const double  tempo   = m_currentTempo;
+    const int64_t start   = m_nextBar.sample;
+    queuePendingPulses();
+    if (!advanceNextBar()) return false;
+    const int64_t frames = m_nextBar.sample - start;
+
+    const size_t ch  = size_t(m_mixChannels);
+    const size_t pos = out.size();
+    out.resize(pos + size_t(frames) * ch);
+    for (int64_t done = 0; done < frames; ) {
+        int n = int(std::min<int64_t>(kOfflineBlockFrames, frames - done));
+        queuePendingPulses();   // resumes where a full queue stopped it
+        doAudioCallback(out.data() + pos + size_t(done) * ch, unsigned(n));
+        done += n;
+    }
+
+    if (info) {
+        info->frames  = frames;
+        info->countIn = countIn;
+        info->tempo   = tempo;
+    }
+    return true;
+}
+
+void AudioEngine::renderOfflineTail(SampleVector& out, int maxFrames)
+{
+    if (!m_offline) return;
+    for (int done = 0; done < maxFrames && m_voices.activeVoices() > 0; ) {
+        int n = std::min(kOfflineBlockFrames, maxFrames - done);
+        size_t pos = out.size();
+        out.resize(pos + size_t(n) * size_t(m_mixChannels));
+        doAudioCallback(out.data() + pos, unsigned(n));
+        done += n;
+    }
+}
+
 // =============================================================================
 // AUDIO CALLBACK  (core mixing loop â€” runs on audio thread, new state machine)
 // =============================================================================
-int AudioEngine::doAudioCallback(float* output, unsigned int nBufferFrames) {
-    for (unsigned int i = 0; i < nBufferFrames; ++i)
-        output[i] = 0.0f;
+// Routing row for a pulse's own sound (layer = false) or the one stacked on it.
+static AudioEngine::RouteClass routeClassOf(const AudioPulseEvent& ev, bool layer) {
+    using RC = AudioEngine::RouteClass;
+    if (ev.idx < 0)   return RC::CountIn;
+    if (layer)        return ev.polyAccent ? RC::PolyAccent : RC::Click;
+    if (ev.accent)    return RC::Accent;
+    return ev.polyAccent ? RC::PolyAccent : RC::Click;
+}
 
-    if (!m_running.load())
-        return 0;
+// The analyzer's share of a buffer: the stand-in if there is one, else the
+// device input (none when the device is not full-duplex).
+void AudioEngine::feedAnalyzer(const float* input, int64_t bufferStart, unsigned frames, int64_t capturedNs) {
+    const int64_t bufferEnd = bufferStart + int64_t(frames);
+    if (m_inputStandIn) {
+        // Stand-in sample i is heard at timeline position i.
+        const int64_t dataStart = std::clamp<int64_t>(0, bufferStart, bufferEnd);
+        const int64_t dataEnd   = std::clamp<int64_t>(int64_t(m_inputStandIn->frames()), dataStart, bufferEnd);
+        m_input.pushInput(nullptr, int(dataStart - bufferStart), bufferStart, m_sampleRate, capturedNs);
+        if (dataEnd > dataStart)
+            m_input.pushInput(m_inputStandIn->samples() + dataStart, int(dataEnd - dataStart), dataStart, m_sampleRate,
+                              capturedNs ? capturedNs + (dataStart - bufferStart) * 1000000000 / m_sampleRate : 0);
+        if (bufferEnd > dataEnd)
+            m_input.pushInput(nullptr, int(bufferEnd - dataEnd), dataEnd, m_sampleRate,
+                              capturedNs ? capturedNs + (dataEnd - bufferStart) * 1000000000 / m_sampleRate : 0);
+    } else if (input) {
+        m_input.pushInput(input, int(frames), bufferStart, m_sampleRate, capturedNs);
+    }
+}
 
-    QMutexLocker lock(&m_schedMutex);
+int AudioEngine::doAudioCallback(float* output, unsigned int nBufferFrames, const float* input,
+                                 unsigned deviceOffset) {
+    std::fill(output, output + size_t(nBufferFrames) * size_t(m_mixChannels), 0.0f);
+
+    // A later chunk of a device buffer is played (and its input was
+    // captured) that many frames after the buffer's first one.
+    const int64_t chunkNs = int64_t(deviceOffset) * 1000000000 / std::max(1, m_sampleRate);
+    m_bank.beginCallback(int(nBufferFrames));
+    if (!m_running.load()) {
+        if (m_listening.load(std::memory_order_relaxed)) {
+            const int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            feedAnalyzer(input, m_listenPos, nBufferFrames,
+                         nowNs + chunkNs - m_inputLatencyNs.load(std::memory_order_relaxed));
+            m_listenPos += int64_t(nBufferFrames);
+        }
+        return 0;
+    }
+    const auto callbackStart = std::chrono::steady_clock::now();
+    m_routingBuffer.update();
+    const OutputRouting& routing = m_routingBuffer.read();
+    const bool routed = m_mixChannels > 1;
+    const bool analyzing = m_input.isEnabled();
+
+    // No locks here: bars are built on the producer thread, and the legacy
+    // API hands playhead resets over via atomics.
+    int64_t resetTo = m_playheadResetTo.exchange(kNoPlayheadReset);
+    if (resetTo != kNoPlayheadReset)
+        m_globalSamplePos = resetTo;
+    if (m_clearVoicesRequested.exchange(false))
+        m_voices.clear();
 
     // â”€â”€ Runtime device sample-rate change â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
     if (m_deviceInitialized && m_device.sampleRate != m_sampleRate) {
         int oldRate = m_sampleRate;
         int newRate = m_device.sampleRate;
+        // Samples are re-decoded on a worker thread and swapped in at a bar
+        // line; until then voices read the old buffers at oldRate / newRate.
+        m_reloadSamplesRequested.store(true);
         if (oldRate > 0 && newRate > 0) {
             double ratio = double(newRate) / double(oldRate);
-            {
-                QMutexLocker sampleLock(&m_sampleMutex);
-                activeSamples.clear();
-                for (auto it = m_samples.begin(); it != m_samples.end(); ++it) {
-                    PCMBuffer &buf = it.value();
-                    if (buf.valid && buf.sampleRate != newRate) {
-                        if (!buf.resourcePath.isEmpty())
-                            buf.reloadForDevice(newRate);
-                        else
-                            buf.resampleTo(newRate);
-                    }
-                }
-            }
-            // Rescale state-machine positions
-            for (auto& sp : m_scheduledPulses)
-                sp.samplePos = int64_t(std::round(sp.samplePos * ratio));
-            m_nextBarStart    = int64_t(std::round(m_nextBarStart * ratio));
+            m_voices.retune(1.0 / ratio);
+            // Queued events keep their build rate and are rescaled as they
+            // are read; the producer follows m_streamRate for new bars.
             m_globalSamplePos = int64_t(std::round(m_globalSamplePos * ratio));
             m_sampleRate = newRate;
         } else {
-            QMutexLocker sampleLock(&m_sampleMutex);
-            activeSamples.clear();
-            m_scheduledPulses.clear();
+            // Nothing to rescale from: start the timeline again at 0 and let
+            // the producer rebuild from there.  Queued events are dropped as
+            // they come up.
+            m_voices.clear();
+            m_timelineEpoch.fetch_add(1, std::memory_order_acq_rel);
             m_globalSamplePos = 0;
             m_sampleRate = newRate;
         }
+        m_streamRate.store(m_sampleRate, std::memory_order_release);
+        m_rtLog.post("device sample rate changed from %1 to %2 Hz", oldRate, newRate);
     }
 
     int64_t bufferStart = m_globalSamplePos;
     int64_t bufferEnd   = bufferStart + int64_t(nBufferFrames);
-
-    // â”€â”€ Pre-generate bars to maintain a 2-second lookahead â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    if (m_playState != EnginePlayState::Idle) {
-        int64_t lookahead = bufferEnd + int64_t(m_sampleRate) * 2;
-        while (m_nextBarStart < lookahead) {
-            int64_t prevNext = m_nextBarStart;
-            advanceNextBar();
-            if (m_nextBarStart == prevNext) break;  // guard against zero-length bar
-            if (m_playState == EnginePlayState::Idle) break;
+    // What is mixed now is heard once the device has played what it already
+    // holds; offline renders have no clock.
+    const int64_t bufferAudibleNs = m_offline ? 0
+        : std::chrono::duration_cast<std::chrono::nanoseconds>(callbackStart.time_since_epoch()).count()
+          + m_outputLatencyNs.load(std::memory_order_relaxed) + chunkNs;
+    // A start aligned to the player: hold the first bar back until the time
+    // asked for.
+    if (m_startAlignNs.load(std::memory_order_relaxed) != 0) {
+        const int64_t alignNs = m_startAlignNs.exchange(0, std::memory_order_relaxed);
+        const int64_t lead    = m_offline ? 0 : (alignNs - bufferAudibleNs) * m_sampleRate / 1000000000;
+        if (bufferStart <= 0 && lead > -bufferStart) {
+            bufferStart       = -lead;
+            bufferEnd         = bufferStart + int64_t(nBufferFrames);
+            m_globalSamplePos = bufferStart;
         }
     }
+    m_playheadPos.store(bufferStart, std::memory_order_release);
+
+    // Bars are built ahead on the producer thread.  If it has not reached the
+    // end of this buffer yet, note the underrun and play whatever is queued.
+    if (m_producerRunning.load(std::memory_order_relaxed) &&
+        m_producedUntil.load(std::memory_order_acquire) < bufferEnd) {
+        quint64 n = m_producerUnderruns.fetch_add(1, std::memory_order_relaxed) + 1;
+        if ((n & (n - 1)) == 0)   // log the 1st, 2nd, 4th, 8th...
+            m_rtLog.post("producer underrun %1 at sample %2", int64_t(n), bufferStart);
+    }
 
     // â”€â”€ Fire scheduled pulses in this buffer window â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    for (const ScheduledPulse& sp : m_scheduledPulses) {
-        if (sp.samplePos < bufferStart || sp.samplePos >= bufferEnd) continue;
+    // The queue is time-ordered: pop until the first event past this buffer.
+    // Events that are already in the past (after a playhead reset), or were
+    // built for a timeline the callback has since restarted, are dropped.
+    // Events built before a device rate change are moved onto the new timeline.
+    const uint32_t epoch = m_timelineEpoch.load(std::memory_order_relaxed);
+    while (const ScheduledPulse* front = m_eventQueue.front()) {
+        if (front->epoch != epoch) {
+            m_eventQueue.discardFront();
+            continue;
+        }
+        int64_t pos = front->samplePos;
+        if (front->sampleRate != m_sampleRate && front->sampleRate > 0)
+            pos = int64_t(std::round(double(pos) * m_sampleRate / front->sampleRate));
+        if (pos >= bufferEnd) break;
+        ScheduledPulse sp = *front;
+        sp.samplePos = pos;
+        m_eventQueue.discardFront();
+        if (sp.samplePos < bufferStart) continue;
         int outPos = int(sp.samplePos - bufferStart);
-        if (sp.ev.playPulse) {
-            PCMBuffer* buf = currentSample(sp.ev.accent);
-            if (buf && buf->valid)
-                activeSamples.push_back({&buf->data, buf->startSample, outPos, m_volume});
+        // Reloaded sounds change only on a main bar line, never mid-bar.
+        if (sp.ev.track == 0 && sp.ev.isFirstInBar && m_bank.commitStaged())
+            m_rtLog.post("reloaded samples swapped in at sample %1", sp.samplePos);
+        for (bool layer : {false, true}) {
+            const int id = layer ? sp.ev.layerSoundId : sp.ev.soundId;
+            const PCMBuffer* buf = m_bank.get(id);
+            if (buf && buf->valid && sp.gain > 0.0f)
+                m_voices.trigger(buf->samples(), buf->frames(), buf->startSample,
+                                 outPos, m_volume * sp.gain, m_bank.chokeGroup(id),
+                                 buf->sampleRate > 0 ? double(buf->sampleRate) / m_sampleRate : 1.0,
+                                 routed ? routing.row(routeClassOf(sp.ev, layer), sp.ev.track).data() : nullptr);
         }
-        emitUiPulse(sp.ev);
+        if (analyzing && sp.ev.track == 0 && sp.ev.idx >= 0)
+            m_input.pushClick({sp.samplePos, int16_t(sp.ev.idx), sp.ev.isBeat, sp.ev.isFirstInBar,
+                               sp.ev.playPulse && !sp.ev.isRest});
+        emitUiPulse(sp.ev, sp.samplePos,
+                    bufferAudibleNs ? bufferAudibleNs + int64_t(outPos) * 1000000000 / m_sampleRate : 0);
     }
 
-    // â”€â”€ Prune events that have already been delivered â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    m_scheduledPulses.erase(
-        std::remove_if(m_scheduledPulses.begin(), m_scheduledPulses.end(),
-            [bufferEnd](const ScheduledPulse& sp) { return sp.samplePos < bufferEnd; }),
-        m_scheduledPulses.end());
+    // After this buffer's clicks, so the analyzer has every click up to the
+    // end of the input it has read.
+    if (analyzing)
+        feedAnalyzer(input, bufferStart, nBufferFrames,
+                     m_offline ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         callbackStart.time_since_epoch()).count()
+                                     + chunkNs - m_inputLatencyNs.load(std::memory_order_relaxed));
 
     // â”€â”€ Mix active samples â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
-    for (auto it = activeSamples.begin(); it != activeSamples.end(); ) {
-        int samplesLeft  = int(it->data->size()) - it->pos;
-        int bufferSpace  = int(nBufferFrames) - it->outPos;
-        int samplesToMix = std::min(samplesLeft, bufferSpace);
-        for (int k = 0; k < samplesToMix; ++k)
-            output[it->outPos + k] += (*it->data)[it->pos + k] * it->volume;
-        it->pos    += samplesToMix;
-        it->outPos += samplesToMix;
-        if (it->pos >= int(it->data->size()))
-            it = activeSamples.erase(it);
-        else if (it->outPos >= int(nBufferFrames)) {
-            it->outPos = 0;
-            ++it;
-        } else {
-            ++it;
-        }
-    }
+    m_voices.mix(output, int(nBufferFrames), m_mixChannels);
 
     m_globalSamplePos += nBufferFrames;
+
+    // â”€â”€ Instrumentation â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€â”€
+    // A chunk of a converted device buffer is recorded with the whole
+    // buffer by writeDeviceOutput().
+    if (!m_chunkedOutput)
+        recordCallback(callbackStart, nBufferFrames);
     return 0;
 }
 
+// Audio thread: one device buffer's timing against its own deadline.
+void AudioEngine::recordCallback(std::chrono::steady_clock::time_point callbackStart, unsigned frames) {
+    using namespace std::chrono;
+    const auto callbackEnd = steady_clock::now();
+    const int64_t startNs  = m_offline ? 0 : duration_cast<nanoseconds>(callbackStart.time_since_epoch()).count();
+    const int64_t durNs    = duration_cast<nanoseconds>(callbackEnd - callbackStart).count();
+    const uint64_t missesBefore = m_stats.deadlineMisses();
+    m_stats.recordCallback(startNs, durNs, int(frames), m_sampleRate,
+                           m_voices.activeVoices(), int(m_eventQueue.size()));
+    const uint64_t misses = m_stats.deadlineMisses();
+    if (misses != missesBefore && (misses & (misses - 1)) == 0)
+        m_rtLog.post("callback took %1 us of a %2 us buffer", durNs / 1000,
+                     int64_t(frames) * 1000000 / std::max(1, m_sampleRate));
+}
+
+EngineStatsSnapshot AudioEngine::stats() const {
+    EngineStatsSnapshot s = m_stats.snapshot();
+    s.stolenVoices = m_voices.stolenVoices();
+    s.worstCaseMix = int64_t(m_voices.worstCaseVoices()) * m_bufferFrames.load() * m_mixChannels;
+    return s;
+}
+
 
 void AudioEngine::flushBarAndReset() {
     QMutexLocker lock(&m_schedMutex);
-    m_globalSamplePos = 0;
-    activeSamples.clear();
+    m_playheadResetTo.store(0);
+    m_clearVoicesRequested.store(true);
     m_scheduleChanged = true;
     m_flushedRecently = true;
     m_pendingScheduleSwapSamplePos = -1;
@@ -818,8 +1723,8 @@ void AudioEngine::scheduleNow(const std::vector<AudioPulseEvent>& pulses, double
     m_barLengthSeconds          = barLengthSeconds;
     // Start 1 sample past zero: beat-1 (samplePosInBar=0) is now in the "past"
     // for the first buffer, so it won't re-fire after the old beat-1 click.
-    // Do NOT clear activeSamples â€” old click should decay naturally.
-    m_globalSamplePos           = 1;
+    // Do NOT clear m_voices â€” old click should decay naturally.
+    m_playheadResetTo.store(1);
     m_scheduleChanged           = true;
     m_flushedRecently           = false;   // cancel any pending flushAtNextBarBoundary
     m_hasPendingSchedule        = false;   // cancel any pending requestScheduleChange
@@ -831,62 +1736,247 @@ void AudioEngine::flushAtNextBarBoundary() {
     m_scheduleChanged = true;
     m_flushedRecently = true;
     // Do NOT reset m_globalSamplePos!
-    // Do NOT clear activeSamples!
+    // Do NOT clear m_voices!
 }
 
 bool AudioEngine::initializeDevice(double bpm) {
     if (m_deviceInitialized) return true;
 
-    int detectedRate = detectBestSampleRate();
-    if (detectedRate > 0) {
-        m_sampleRate = detectedRate;
-        qDebug() << "AudioEngine: Auto-detected sample rate:" << m_sampleRate << "Hz (init only)";
-    } else {
-        qDebug() << "AudioEngine: Auto-detection failed, using default:" << m_sampleRate << "Hz";
+    QElapsedTimer clock;
+    clock.start();
+    if (!m_contextInitialized) {
+        if (ma_context_init(nullptr, 0, nullptr, &m_context) != MA_SUCCESS) {
+            qWarning() << "AudioEngine: no audio backend available";
+            return false;
+        }
+        m_contextInitialized = true;
     }
 
-    m_deviceConfig = ma_device_config_init(ma_device_type_playback);
+    // No probing: open at the profiled rate, or at whatever the device runs
+    // natively (sampleRate 0) when there is no profile yet.
+    m_deviceConfig = ma_device_config_init(m_outputConfig.captureInput ? ma_device_type_duplex
+                                                                        : ma_device_type_playback);
+    m_deviceConfig.capture.format    = ma_format_f32;
+    m_deviceConfig.capture.channels  = 1;
     m_deviceConfig.playback.format   = ma_format_f32;
-    m_deviceConfig.playback.channels = 1;
-    m_deviceConfig.sampleRate        = m_sampleRate;
+    m_deviceConfig.playback.channels = ma_uint32(std::max(1, m_outputConfig.channels));
+    m_deviceConfig.sampleRate        = m_deviceProfile.isValid() ? ma_uint32(m_deviceProfile.sampleRate) : 0;
     m_deviceConfig.dataCallback      = &AudioEngine::miniAudioDataCallback;
+    m_deviceConfig.notificationCallback = &AudioEngine::miniAudioNotificationCallback;
     m_deviceConfig.pUserData         = this;
+    if (m_outputConfig.periodFrames > 0)
+        m_deviceConfig.periodSizeInFrames = ma_uint32(m_outputConfig.periodFrames);
+    if (m_outputConfig.lowLatency) {
+        // ma_format_unknown / 0 channels = whatever the device runs natively.
+        m_deviceConfig.performanceProfile = ma_performance_profile_low_latency;
+        m_deviceConfig.playback.format    = ma_format_unknown;
+        m_deviceConfig.playback.channels  = ma_uint32(m_outputConfig.channels);
+    }
 
-    if (ma_device_init(nullptr, &m_deviceConfig, &m_device) != MA_SUCCESS) {
+    ma_result result = ma_device_init(&m_context, &m_deviceConfig, &m_device);
+    if (result != MA_SUCCESS && m_deviceConfig.deviceType == ma_device_type_duplex) {
+        qWarning() << "AudioEngine: no capture device; opening playback only";
+        m_deviceConfig.deviceType = ma_device_type_playback;
+        result = ma_device_init(&m_context, &m_deviceConfig, &m_device);
+    }
+    if (result != MA_SUCCESS) {
         return false;
     }
-
-    // ALWAYS reload samples whose stored rate doesn't match the actual device rate.
-    // This must be unconditional because detectBestSampleRate() pre-assigns m_sampleRate
-    // to the detected rate before we get here, so the old guard
-    // (if m_device.sampleRate != m_sampleRate) was always false â€” samples loaded at the
-    // constructor default of 44100 would silently stay at 44100 even when the device runs
-    // at 48000, causing a pitch shift on first play.
+    // u8 and other formats without a conversion kernel go through miniaudio.
+    const ma_format nativeFormat = m_device.playback.format;
+    if (nativeFormat != ma_format_f32 && nativeFormat != ma_format_s16 &&
+        nativeFormat != ma_format_s24 && nativeFormat != ma_format_s32) {
+        ma_device_uninit(&m_device);
+        m_deviceConfig.playback.format = ma_format_f32;
+        if (ma_device_init(&m_context, &m_deviceConfig, &m_device) != MA_SUCCESS)
+            return false;
+    }
+    const int outChannels = int(m_device.playback.channels);
+    m_mixChannels = std::clamp(outChannels, 1, VoicePool::kMaxChannels);
+    m_mixScratch.assign(size_t(kConvertChunkFrames) * size_t(m_mixChannels), 0.0f);
+    m_fanScratch.assign(outChannels > m_mixChannels ? size_t(kConvertChunkFrames) * size_t(outChannels) : 0, 0.0f);
+
+    // Samples loaded before the device opened (at the profiled rate, or the
+    // 44.1 kHz default without a profile) are brought to the actual rate;
+    // with a good profile nothing needs converting here.
     {
         int deviceRate = (int)m_device.sampleRate;
-        QMutexLocker sampleLock(&m_sampleMutex);
-        for (auto it = m_samples.begin(); it != m_samples.end(); ++it) {
-            PCMBuffer &buf = it.value();
-            if (buf.valid && buf.sampleRate != deviceRate) {
-                qDebug() << "AudioEngine: Reloading sample" << it.key()
-                         << "from" << buf.sampleRate << "Hz to" << deviceRate << "Hz";
-                if (!buf.resourcePath.isEmpty()) {
-                    bool ok = buf.reloadForDevice(deviceRate);
-                    if (!ok) buf.resampleTo(deviceRate);
-                } else {
-                    buf.resampleTo(deviceRate);
-                }
-            }
-        }
+        reloadSamplesForRate(deviceRate);
         if (m_sampleRate != deviceRate)
             qDebug() << "AudioEngine: Device actual rate:" << deviceRate << "Hz";
         m_sampleRate = deviceRate;
     }
 
     m_deviceInitialized = true;
+    if (!m_pendingPrefetch.isEmpty()) {
+        const QStringList paths = m_pendingPrefetch;
+        m_pendingPrefetch.clear();
+        prefetchSamples(paths);
+    }
     // Capture the actual device period size so the pre-roll in start() is exactly right
     if (m_device.playback.internalPeriodSizeInFrames > 0)
         m_bufferFrames = (int)m_device.playback.internalPeriodSizeInFrames;
+
+    refreshOutputInfo();
+
+    DeviceProfile opened;
+    opened.backend    = m_outputInfo.backend;
+    opened.deviceName = QString::fromUtf8(m_device.playback.name);
+    opened.sampleRate = int(m_device.sampleRate);
+    qDebug() << "AudioEngine: Device open took" << clock.elapsed() << "ms"
+             << (m_deviceProfile.isValid() ? "(profiled rate)" : "(native rate)");
+    if (!(opened == m_deviceProfile)) {
+        m_deviceProfile = opened;
+        emit deviceProfileChanged();
+    }
+    startProfileCheck();
+
     m_globalSamplePos = 0; // Defensive
     return true;
 }
+
+// Describe the open device in m_outputInfo.  Called when it opens and again
+// after the backend reroutes it (default device changed, interface replugged).
+void AudioEngine::refreshOutputInfo() {
+    if (!m_deviceInitialized) return;
+    const int outChannels = int(m_device.playback.channels);
+    const ma_uint32 internalRate = m_device.playback.internalSampleRate
+                                   ? m_device.playback.internalSampleRate : m_device.sampleRate;
+    m_outputInfo.backend      = QString::fromLatin1(ma_get_backend_name(m_device.pContext->backend));
+    m_outputInfo.format       = QString::fromLatin1(ma_get_format_name(m_device.playback.format));
+    m_outputInfo.channels     = outChannels;
+    m_outputInfo.sampleRate   = int(m_device.sampleRate);
+    m_outputInfo.periodFrames = int(m_device.playback.internalPeriodSizeInFrames);
+    m_outputInfo.periods      = int(m_device.playback.internalPeriods);
+    m_outputInfo.latencyMs    = internalRate ? 1000.0 * m_outputInfo.periodFrames * m_outputInfo.periods / internalRate : 0.0;
+    m_outputInfo.lowLatency   = m_outputConfig.lowLatency;
+    m_outputInfo.capturing    = m_device.type == ma_device_type_duplex;
+    m_outputInfo.inputLatencyMs = 0.0;
+    if (m_outputInfo.capturing) {
+        const ma_uint32 captureRate = m_device.capture.internalSampleRate
+                                      ? m_device.capture.internalSampleRate : m_device.sampleRate;
+        m_outputInfo.inputLatencyMs = captureRate ? 1000.0 * m_device.capture.internalPeriodSizeInFrames
+                                                    * m_device.capture.internalPeriods / captureRate : 0.0;
+    }
+    m_outputLatencyNs.store(int64_t(m_outputInfo.latencyMs * 1e6), std::memory_order_relaxed);
+    m_inputLatencyNs.store(int64_t(m_outputInfo.inputLatencyMs * 1e6), std::memory_order_relaxed);
+    m_input.setRoundTripNs(int64_t((m_outputInfo.latencyMs + m_outputInfo.inputLatencyMs) * 1e6));
+    qDebug() << "AudioEngine: Output" << m_outputInfo.backend << m_outputInfo.format
+             << m_outputInfo.channels << "ch," << m_outputInfo.periods << "x"
+             << m_outputInfo.periodFrames << "frames =" << m_outputInfo.latencyMs << "ms";
+    emit outputInfoChanged();
+}
+
+void AudioEngine::setOutputConfig(const OutputConfig& config) {
+    if (config.lowLatency == m_outputConfig.lowLatency &&
+        config.periodFrames == m_outputConfig.periodFrames &&
+        config.channels == m_outputConfig.channels &&
+        config.captureInput == m_outputConfig.captureInput)
+        return;
+    m_outputConfig = config;
+    m_outputConfig.channels = std::clamp(config.channels, 0, int(MA_MAX_CHANNELS));
+    if (m_running.load()) {
+        m_outputConfigDirty = true;   // stop() closes the device
+    } else {
+        stopListening();
+        closeDevice();
+    }
+}
+
+// ── Output routing ──────────────────────────────────────────────────────────
+AudioEngine::OutputRouting::OutputRouting() {
+    for (Gains& g : classes) g = everywhere();
+    for (Gains& g : tracks)  g = everywhere();
+}
+
+AudioEngine::OutputRouting::Gains AudioEngine::OutputRouting::everywhere(float gain) {
+    Gains g;
+    g.fill(gain);
+    return g;
+}
+
+AudioEngine::OutputRouting::Gains AudioEngine::OutputRouting::only(int channel, float gain) {
+    Gains g{};
+    if (channel >= 0 && channel < VoicePool::kMaxChannels)
+        g[size_t(channel)] = gain;
+    return g;
+}
+
+AudioEngine::OutputRouting::Gains AudioEngine::OutputRouting::pan(float position, int left, int right) {
+    const float theta = (std::clamp(position, -1.0f, 1.0f) + 1.0f) * 0.25f * 3.14159265f;
+    Gains g{};
+    if (left >= 0 && left < VoicePool::kMaxChannels)
+        g[size_t(left)] = std::cos(theta);
+    if (right >= 0 && right < VoicePool::kMaxChannels)
+        g[size_t(right)] += std::sin(theta);
+    return g;
+}
+
+void AudioEngine::OutputRouting::setTrack(int track, const Gains& gains) {
+    if (track < 1 || track > EngineParams::kMaxTracks) return;
+    tracks[track - 1] = gains;
+    trackMask |= 1u << (track - 1);
+}
+
+void AudioEngine::OutputRouting::clearTrack(int track) {
+    if (track < 1 || track > EngineParams::kMaxTracks) return;
+    trackMask &= ~(1u << (track - 1));
+}
+
+const AudioEngine::OutputRouting::Gains& AudioEngine::OutputRouting::row(RouteClass c, int track) const {
+    if (track >= 1 && track <= EngineParams::kMaxTracks && (trackMask & (1u << (track - 1))))
+        return tracks[track - 1];
+    return classes[int(c)];
+}
+
+void AudioEngine::setOutputRouting(const OutputRouting& routing) {
+    m_outputRouting = routing;
+    m_routingBuffer.publish(routing);
+}
+
+bool AudioEngine::startListening() {
+    if (m_running.load() || m_listening.load()) return m_listening.load();
+    if (!initializeDevice(120.0)) return false;
+    if (!m_outputInfo.capturing && !m_inputStandIn) return false;
+
+    // The device is stopped, so the callback's listening state is ours.
+    m_input.reset();
+    m_listenPos = 0;
+    m_listening.store(true);
+    m_input.startWorker();
+    if (ma_device_start(&m_device) != MA_SUCCESS) {
+        stopListening();
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::stopListening() {
+    if (!m_listening.load()) return;
+    if (m_deviceInitialized)
+        ma_device_stop(&m_device);
+    m_listening.store(false);
+    m_input.stopWorker();
+}
+
+bool AudioEngine::setInputStandIn(const QString& wavPath) {
+    if (m_running.load() || m_listening.load()) return false;
+    if (wavPath.isEmpty()) {
+        m_inputStandIn.reset();
+        return true;
+    }
+    PCMBuffer buf;
+    if (!buf.loadFromWavResource(wavPath, m_sampleRate)) {
+        qWarning() << "AudioEngine: could not load input stand-in" << wavPath;
+        return false;
+    }
+    m_inputStandIn = buf.pcm;
+    return true;
+}
+
+void AudioEngine::closeDevice() {
+    m_outputConfigDirty = false;
+    if (!m_deviceInitialized) return;
+    ma_device_uninit(&m_device);
+    m_deviceInitialized = false;
+}
@@ -2,16 +2,33 @@
 
 #include <QObject>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QMap>
 #include <QString>
+#include <QStringList>
+#include <array>
 #include <vector>
+#include <utility>
+#include <deque>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 
 // MiniAudio (header-only)
 #include "miniaudio.h"
 #include "subdivisionpattern.h"
+#include "triplebuffer.h"
+#include "spscring.h"
+#include "voicepool.h"
+#include "mixkernel.h"
+#include "pcmcache.h"
+#include "samplebank.h"
+#include "enginestats.h"
+#include "inputanalyzer.h"
+
+class QTimer;
+class QThread;
 
 // Pulse event info
 struct AudioPulseEvent {
@@ -28,47 +45,133 @@ struct AudioPulseEvent {
     int  barNumber    = 0;   // which bar (0-indexed, resets per tempo)
     int  barsPerStep  = 1;   // speed trainer bars-per-step (for display "Bar X/Y")
     bool isFirstInBar = false; // true for the first pulse of every bar
-    int  newTempo     = 0;   // non-zero only on first pulse of a new stepped-up tempo
+    double newTempo   = 0;   // non-zero only on first pulse of a new stepped-up tempo
     int  runId        = 0;   // incremented each startWithParams(); stale signals have old IDs
+    // Sample-bank IDs resolved by buildBarSchedule() (-1 = silent)
+    int  soundId      = -1;
+    int  layerSoundId = -1;  // second sound stacked on the same pulse
+    int  track        = 0;   // 0 = the main bar, n = EngineParams::tracks[n - 1]
+    // Stamped by the audio callback
+    int64_t samplePos = 0;   // absolute position on the device timeline
+    int64_t audibleNs = 0;   // steady_clock time the click leaves the speaker (0 = unknown)
+};
+
+// Compact form of AudioPulseEvent handed from the audio thread to the GUI
+// thread through the pulse ring.  Unpacked with toEvent() on the GUI side.
+struct PulseRecord {
+    int64_t samplePos;
+    int64_t audibleNs;
+    int32_t samplePosInBar;
+    int32_t runId;
+    float   newTempo;
+    int16_t idx;
+    int16_t gridColumn;
+    int16_t barNumber;
+    int16_t barsPerStep;
+    uint8_t flags;
+    uint8_t track;
+
+    enum : uint8_t {
+        Accent       = 1 << 0,
+        PolyAccent   = 1 << 1,
+        IsBeat       = 1 << 2,
+        PlayPulse    = 1 << 3,
+        IsRest       = 1 << 4,
+        StartOfCycle = 1 << 5,
+        FirstInBar   = 1 << 6,
+    };
+
+    static PulseRecord fromEvent(const AudioPulseEvent& ev, int runId);
+    AudioPulseEvent toEvent() const;
 };
 
 using PulseCallback = std::function<void(const AudioPulseEvent&)>;
 
 struct PCMBuffer {
-    std::vector<float> data;
+    // Where loadFromWavResource() found the samples.
+    enum class Source { Decoded, MemoryCache, DiskCache };
+
+    std::shared_ptr<const PcmData> pcm;   // shared with the caches, never written
     int numChannels = 1;
     int sampleRate = 44100;
     bool valid = false;
     int startSample = 0;
+    Source source = Source::Decoded;
 
     QString resourcePath;
 
+    const float* samples() const { return pcm ? pcm->samples() : nullptr; }
+    int          frames() const  { return pcm ? int(pcm->frames()) : 0; }
+
     bool loadFromWavResource(const QString& resourcePath_, int deviceRate);
     bool reloadForDevice(int deviceRate);
     void resampleTo(int dstRate);
 };
 
-struct ActiveSample {
-    const std::vector<float>* data;
-    int pos;
-    int outPos;
-    float volume;
-};
-
 struct CountInClick {
     int globalSamplePos;
     bool accent;
 };
 
+// ── Exact schedule time ──
+// Durations are counted in beat ticks (kBeatTicks, see subdivisionpattern.h).
+// Tempo is taken on a 1/kTempoScale BPM grid, so one tick lasts exactly
+// num/den samples and any bar is an exact rational number of samples.
+struct TickRate {
+    static constexpr int64_t kTicksPerBeat = kBeatTicks;
+    static constexpr int64_t kTempoScale   = 1000;
+    int64_t num = 0;   // 0 for a tempo of zero or less
+    int64_t den = 1;
+    static TickRate of(double bpm, int sampleRate);
+};
+
+// A point on the device timeline, sample + rem/den with 0 <= rem < den.
+// Bars are laid end to end by adding their exact lengths, so every bar line
+// lands on the floor of its exact time no matter how long playback runs.
+// Only a change of den (tempo or rate) rounds the sub-sample remainder.
+struct BarClock {
+    int64_t sample = 0;
+    int64_t rem    = 0;
+    int64_t den    = 1;
+
+    // Sample at an exact offset (in 1/offsetDen samples) from this point.
+    int64_t at(int64_t offset, int64_t offsetDen) const;
+    void    advance(int64_t length, int64_t lengthDen);
+    void    rescale(int fromRate, int toRate);
+    void    reset() { sample = 0; rem = 0; den = 1; }
+
+private:
+    int64_t remIn(int64_t d) const;
+};
+
 // ── Bar schedule (produced by buildBarSchedule, consumed by AudioEngine) ──
 struct BarSchedule {
     std::vector<AudioPulseEvent> pulses;  // samplePosInBar = relative positions within bar
     int64_t barLengthSamples = 0;
+    // Exact timing in 1/timeDen of a sample, for a BarClock to place the bar
+    // with.  pulseOffsets runs parallel to pulses; samplePosInBar and
+    // barLengthSamples are the same values for a bar starting on a sample.
+    std::vector<int64_t> pulseOffsets;
+    int64_t barLength = 0;
+    int64_t timeDen   = 1;
+    int64_t barTicks  = 0;   // length in beat ticks, whatever the tempo and rate
 };
 
-// ── Parameters snapshot passed from MetronomeEngine → AudioEngine ──
-struct EngineParams {
-    int bpm        = 120;
+// ── Which sample-bank sound each kind of pulse plays ──
+// -1 falls back: polyAccent and subdivision to click, countIn to the normal
+// accent/click pair; a ghost of -1 keeps rests silent.
+struct SoundRouting {
+    int  accent      = SampleBank::kAccentSound;
+    int  click       = SampleBank::kClickSound;
+    int  polyAccent  = -1;   // secondary polyrhythm layer
+    int  subdivision = -1;   // pulses between beats
+    int  ghost       = -1;   // rests
+    int  countIn     = -1;
+    bool stackClickUnderAccent = false;   // accents also play the click sound
+};
+
+// ── What one track plays each bar: everything buildBarSchedule reads ──
+struct BarParams {
     int numerator  = 4;
     int denominator = 4;
     bool polyrhythmEnabled = false;
@@ -76,18 +179,72 @@ struct EngineParams {
     int  polySecondary = 2;
     SubdivisionPattern subdivision;
     std::vector<bool>  accents;
+    SoundRouting sounds;
+};
+
+// ── An extra track for polymeter practice ──
+// Tracks play under the main bar at the same tempo, each counting beats in
+// its own meter, so 5/4 against 4/4 realigns every 20 beats.  They share the
+// main bar's sample clock, event queue and mix.  Tracks rest during count-in
+// bars and restart on the main bar line at each tempo change, and all of them
+// restart on the next main bar line when tracks are added or removed.  Other
+// edits to a track apply from its own next bar line.
+struct TrackParams : BarParams {
+    float gain = 1.0f;   // on top of the engine volume; 0 keeps the UI pulses only
+};
+
+// ── Parameters snapshot passed from MetronomeEngine → AudioEngine ──
+// The inherited BarParams are the main bar.
+struct EngineParams : BarParams {
+    double bpm     = 120.0;   // fractional tempos are scheduled to 1/TickRate::kTempoScale BPM
     bool countInEnabled = false;
     // Speed trainer
     bool speedEnabled = false;
     int  barsPerStep  = 4;
-    int  tempoStep    = 2;
-    int  maxTempo     = 180;
-    int  startTempo   = 120;
+    double tempoStep  = 2;
+    double maxTempo   = 180;
+    double startTempo = 120;
+    std::vector<TrackParams> tracks;   // at most kMaxTracks are played
+    static constexpr int kMaxTracks = 32;
 };
 
-// ── Bar provider: called by audio thread to build each bar on demand ──
-// Implemented as a free function in metronomeengine.cpp, captured by value.
-BarSchedule buildBarSchedule(const EngineParams& params, bool isCountIn, int sampleRate);
+// ── Bar provider: compiles one bar of a track at the given tempo ──
+BarSchedule buildBarSchedule(const BarParams& params, double bpm, bool isCountIn, int sampleRate);
+
+// ── Compiled bars, for the producer thread ──
+// Bars only change with the params, the tempo (speed trainer), the rate and
+// the count-in flag; everything else the producer stamps on as it queues a
+// bar.  get() hashes exactly the fields buildBarSchedule reads and returns
+// the compiled bar, so steady-state playback builds nothing: the producer
+// adds the bar's exact offsets to its BarClock.  The least recently used of
+// kCapacity entries is rebuilt on a miss.  Not thread-safe.
+class BarScheduleCache {
+public:
+    static constexpr size_t kCapacity = 16;
+
+    BarScheduleCache();
+    // The reference stays valid until the next get() or clear().
+    const BarSchedule& get(const BarParams& params, double bpm, bool isCountIn, int sampleRate);
+    void clear();
+
+    uint64_t hits() const   { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    struct Entry {
+        uint64_t             hash = 0;
+        std::vector<int64_t> key;
+        BarSchedule          bar;
+        uint64_t             lastUse = 0;
+    };
+    uint64_t makeKey(const BarParams& p, double bpm, bool isCountIn, int sampleRate);
+
+    std::vector<Entry>   m_entries;
+    std::vector<int64_t> m_key;
+    uint64_t m_useClock = 0;
+    uint64_t m_hits     = 0;
+    uint64_t m_misses   = 0;
+};
 
 class AudioEngine : public QObject {
     Q_OBJECT
@@ -97,13 +254,117 @@ public:
 
     bool initializeDevice(double bpm);
 
+    // ── Output device ─────────────────────────────────────────────────────
+    // Low-latency mode opens the device with miniaudio's low-latency
+    // profile in its native sample format and channel count; the f32 mix is
+    // converted by the SIMD kernels instead of miniaudio's converter.
+    // The mix has as many channels as the device (up to VoicePool::kMaxChannels;
+    // any further channels stay silent) and is laid out by the OutputRouting.
+    struct OutputConfig {
+        bool lowLatency   = false;
+        int  periodFrames = 0;       // requested period; 0 = backend default
+        int  channels     = 0;       // 0 = mono, or native in low-latency mode
+        bool captureInput = false;   // open full-duplex: mono f32 input on the output's clock
+    };
+    // What the backend actually granted, read back after the device opened.
+    struct OutputInfo {
+        QString backend;
+        QString format;
+        int     channels     = 0;
+        int     sampleRate   = 0;
+        int     periodFrames = 0;
+        int     periods      = 0;
+        double  latencyMs    = 0.0;  // periodFrames * periods at the device rate
+        bool    lowLatency   = false;
+        bool    capturing    = false;  // opened full-duplex
+        double  inputLatencyMs = 0.0;
+    };
+    // GUI thread.  An open device is closed and reopened with the new
+    // settings on the next start; a playing one keeps going until stop().
+    void setOutputConfig(const OutputConfig& config);
+    OutputConfig outputConfig() const { return m_outputConfig; }
+    OutputInfo   outputInfo() const { return m_outputInfo; }
+
+    // Which output channels each pulse plays on: a matrix of gains with one
+    // row per event class, and optionally a row per track that replaces the
+    // class rows for everything the track plays.  Columns are output
+    // channels.  Accent is accented pulses, PolyAccent the secondary
+    // polyrhythm layer (also when it is stacked on an accent), CountIn the
+    // count-in clicks and Click everything else.  The default plays every
+    // row on every channel; a mono mix ignores the matrix.
+    enum class RouteClass { Accent, Click, PolyAccent, CountIn, Count };
+    struct OutputRouting {
+        using Gains = std::array<float, VoicePool::kMaxChannels>;
+        Gains    classes[int(RouteClass::Count)];
+        Gains    tracks[EngineParams::kMaxTracks];
+        uint32_t trackMask = 0;   // bit t - 1 set: track t plays on tracks[t - 1]
+
+        OutputRouting();
+        static Gains everywhere(float gain = 1.0f);
+        static Gains only(int channel, float gain = 1.0f);
+        // Equal-power pan between two channels, -1 = all left, 1 = all right.
+        static Gains pan(float position, int left = 0, int right = 1);
+        void setTrack(int track, const Gains& gains);
+        void clearTrack(int track);
+        const Gains& row(RouteClass c, int track) const;
+    };
+    // GUI thread; the callback picks the new matrix up at its next buffer.
+    void setOutputRouting(const OutputRouting& routing);
+    const OutputRouting& outputRouting() const { return m_outputRouting; }
+
+    // ── Input timing analysis ─────────────────────────────────────────────
+    // While the analyzer is enabled the callback hands it every main-bar
+    // pulse it fires and the input captured in the same buffer: the device
+    // input when it was opened with OutputConfig::captureInput, or the
+    // stand-in.  Its worker runs from startWithParams() to stop().
+    InputAnalyzer&       inputAnalyzer()       { return m_input; }
+    const InputAnalyzer& inputAnalyzer() const { return m_input; }
+    // A WAV file played into the analyzer in place of the device input: its
+    // first sample lines up with the first bar, and it is silent after its
+    // end.  Decoded at the current rate.  GUI thread, while stopped; an empty
+    // path goes back to the device input.
+    bool setInputStandIn(const QString& wavPath);
+    int64_t inputStandInFrames() const { return m_inputStandIn ? int64_t(m_inputStandIn->frames()) : 0; }
+
+    // Runs the device with the metronome stopped and the output silent, so
+    // the analyzer (and its tempo detection) hears the input on a timeline
+    // of its own.  Needs the device input or the stand-in; startWithParams()
+    // and stop() end it.  GUI thread.
+    bool startListening();
+    void stopListening();
+    bool isListening() const { return m_listening.load(); }
+
+    // The first bar of the next startWithParams() is heard at this
+    // steady_clock time instead of one buffer after the device starts, if
+    // that is still ahead when the first buffer is mixed.  GUI thread.
+    void setStartAlignment(int64_t audibleNs) { m_startAlignNs.store(audibleNs); }
+
+    // The default playback device as last seen: persisted by the caller and
+    // handed back on the next launch, so samples can be loaded at the right
+    // rate up front and the first start opens the device exactly once.
+    // After each open a worker thread re-reads the native rate and updates
+    // the profile (deviceProfileChanged) for the next launch.
+    struct DeviceProfile {
+        QString backend;
+        QString deviceName;
+        int     sampleRate = 0;
+        bool isValid() const { return sampleRate > 0; }
+        bool operator==(const DeviceProfile& o) const {
+            return backend == o.backend && deviceName == o.deviceName && sampleRate == o.sampleRate;
+        }
+    };
+    // GUI thread, before initializeDevice(); ignored once the device is open.
+    void setDeviceProfile(const DeviceProfile& profile);
+    DeviceProfile deviceProfile() const { return m_deviceProfile; }
+
     bool start(double bpm);   // legacy — kept for compat, use setEngineParams then start()
     void stop();
     bool isRunning() const { return m_running.load(); }
     int  currentRunId() const { return m_runId.load(); }
 
     // ── New state-machine API ──────────────────────────────────────────────
-    // Set/update engine params.  Safe to call from main thread at any time.
+    // Set/update engine params.  Safe to call from any thread at any time;
+    // the audio callback picks the snapshot up without locking.
     // Changes take effect at the next bar boundary.
     void setEngineParams(const EngineParams& p);
 
@@ -111,16 +372,50 @@ public:
     void startWithParams(const EngineParams& p, bool withCountIn);
     // ──────────────────────────────────────────────────────────────────────
 
+    // ── Offline rendering ─────────────────────────────────────────────────
+    // Drives the same bar state machine and callback as live playback from
+    // the caller's thread, with no device and no producer thread.  Use a
+    // dedicated engine: prepareOffline() first (samples load at that rate),
+    // then loadSample(), startOffline() and one renderOfflineBar() per bar.
+    struct OfflineBar {
+        int64_t frames  = 0;
+        bool    countIn = false;
+        double  tempo   = 0;
+    };
+    // Bars are rendered interleaved over `channels` channels (mono by default).
+    void prepareOffline(int sampleRate, int bufferFrames = kOfflineBlockFrames, int channels = 1);
+    void startOffline(const EngineParams& p, bool withCountIn);
+    bool renderOfflineBar(SampleVector& out, OfflineBar* info = nullptr);   // appends one bar
+    void renderOfflineTail(SampleVector& out, int maxFrames);   // until every voice has finished
+
+    // Virtual device for benchmarks: after startOffline(), alternate one
+    // producer step and one device callback on a synthetic clock.
+    void produceOffline() { produceBars(m_globalSamplePos); }
+    int  offlineCallback(float* out, int frames) { return doAudioCallback(out, unsigned(frames)); }
+    // The snapshot the producer steps are playing; the producer's thread only.
+    const EngineParams& offlineParams() const { return m_paramsBuffer.read(); }
+
     void playCountInClick(bool accent, int globalSamplePos);
 
     void schedulePulses(const std::vector<AudioPulseEvent>& pulses, double barLengthSeconds, int sampleRate);
     void setPulseCallback(PulseCallback cb);
 
+    // Sounds are addressed by sample-bank ID on the audio thread; resolve a
+    // name once with soundId() and route it through EngineParams::sounds.
     bool loadSample(const QString& name, const QString& resourcePath);
-    void setAccentSound(const QString& name);
-    void setClickSound(const QString& name);
+    int  soundId(const QString& name) { return m_bank.idFor(name); }
+    const SampleBank& sampleBank() const { return m_bank; }
     void setVolume(float vol);
 
+    // Voice pool: polyphony cap and per-sample choke groups (0 = never choke).
+    // By default only the accent chokes itself.
+    void setMaxVoices(int voices) { m_voices.setPolyphony(voices); }
+    void setChokeGroup(const QString& name, int group);
+    // Warm the PCM caches for sounds that may be loaded later (other sound
+    // sets), decoding them in parallel in the background at the device rate.
+    void prefetchSamples(const QStringList& resourcePaths);
+    const VoicePool& voicePool() const { return m_voices; }
+
     void setBpm(double bpm);
     void flushBarAndReset();
     void scheduleNow(const std::vector<AudioPulseEvent>& pulses, double barLengthSeconds, int sampleRate);
@@ -132,24 +427,88 @@ public:
     bool wasFlushedRecently() const { return m_flushedRecently; }
     void flushAtNextBarBoundary();
 
+    // UI pulses are delivered when their click is heard: the callback stamps
+    // each with mix time + device latency, and the GUI side waits until then
+    // plus this user calibration (positive = later, negative = earlier).
+    void setUiLatencyOffsetMs(int ms) { m_uiLatencyOffsetNs = int64_t(ms) * 1000000; }
+    int  uiLatencyOffsetMs() const    { return int(m_uiLatencyOffsetNs / 1000000); }
+
+    // Pulses dropped because the GUI thread fell behind the audio thread.
+    quint64 pulseRingOverflows() const { return m_pulseRing.overflowCount(); }
+    // Callbacks that reached past the last bar the producer thread had built.
+    quint64 producerUnderruns() const { return m_producerUnderruns.load(std::memory_order_relaxed); }
+
+    // Callback timing, deadline headroom, xruns, voices and event backlog,
+    // recorded lock-free by the audio thread, plus the voice pool's steal
+    // count and worst-case mix cost at the current buffer size.  GUI thread.
+    EngineStatsSnapshot stats() const;
+    void resetStats() { m_stats.reset(); m_voices.resetStats(); }
+
 signals:
-    void pulseUiEvent(AudioPulseEvent ev);
-    void tempoSteppedUp(int newTempo);   // emitted from audio thread (queued)
+    void pulseUiEvent(AudioPulseEvent ev);   // emitted on the GUI thread by drainPulseRing()
+    void tempoSteppedUp(double newTempo);   // emitted from audio thread (queued)
+    void outputInfoChanged();            // the device was (re)opened
+    void deviceProfileChanged();         // worth persisting
 
 private:
     std::atomic<bool> m_running{false};
     std::atomic<int>  m_runId{0};   // incremented on every startWithParams()
+    ma_context m_context;               // shared by every open (GUI thread only)
+    bool m_contextInitialized = false;
     ma_device m_device;
     ma_device_config m_deviceConfig;
     bool m_deviceInitialized = false;
+    DeviceProfile m_deviceProfile;
+    QStringList   m_pendingPrefetch;   // prefetchSamples() before any device rate was known
+    QThread*      m_profileCheckThread = nullptr;
+    void startProfileCheck();
+    void applyProfileCheck(const DeviceProfile& seen);
 
     int   m_sampleRate   = 44100;
-    int   m_bufferFrames = 256;
+    std::atomic<int> m_bufferFrames{256};   // device period; the producer reads it too
+
+    OutputConfig m_outputConfig;
+    bool         m_outputConfigDirty = false;   // reopen the device before the next start
+    OutputInfo   m_outputInfo;
+    // Non-f32 devices, or devices with more channels than the mix: the
+    // callback mixes f32 into m_mixScratch, widens it into m_fanScratch if
+    // needed and converts from there.  Both are sized when the device opens.
+    static constexpr int kConvertChunkFrames = 1024;
+    SampleVector m_mixScratch;
+    SampleVector m_fanScratch;
+    int          m_mixChannels = 1;   // interleaved channels doAudioCallback() writes
+    bool         m_chunkedOutput = false;   // audio thread: inside writeDeviceOutput()
+    OutputRouting m_outputRouting;    // GUI-side copy of the published matrix
+    TripleBuffer<OutputRouting> m_routingBuffer;
+    InputAnalyzer m_input;
+    std::shared_ptr<const PcmData> m_inputStandIn;
+    std::atomic<bool>    m_listening{false};
+    int64_t              m_listenPos = 0;          // callback-owned while listening
+    std::atomic<int64_t> m_startAlignNs{0};        // 0 = none
+    void feedAnalyzer(const float* input, int64_t bufferStart, unsigned frames, int64_t capturedNs);
+    void closeDevice();
+    void writeDeviceOutput(void* out, const float* in, unsigned frames);
     float m_sinePhase    = 0.0f;
 
-    QMap<QString, PCMBuffer> m_samples;
-    QString m_accentSample = "accent";
-    QString m_clickSample  = "click";
+    SampleBank m_bank;
+    std::atomic<bool> m_reloadSamplesRequested{false};   // audio -> GUI: device rate moved
+    std::atomic<bool> m_deviceRerouted{false};           // notification -> GUI
+    void reloadSamplesForRate(int rate);
+
+    // ── Background sample reload ──────────────────────────────────────────
+    // After a device rate change the worker re-decodes the loaded sounds for
+    // the new rate; the result is staged in m_bank and swapped in by the
+    // callback at the next bar line.  Until then voices play the old buffers
+    // resampled on the fly.  m_reloadJobs belongs to the worker while it runs.
+    QThread* m_reloadThread = nullptr;
+    int      m_reloadRate   = 0;
+    quint64  m_reloadBankSerial = 0;   // m_bankSerial when the reload started
+    quint64  m_bankSerial   = 0;       // bumped by loadSample()
+    std::vector<std::pair<int, PCMBuffer*>> m_reloadJobs;
+    void serviceSampleReload(bool wait);
+    void startSampleReload(int rate);
+    void finishSampleReload();
+    void refreshOutputInfo();
     float m_volume = 1.0f;
 
     // ── Legacy scheduling fields (used by old paths, kept for compat) ──
@@ -176,40 +535,154 @@ private:
 
     PulseCallback m_pulseCallback = nullptr;
 
-    std::vector<ActiveSample> activeSamples;
+    VoicePool m_voices;
     std::vector<CountInClick> m_countInClicks;
 
     // ── New state-machine fields ──────────────────────────────────────
+    // Owned by the bar producer thread while playing (by the GUI thread in
+    // startWithParams() while stopped).  The audio callback only consumes the
+    // prebuilt events in m_eventQueue.
     enum class EnginePlayState { Idle, CountIn, Playing };
     EnginePlayState m_playState         = EnginePlayState::Idle;
-    EngineParams    m_engineParams;
+    // Params are published by the GUI thread and read by the producer thread
+    // through a triple buffer, so neither side waits on the other.
+    // m_paramsWriteMutex only serialises writers.
+    TripleBuffer<EngineParams> m_paramsBuffer;
+    QMutex          m_paramsWriteMutex;
     bool            m_paramsChanged     = false;
-    int             m_currentTempo      = 120;  // tracks current stepped-up BPM
+    double          m_currentTempo      = 120;  // tracks current stepped-up BPM
     int             m_countInBarsLeft   = 0;
-    int64_t         m_playingBarSamplesAccum = 0; // accumulated playing samples for speed-trainer bar counting
-    int64_t         m_nextBarStart      = 0;    // absolute sample of next bar to generate
-    // Scheduled pulses sorted by absolute sample position
+    int64_t         m_playingBarTicksAccum = 0; // accumulated playing beat ticks for speed-trainer bar counting
+    BarClock        m_nextBar;                  // exact start of the next bar to generate
+    // Scheduled pulses in a FIFO ordered by absolute sample position.  Bars
+    // are appended in time order, so firing and pruning only touch the events
+    // that fall inside the current buffer.
     struct ScheduledPulse {
-        int64_t   samplePos;  // absolute
+        int64_t   samplePos;   // absolute, in units of sampleRate
+        int       sampleRate;  // rate the bar was built at; rescaled on read if the device rate moved
+        float     gain;        // track gain
+        uint32_t  epoch;       // timeline it was built on; stale ones are dropped
         AudioPulseEvent ev;
     };
-    std::vector<ScheduledPulse> m_scheduledPulses;
+    // Lookahead is bounded by bars, event count and memory rather than a
+    // fixed time: the producer always keeps kProducerBarsAhead bars (and at
+    // least kMinLeadMs) queued past the playhead, tops up to kLookaheadEvents
+    // within kMaxLookaheadMs, and never exceeds kEventQueueBudgetBytes.
+    static constexpr size_t kEventQueueBudgetBytes = 256 * 1024;
+    static constexpr size_t kLookaheadEvents       = 64;
+    static constexpr int    kProducerBarsAhead     = 1;
+    static constexpr int    kMinLeadMs             = 100;
+    static constexpr int    kMaxLookaheadMs        = 250;
+    static constexpr int    kProducerPollMs        = 5;
+    SpscRing<ScheduledPulse> m_eventQueue{kEventQueueBudgetBytes / sizeof(ScheduledPulse)};
+    BarScheduleCache   m_barCache;
+    int64_t     m_lastBarLength = 0;     // length of the most recent generated bar
+    int         m_producerRate  = 44100; // rate m_nextBar is expressed in
+
+    // ── Bar producer thread ───────────────────────────────────────────────
+    QThread*        m_producerThread = nullptr;
+    std::atomic<bool> m_producerRunning{false};
+    QMutex          m_producerMutex;     // only for m_producerWake; never on the audio thread
+    QWaitCondition  m_producerWake;
+    std::atomic<int64_t> m_playheadPos{0};     // callback -> producer: next sample to render
+    std::atomic<int>     m_streamRate{44100};  // callback -> producer: current device rate
+    std::atomic<int64_t> m_producedUntil{0};   // producer -> callback: end of the last queued bar
+    std::atomic<quint64> m_producerUnderruns{0};
+    // callback -> producer: bumped when the callback restarts the timeline at
+    // sample 0 (a device rate change from or to 0).  The producer then starts
+    // its next bar at 0, and tags what it queues with the epoch it built for.
+    std::atomic<uint32_t> m_timelineEpoch{0};
+    uint32_t             m_producerEpoch = 0;  // producer-owned
+    void restartTimeline();
+    void startProducer();
+    void stopProducer();
+    void producerLoop();
+    void produceBars(int64_t playhead);
+
     int m_barNumberForUi          = 0; // bar counter emitted in AudioPulseEvent.barNumber
-    int m_pendingStepUpTempoForTag = 0; // non-zero: tag next bar's first pulse with this
+    double m_pendingStepUpTempoForTag = 0; // non-zero: tag next bar's first pulse with this
+
+    // ── Tracks ────────────────────────────────────────────────────────────
+    // Every track compiles its bars into its own cache and lays them on its
+    // own BarClock.  A BarCursor holds the part of a track's current bar that
+    // is not queued yet; queuePendingPulses() merges the cursors into
+    // m_eventQueue in time order up to the end of the last main bar, and a
+    // full queue just pauses the merge until the callback has made room.
+    struct BarCursor {
+        const BarSchedule* bar = nullptr;   // in the track's cache
+        size_t   next        = 0;           // first pulse not queued yet
+        BarClock start;                     // where the bar begins, at `rate`
+        int      rate        = 0;
+        int      track       = 0;
+        float    gain        = 1.0f;
+        int      barNumber   = 0;
+        int      barsPerStep = 1;
+        double   newTempo    = 0;           // tagged on the first pulse
+
+        bool    pending() const { return bar && next < bar->pulses.size(); }
+        int64_t nextPos() const { return start.at(bar->pulseOffsets[next], bar->timeDen); }
+    };
+    struct TrackState {
+        BarScheduleCache cache;
+        BarCursor cursor;
+        BarClock  nextBar;           // start of the track's next bar
+        bool      playing = false;   // false: waits for the next main bar line
+        int       barNumber = 0;
+    };
+    BarCursor               m_mainCursor;   // the main bar, from m_barCache
+    std::vector<TrackState> m_tracks;       // parallel to EngineParams::tracks
+    double                  m_trackTempo = 0;   // tempo the playing tracks started at
+    bool queuePendingPulses();
+    void queuePulse(BarCursor& c);
+    void advanceTrackBar(TrackState& t, const TrackParams& params, int track);
+    void syncTracks(bool isCountIn);
+
+    // Playhead resets requested by the legacy scheduling API; applied by the
+    // callback at the start of its next buffer.
+    static constexpr int64_t kNoPlayheadReset = INT64_MIN;
+    std::atomic<int64_t> m_playheadResetTo{kNoPlayheadReset};
+    std::atomic<bool>    m_clearVoicesRequested{false};
     // ──────────────────────────────────────────────────────────────────
 
     static void miniAudioDataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
-    int doAudioCallback(float* output, unsigned int nBufferFrames);
+    static void miniAudioNotificationCallback(const ma_device_notification* pNotification);
+    // deviceOffset: frames of the device buffer before this chunk, when
+    // writeDeviceOutput() mixes one device buffer in several calls.
+    int doAudioCallback(float* output, unsigned int nBufferFrames, const float* input = nullptr,
+                        unsigned deviceOffset = 0);
+    void recordCallback(std::chrono::steady_clock::time_point callbackStart, unsigned frames);
 
     // State machine helpers
-    void advanceNextBar();    // generate next bar, handle step-up/count-in transitions
-    void resetStateMachine(const EngineParams& p, bool withCountIn);
-
-    PCMBuffer* currentSample(bool accent);
-    void emitUiPulse(const AudioPulseEvent& ev);
-
-    QMutex m_schedMutex;
-    void detectSampleRateSafe();
-    int  detectBestSampleRate();
-    QMutex m_sampleMutex;
+    bool advanceNextBar();    // generate next bar, handle step-up/count-in transitions
+    void resetStateMachine(bool withCountIn);
+    void pickUpEngineParams();   // producer thread: adopt the newest published params
+    bool m_offline = false;      // offline render engine: no device, no UI pulses
+    static constexpr int kOfflineBlockFrames = 512;
+
+    void emitUiPulse(const AudioPulseEvent& ev, int64_t samplePos, int64_t audibleNs);   // audio thread: enqueue only
+
+    // ── Audio → GUI pulse delivery ────────────────────────────────────────
+    // The callback pushes PulseRecords; a GUI-thread timer drains them into
+    // m_presentQueue, and m_presentTimer emits pulseUiEvent for each at its
+    // audible time, so no Qt event is allocated on the audio thread.
+    static constexpr size_t kPulseRingCapacity  = 1024;
+    static constexpr int    kPulseDrainIntervalMs = 4;
+    static constexpr int64_t kMaxPresentDelayNs = 1000000000;   // distrust anything later
+    SpscRing<PulseRecord> m_pulseRing{kPulseRingCapacity};
+    QTimer*  m_pulseDrainTimer = nullptr;
+    quint64  m_reportedPulseOverflows = 0;
+    void drainPulseRing();
+    std::deque<PulseRecord> m_presentQueue;   // GUI thread only
+    QTimer*  m_presentTimer = nullptr;
+    void presentDuePulses();
+    std::atomic<int64_t> m_outputLatencyNs{0};   // device buffering, set when the device opens
+    std::atomic<int64_t> m_inputLatencyNs{0};    // likewise for capture
+    int64_t  m_uiLatencyOffsetNs = 0;           // GUI thread only
+
+    // Instrumentation.  The callback never calls qDebug(); it posts to
+    // m_rtLog, which drainPulseRing() prints on the GUI thread.
+    EngineStats m_stats;
+    RtLog       m_rtLog;
+
+    QMutex m_schedMutex;   // legacy scheduling fields only; never taken by the callback
 };
@@ -0,0 +1,39 @@
+#include "enginebench.h"
+#include <QByteArray>
+#include <cstdio>
+
+// SH4DOWNOME-bench <mode> [options]: the engine benchmarks and checks,
+// without the GUI and without an audio device.
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--bench-mix") == 0)
+            return runMixBenchmark();
+        if (qstrcmp(argv[i], "--bench-callback") == 0)
+            return runCallbackBenchmark(argc, argv);
+        if (qstrcmp(argv[i], "--bench-resample") == 0)
+            return runResampleBenchmark();
+        if (qstrcmp(argv[i], "--bench-tracks") == 0)
+            return runTrackBenchmark(argc, argv);
+        if (qstrcmp(argv[i], "--bench-channels") == 0)
+            return runChannelBenchmark(argc, argv);
+        if (qstrcmp(argv[i], "--bench-queue") == 0)
+            return runQueueBenchmark(argc, argv);
+        if (qstrcmp(argv[i], "--bench-soundsets") == 0)
+            return runSoundSetBenchmark(argc, argv);
+        if (qstrcmp(argv[i], "--check-timing") == 0)
+            return runTimingCheck(argc, argv);
+        if (qstrcmp(argv[i], "--check-params") == 0)
+            return runParamsStress(argc, argv);
+        if (qstrcmp(argv[i], "--analyze-input") == 0)
+            return runInputAnalysis(argc, argv);
+        if (qstrcmp(argv[i], "--bench-tempo") == 0)
+            return runTempoBenchmark(argc, argv);
+    }
+    std::fprintf(stderr,
+                 "usage: %s --bench-mix | --bench-callback | --bench-resample | --bench-tracks |\n"
+                 "       --bench-channels | --bench-queue | --bench-soundsets | --bench-tempo <dir> |\n"
+                 "       --check-timing | --check-params | --analyze-input <wav>\n",
+                 argc > 0 ? argv[0] : "SH4DOWNOME-bench");
+    return 2;
+}
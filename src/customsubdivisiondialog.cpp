@@ -966,7 +966,7 @@ void CustomSubdivisionDialog::onPreviewClicked() {
     double totalBeats = 0.0;
     for (const auto& pulse : m_pattern.pulses)
         totalBeats += noteValueBeatFraction(pulse.noteValue, m_compoundTime);
-    int bpm = m_previewEngine->currentTempo();
+    double bpm = m_previewEngine->currentTempo();
     if (bpm <= 0) bpm = 120;
     double msPerBeat = 60000.0 / bpm;
     double barMs = totalBeats * msPerBeat;
@@ -0,0 +1,1197 @@
+#include "enginebench.h"
+#include "mixkernel.h"
+#include "audioengine.h"
+#include "resampler.h"
+#include "spscring.h"
+#include "pcmcache.h"
+#include "soundsets.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+// ── Allocation counting ───────────────────────────────────────────────────
+// The global (unaligned) operator new is replaced so the callback benchmark
+// can count heap allocations made on its own thread while it is measuring.
+// Everywhere else this costs one thread-local load per allocation.
+namespace { thread_local uint64_t* t_allocCounter = nullptr; }
+
+void* operator new(std::size_t n)
+{
+    if (t_allocCounter) ++*t_allocCounter;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The mix loop as it was before the SIMD kernels: scalar, reading samples
+// through a pointer to the owning vector.
+void addScaledLegacy(float* dst, const std::vector<float>* src, int pos, float gain, int n)
+{
+    for (int k = 0; k < n; ++k)
+        dst[k] += (*src)[pos + k] * gain;
+}
+
+constexpr int kBenchVoices = 16;
+constexpr double kMinSeconds = 0.2;   // per measurement
+
+template <typename MixOne>
+double voicesPerMs(int frames, MixOne&& mixOne, float& sink, int channels = 1)
+{
+    std::vector<float> out(size_t(frames) * size_t(channels));
+    long long voices = 0;
+    const Clock::time_point t0 = Clock::now();
+    double elapsed = 0.0;
+    do {
+        for (int rep = 0; rep < 64; ++rep) {
+            for (int v = 0; v < kBenchVoices; ++v)
+                mixOne(out.data(), v, frames);
+            voices += kBenchVoices;
+        }
+        elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+    } while (elapsed < kMinSeconds);
+    sink += out[frames / 2];
+    return double(voices) / (elapsed * 1000.0);
+}
+
+} // namespace
+
+int runMixBenchmark()
+{
+    const int frameSizes[] = {64, 256, 1024};
+    const int sampleLen = 1024 * 4;
+
+    // One distinct sample per voice so the working set resembles real playback.
+    std::vector<std::vector<float>> legacyData(kBenchVoices, std::vector<float>(sampleLen));
+    std::vector<SampleVector> alignedData(kBenchVoices, SampleVector(sampleLen));
+    for (int v = 0; v < kBenchVoices; ++v) {
+        for (int i = 0; i < sampleLen; ++i) {
+            float s = std::sin(0.01f * float(i * (v + 1)));
+            legacyData[v][i]  = s;
+            alignedData[v][i] = s;
+        }
+    }
+
+    float sink = 0.0f;
+    std::printf("%-8s %8s %16s\n", "kernel", "frames", "voices/ms");
+    for (int frames : frameSizes) {
+        double legacy = voicesPerMs(frames, [&](float* out, int v, int n) {
+            addScaledLegacy(out, &legacyData[v], 0, 0.5f, n);
+        }, sink);
+        std::printf("%-8s %8d %16.1f\n", "legacy", frames, legacy);
+
+        for (const MixKernel* kernel : availableMixKernels()) {
+            double rate = voicesPerMs(frames, [&](float* out, int v, int n) {
+                kernel->addScaled(out, alignedData[v].data(), 0.5f, n);
+            }, sink);
+            std::printf("%-8s %8d %16.1f  (x%.2f)\n", kernel->name, frames, rate, rate / legacy);
+        }
+    }
+    std::printf("selected kernel: %s  (checksum %g)\n", bestMixKernel().name, double(sink));
+    return 0;
+}
+
+namespace {
+
+// EngineParams for each benchmarked playback mode at the given tempo.
+EngineParams benchParams(const QString& mode, double bpm, bool* withCountIn)
+{
+    EngineParams p;
+    p.bpm = p.startTempo = bpm;
+    p.accents = {true, false, false, false};
+    p.subdivision.pulses = { {NoteValue::Eighth, false, false}, {NoteValue::Eighth, false, false} };
+    *withCountIn = false;
+
+    if (mode == QLatin1String("custom")) {
+        p.subdivision.category = SubdivisionCategory::Custom;
+        p.subdivision.pulses = { {NoteValue::DottedEighth, false, true}, {NoteValue::Sixteenth, false, false},
+                                 {NoteValue::TripletEighth, false, false}, {NoteValue::TripletEighth, true, false},
+                                 {NoteValue::TripletEighth, false, false}, {NoteValue::Quarter, false, true} };
+    } else if (mode == QLatin1String("polyrhythm")) {
+        p.polyrhythmEnabled = true;
+        p.polyMain      = 3 * 4;
+        p.polySecondary = 2 * 4;
+    } else if (mode == QLatin1String("speed-trainer")) {
+        p.speedEnabled = true;
+        p.barsPerStep  = 1;
+        p.tempoStep    = 5;
+        p.maxTempo     = 300;
+    } else if (mode == QLatin1String("count-in")) {
+        // Count-in at the start and after every trainer step.
+        p.countInEnabled = true;
+        p.speedEnabled   = true;
+        p.barsPerStep    = 1;
+        p.tempoStep      = 5;
+        p.maxTempo       = 300;
+        *withCountIn     = true;
+    }
+    return p;
+}
+
+struct CallbackTimes {
+    std::vector<int64_t> ns;        // per callback, sorted
+    double   totalNs    = 0.0;
+    int64_t  producerNs = 0;        // producer steps, not part of ns
+    uint64_t allocs     = 0;        // made inside the callbacks
+
+    qint64 pct(double q) const { return qint64(ns[std::min(ns.size() - 1, size_t(q * ns.size()))]); }
+};
+
+// Drives a started offline engine as a virtual device: after a warm-up,
+// `callbacks` times one producer step and one timed device callback.
+CallbackTimes timeCallbacks(AudioEngine& engine, int frames, int callbacks, int channels = 1)
+{
+    CallbackTimes t;
+    std::vector<float> out(size_t(frames) * size_t(channels));
+    t.ns.resize(callbacks);
+
+    for (int i = 0; i < 16; ++i) {   // warm caches and the voice pool
+        engine.produceOffline();
+        engine.offlineCallback(out.data(), frames);
+    }
+    for (int i = 0; i < callbacks; ++i) {
+        const Clock::time_point p0 = Clock::now();
+        engine.produceOffline();   // the producer thread's work
+        t.producerNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - p0).count();
+        t_allocCounter = &t.allocs;
+        const Clock::time_point t0 = Clock::now();
+        engine.offlineCallback(out.data(), frames);
+        const Clock::time_point t1 = Clock::now();
+        t_allocCounter = nullptr;
+        t.ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }
+
+    for (int64_t v : t.ns) t.totalNs += double(v);
+    std::sort(t.ns.begin(), t.ns.end());
+    return t;
+}
+
+QJsonObject benchCallback(const QString& mode, int sampleRate, int frames, int bpm, double seconds)
+{
+    AudioEngine engine;
+    engine.prepareOffline(sampleRate, frames);
+    engine.loadSample("accent", QStringLiteral(":/resources/accent.wav"));
+    engine.loadSample("click",  QStringLiteral(":/resources/click.wav"));
+
+    bool withCountIn = false;
+    engine.startOffline(benchParams(mode, bpm, &withCountIn), withCountIn);
+
+    const int callbacks = std::max(256, int(seconds * sampleRate / frames));
+    const CallbackTimes t = timeCallbacks(engine, frames, callbacks);
+
+    QJsonObject r;
+    r["mode"]              = mode;
+    r["sampleRate"]        = sampleRate;
+    r["bufferFrames"]      = frames;
+    r["bpm"]               = bpm;
+    r["callbacks"]         = callbacks;
+    r["nsPerFrame"]        = t.totalNs / (double(callbacks) * frames);
+    r["p50Ns"]             = t.pct(0.50);
+    r["p99Ns"]             = t.pct(0.99);
+    r["maxNs"]             = qint64(t.ns.back());
+    r["allocsPerCallback"] = double(t.allocs) / callbacks;
+    r["peakVoices"]        = engine.voicePool().peakVoices();
+    r["stolenVoices"]      = qint64(engine.stats().stolenVoices);
+    r["worstCaseMix"]      = qint64(engine.stats().worstCaseMix);
+    return r;
+}
+
+} // namespace
+
+namespace {
+
+// The sample-rate converter as it was before the polyphase resampler.
+std::vector<float> resampleLinearLegacy(const std::vector<float>& data, int srcRate, int dstRate)
+{
+    double rateRatio = double(dstRate) / srcRate;
+    size_t newLength = std::max<size_t>(1, size_t(data.size() * rateRatio));
+    std::vector<float> resampled(newLength);
+    for (size_t i = 0; i < newLength; ++i) {
+        double srcPos = i / rateRatio;
+        size_t idx0 = size_t(srcPos);
+        size_t idx1 = std::min(idx0 + 1, data.size() - 1);
+        double frac = srcPos - idx0;
+        resampled[i] = float((1.0 - frac) * data[idx0] + frac * data[idx1]);
+    }
+    return resampled;
+}
+
+std::vector<float> sine(double freq, int rate, size_t n)
+{
+    std::vector<float> s(n);
+    for (size_t i = 0; i < n; ++i)
+        s[i] = float(0.5 * std::sin(2.0 * 3.14159265358979323846 * freq * double(i) / rate));
+    return s;
+}
+
+// Signal-to-error ratio of out against the ideal tone at dstRate, ignoring
+// the filter's ramp-in and ramp-out at both ends.
+double toneSnrDb(const float* out, size_t n, double freq, int dstRate)
+{
+    const size_t edge = 256;
+    double sig = 0.0, err = 0.0;
+    for (size_t i = edge; i + edge < n; ++i) {
+        const double ideal = 0.5 * std::sin(2.0 * 3.14159265358979323846 * freq * double(i) / dstRate);
+        sig += ideal * ideal;
+        err += (out[i] - ideal) * (out[i] - ideal);
+    }
+    return 10.0 * std::log10(sig / std::max(err, 1e-30));
+}
+
+// Level, relative to the input, of a tone that should have been filtered out.
+double leakDb(const float* out, size_t n)
+{
+    const size_t edge = 256;
+    double e = 0.0;
+    size_t count = 0;
+    for (size_t i = edge; i + edge < n; ++i, ++count)
+        e += double(out[i]) * out[i];
+    return 10.0 * std::log10(std::max(e / std::max<size_t>(count, 1), 1e-30) / 0.125);
+}
+
+// Alias rejection only means something when decimating.
+const char* aliasCell(bool decimating, const float* out, size_t n, char (&buf)[16])
+{
+    if (!decimating) return "-";
+    std::snprintf(buf, sizeof buf, "%.1f", leakDb(out, n));
+    return buf;
+}
+
+template <typename Fn>
+double samplesPerSecond(size_t outputSamples, Fn&& fn)
+{
+    int reps = 0;
+    const Clock::time_point t0 = Clock::now();
+    double elapsed = 0.0;
+    do {
+        fn();
+        ++reps;
+        elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+    } while (elapsed < kMinSeconds);
+    return double(outputSamples) * reps / elapsed;
+}
+
+} // namespace
+
+int runResampleBenchmark()
+{
+    const std::pair<int, int> pairs[] = { {44100, 48000}, {48000, 44100}, {48000, 96000}, {96000, 44100} };
+    float sink = 0.0f;
+
+    std::printf("%-14s %-9s %10s %10s %10s %10s\n",
+                "conversion", "method", "Msmp/s", "SNR 1k", "SNR high", "alias dB");
+    for (const auto& [src, dst] : pairs) {
+        const size_t n = size_t(src);   // one second
+        const double highTone  = 0.4 * std::min(src, dst);
+        const double aliasTone = 0.475 * src;   // above the output Nyquist when decimating
+        const std::vector<float> lo = sine(1000.0, src, n), hi = sine(highTone, src, n), al = sine(aliasTone, src, n);
+        const SampleVector loA(lo.begin(), lo.end()), hiA(hi.begin(), hi.end()), alA(al.begin(), al.end());
+        char label[32], cell[16];
+        std::snprintf(label, sizeof label, "%d>%d", src, dst);
+
+        {
+            std::vector<float> out;
+            const double rate = samplesPerSecond(resampleLinearLegacy(lo, src, dst).size(), [&] {
+                out = resampleLinearLegacy(lo, src, dst);
+                sink += out[out.size() / 2];
+            });
+            const std::vector<float> outHi = resampleLinearLegacy(hi, src, dst);
+            const std::vector<float> outAl = resampleLinearLegacy(al, src, dst);
+            std::printf("%-14s %-9s %10.1f %10.1f %10.1f %10s\n", label, "linear", rate / 1e6,
+                        toneSnrDb(out.data(), out.size(), 1000.0, dst),
+                        toneSnrDb(outHi.data(), outHi.size(), highTone, dst),
+                        aliasCell(dst < src, outAl.data(), outAl.size(), cell));
+        }
+        {
+            SampleVector out;
+            const double rate = samplesPerSecond(PolyphaseResampler(src, dst).outputLength(n), [&] {
+                out = PolyphaseResampler(src, dst).process(loA.data(), n);   // includes filter design
+                sink += out[out.size() / 2];
+            });
+            PolyphaseResampler r(src, dst);
+            const SampleVector outHi = r.process(hiA.data(), n);
+            const SampleVector outAl = r.process(alA.data(), n);
+            std::printf("%-14s %-9s %10.1f %10.1f %10.1f %10s   (%d taps x %d phases)\n", label, "polyphase", rate / 1e6,
+                        toneSnrDb(out.data(), out.size(), 1000.0, dst),
+                        toneSnrDb(outHi.data(), outHi.size(), highTone, dst),
+                        aliasCell(dst < src, outAl.data(), outAl.size(), cell),
+                        r.taps(), r.phases());
+        }
+    }
+    std::printf("kernel: %s  (checksum %g)\n", bestMixKernel().name, double(sink));
+    return 0;
+}
+
+int runCallbackBenchmark(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"bench-callback", "Callback benchmark mode."});
+    parser.addOption({"quick", "Reduced sweep for smoke runs."});
+    parser.addOption({"out", "Write the JSON report to a file instead of stdout.", "file"});
+    parser.process(app);
+
+    const bool quick = parser.isSet("quick");
+    const QList<int> bufferSizes = quick ? QList<int>{64, 512} : QList<int>{32, 64, 128, 256, 512, 1024, 2048};
+    const QList<int> sampleRates = quick ? QList<int>{48000}   : QList<int>{44100, 48000, 96000};
+    const QList<int> tempos      = quick ? QList<int>{1, 120, 300} : QList<int>{1, 30, 60, 120, 180, 240, 300};
+    const QStringList modes{"standard", "custom", "polyrhythm", "speed-trainer", "count-in"};
+    const double seconds = quick ? 1.0 : 5.0;   // synthetic audio per configuration
+
+    QJsonArray results;
+    for (const QString& mode : modes)
+        for (int rate : sampleRates)
+            for (int frames : bufferSizes)
+                for (int bpm : tempos)
+                    results.append(benchCallback(mode, rate, frames, bpm, seconds));
+
+    QJsonObject report;
+    report["benchmark"] = QStringLiteral("audio-callback");
+    report["version"]   = QStringLiteral(APP_VERSION);
+    report["mixKernel"] = QString::fromLatin1(bestMixKernel().name);
+    report["results"]   = results;
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet("out")) {
+        QFile f(parser.value("out"));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(json) != json.size()) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value("out")));
+            return 1;
+        }
+    } else {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return 0;
+}
+
+namespace {
+
+struct TimingResult {
+    int64_t bars      = 0;
+    double  maxError  = 0.0;   // samples, any pulse against its ideal time
+    bool    exact     = true;  // every bar line on floor(k * exact bar length)
+    double  legacyMs  = 0.0;   // drift of int(samples per beat) bars over the same run
+};
+
+// Lays `seconds` of identical bars end to end with a BarClock, the way the
+// producer thread does, and compares each pulse with its ideal time.
+TimingResult checkTiming(const EngineParams& p, bool countIn, int rate, double seconds)
+{
+    TimingResult r;
+    const BarSchedule bar = buildBarSchedule(p, p.bpm, countIn, rate);
+    if (bar.barLength <= 0) { r.exact = false; return r; }
+
+    const double bpm       = double(std::llround(p.bpm * TickRate::kTempoScale)) / TickRate::kTempoScale;
+    const double perTick   = double(rate) * 60.0 / (bpm * double(TickRate::kTicksPerBeat));
+    const int64_t den      = bar.timeDen;
+    const int64_t whole    = bar.barLength / den;
+    const int64_t part     = bar.barLength % den;
+    r.bars = int64_t(std::ceil(seconds * rate / (double(bar.barLength) / double(den))));
+
+    BarClock clock;
+    for (int64_t k = 0; k < r.bars; ++k) {
+        if (clock.sample != k * whole + k * part / den)
+            r.exact = false;
+        const double idealStart = double(k) * double(bar.barTicks) * perTick;
+        for (size_t i = 0; i < bar.pulses.size(); ++i) {
+            const double ideal = idealStart + double(bar.pulseOffsets[i]) / double(den);
+            r.maxError = std::max(r.maxError, std::abs(double(clock.at(bar.pulseOffsets[i], den)) - ideal));
+        }
+        clock.advance(bar.barLength, den);
+    }
+
+    if (bar.barTicks % TickRate::kTicksPerBeat == 0) {
+        const int64_t legacyBar = bar.barTicks / TickRate::kTicksPerBeat * int64_t(rate * (60.0 / p.bpm));
+        const double  ideal     = double(r.bars) * double(bar.barTicks) * perTick;
+        r.legacyMs = (ideal - double(r.bars * legacyBar)) * 1000.0 / rate;
+    }
+    return r;
+}
+
+} // namespace
+
+int runTimingCheck(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"check-timing", "Schedule drift check mode."});
+    parser.addOption({"hours", "Simulated playback per configuration.", "hours", "12"});
+    parser.process(app);
+
+    const double seconds = parser.value("hours").toDouble() * 3600.0;
+    const QList<int>    sampleRates{22050, 44100, 48000, 88200, 96000, 192000};
+    const QList<double> tempos{30, 59.94, 60, 97, 119.5, 120, 133.333, 176.4, 240, 300};
+    const QStringList   modes{"standard", "compound", "custom", "polyrhythm", "count-in"};
+
+    int failures = 0;
+    double worstLegacyMs = 0.0;
+    std::printf("%-11s %7s %8s %9s %12s %10s  %s\n",
+                "mode", "rate", "bpm", "bars", "max err", "legacy ms", "");
+    for (const QString& mode : modes) {
+        for (int rate : sampleRates) {
+            for (double bpm : tempos) {
+                bool countIn = false;
+                EngineParams p = benchParams(mode, bpm, &countIn);
+                if (mode == QLatin1String("compound")) {
+                    p.numerator   = 6;
+                    p.denominator = 8;
+                    p.subdivision.pulses = { {NoteValue::DottedQuarter, false, false} };
+                } else if (mode == QLatin1String("polyrhythm")) {
+                    p.polyMain      = 13;
+                    p.polySecondary = 17;
+                }
+
+                const TimingResult r = checkTiming(p, countIn, rate, seconds);
+                const bool ok = r.exact && r.maxError < 1.0;
+                failures += ok ? 0 : 1;
+                worstLegacyMs = std::max(worstLegacyMs, std::abs(r.legacyMs));
+                std::printf("%-11s %7d %8.3f %9lld %12.3f %10.1f  %s\n", qPrintable(mode), rate, bpm,
+                            (long long)r.bars, r.maxError, r.legacyMs, ok ? "ok" : "DRIFT");
+            }
+        }
+    }
+    std::printf("%g h per configuration: %d drifting, int(samples per beat) bars would drift up to %.1f ms\n",
+                seconds / 3600.0, failures, worstLegacyMs);
+    return failures == 0 ? 0 : 1;
+}
+
+namespace {
+
+// An event on the device timeline, as both queues hold it.
+struct QueuedPulse {
+    int64_t         samplePos;
+    AudioPulseEvent ev;
+};
+
+struct QueueTimes {
+    std::vector<int64_t> ns;          // per callback, sorted
+    double   totalNs    = 0.0;
+    double   pending    = 0.0;        // mean events queued after a callback
+    int64_t  producerNs = 0;          // producer steps, not part of ns
+    uint64_t allocs     = 0;          // made inside the callbacks
+    uint64_t fired      = 0;
+
+    double meanNs() const { return totalNs / double(ns.size()); }
+    qint64 pct(double q) const { return qint64(ns[std::min(ns.size() - 1, size_t(q * ns.size()))]); }
+    void finish() { for (int64_t v : ns) totalNs += double(v); std::sort(ns.begin(), ns.end()); }
+};
+
+// Stands in for triggering a voice and posting the UI pulse, identically for
+// both queues.
+inline void fire(const QueuedPulse& sp, int64_t bufferStart, QueueTimes& t)
+{
+    t.fired += uint64_t(sp.samplePos - bufferStart) + uint64_t(sp.ev.soundId + 2);
+}
+
+// The queue as it was before the event ring: a vector the callback extended
+// to two seconds ahead (building each bar on the spot), scanned in full for
+// the buffer's events and then pruned with remove_if.
+QueueTimes legacyQueue(const EngineParams& p, int rate, int frames, int callbacks)
+{
+    QueueTimes t;
+    t.ns.resize(callbacks);
+    std::vector<QueuedPulse> pulses;
+    BarClock nextBar;
+
+    for (int i = 0; i < callbacks; ++i) {
+        const int64_t bufferStart = int64_t(i) * frames;
+        const int64_t bufferEnd   = bufferStart + frames;
+        t_allocCounter = &t.allocs;
+        const Clock::time_point t0 = Clock::now();
+        while (nextBar.sample < bufferEnd + int64_t(rate) * 2) {
+            const BarSchedule bar = buildBarSchedule(p, p.bpm, false, rate);
+            for (size_t k = 0; k < bar.pulses.size(); ++k)
+                pulses.push_back({nextBar.at(bar.pulseOffsets[k], bar.timeDen), bar.pulses[k]});
+            nextBar.advance(bar.barLength, bar.timeDen);
+        }
+        for (const QueuedPulse& sp : pulses) {
+            if (sp.samplePos < bufferStart || sp.samplePos >= bufferEnd) continue;
+            fire(sp, bufferStart, t);
+        }
+        pulses.erase(std::remove_if(pulses.begin(), pulses.end(),
+                                    [bufferEnd](const QueuedPulse& sp) { return sp.samplePos < bufferEnd; }),
+                     pulses.end());
+        const Clock::time_point t1 = Clock::now();
+        t_allocCounter = nullptr;
+        t.ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        t.pending += double(pulses.size());
+    }
+    t.pending /= callbacks;
+    t.finish();
+    return t;
+}
+
+// The event ring under AudioEngine::produceBars' policy: a producer step
+// (timed apart, it has its own thread) keeps one bar and at least 100 ms
+// queued and tops up to 64 events within 250 ms, from a cached bar; the
+// callback pops what falls inside its buffer.
+QueueTimes ringQueue(const EngineParams& p, int rate, int frames, int callbacks)
+{
+    QueueTimes t;
+    t.ns.resize(callbacks);
+    SpscRing<QueuedPulse> ring(256 * 1024 / sizeof(QueuedPulse));
+    const BarSchedule bar = buildBarSchedule(p, p.bpm, false, rate);
+    const int64_t barSamples = bar.barLength / bar.timeDen;
+    BarClock nextBar;
+
+    for (int i = 0; i < callbacks; ++i) {
+        const int64_t bufferStart = int64_t(i) * frames;
+        const int64_t bufferEnd   = bufferStart + frames;
+
+        const Clock::time_point p0 = Clock::now();
+        const int64_t minLead  = std::max<int64_t>(int64_t(rate) / 10, 4 * int64_t(frames));
+        const int64_t required = bufferStart + std::max(barSamples, minLead);
+        const int64_t horizon  = bufferStart + int64_t(rate) / 4;
+        while (ring.freeSpace() >= bar.pulses.size() &&
+               (nextBar.sample < required || (ring.size() < 64 && nextBar.sample < horizon))) {
+            for (size_t k = 0; k < bar.pulses.size(); ++k)
+                ring.push({nextBar.at(bar.pulseOffsets[k], bar.timeDen), bar.pulses[k]});
+            nextBar.advance(bar.barLength, bar.timeDen);
+        }
+        t.producerNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - p0).count();
+
+        t_allocCounter = &t.allocs;
+        const Clock::time_point t0 = Clock::now();
+        while (const QueuedPulse* sp = ring.front()) {
+            if (sp->samplePos >= bufferEnd) break;
+            fire(*sp, bufferStart, t);
+            ring.discardFront();
+        }
+        const Clock::time_point t1 = Clock::now();
+        t_allocCounter = nullptr;
+        t.ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        t.pending += double(ring.size());
+    }
+    t.pending /= callbacks;
+    t.finish();
+    return t;
+}
+
+// A bar of n equal pulses per beat, 4/4 unless given.
+EngineParams densePattern(NoteValue value, int perBeat, int numerator = 4, int denominator = 4)
+{
+    EngineParams p;
+    p.bpm = p.startTempo = 300;
+    p.numerator   = numerator;
+    p.denominator = denominator;
+    p.accents = {true};
+    p.subdivision.pulses.clear();
+    for (int i = 0; i < perBeat; ++i)
+        p.subdivision.pulses.append({value, false, false});
+    return p;
+}
+
+} // namespace
+
+int runQueueBenchmark(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"bench-queue", "Event queue benchmark mode."});
+    parser.addOption({"seconds", "Synthetic audio per pattern and buffer size.", "seconds", "60"});
+    parser.process(app);
+
+    const double seconds = parser.value("seconds").toDouble();
+    const int rate = 48000;
+    EngineParams poly = densePattern(NoteValue::Quarter, 1);
+    poly.polyrhythmEnabled = true;
+    poly.polyMain      = 16 * 4;
+    poly.polySecondary = 15 * 4;
+    const std::pair<const char*, EngineParams> patterns[] = {
+        {"64ths",         densePattern(NoteValue::SixtyFourth, 16)},
+        {"12/8 64ths",    densePattern(NoteValue::SixtyFourth, 24, 12, 8)},
+        {"nonuplets",     densePattern(NoteValue::NonupletSixteenth, 9)},
+        {"poly 64:60",    poly},
+    };
+
+    std::printf("%d Hz, 300 BPM; before: vector with a 2 s lookahead, scanned and pruned in the callback;\n"
+                "after: event ring filled by the producer (its time shown apart), popped in the callback\n", rate);
+    std::printf("%-14s %6s %9s %17s %17s %17s %8s %9s %13s\n", "pattern", "frames", "pulses/s",
+                "pending bef/aft", "mean ns bef/aft", "p99 ns bef/aft", "speedup", "allocs/cb", "producer ns/cb");
+    bool ok = true;
+    for (const auto& [name, p] : patterns) {
+        const BarSchedule bar = buildBarSchedule(p, p.bpm, false, rate);
+        const double pulsesPerSec = double(bar.pulses.size()) * rate * double(bar.timeDen) / double(bar.barLength);
+        for (int frames : {64, 256, 1024}) {
+            const int callbacks = std::max(256, int(seconds * rate / frames));
+            const QueueTimes before = legacyQueue(p, rate, frames, callbacks);
+            const QueueTimes after  = ringQueue(p, rate, frames, callbacks);
+            ok = ok && before.fired == after.fired;   // same events at the same offsets
+            std::printf("%-14s %6d %9.0f %8.0f/%-8.1f %8.0f/%-8.0f %8lld/%-8lld %7.1fx %4.2f/%-4.2f %13.0f\n",
+                        name, frames, pulsesPerSec, before.pending, after.pending,
+                        before.meanNs(), after.meanNs(), (long long)before.pct(0.99), (long long)after.pct(0.99),
+                        before.meanNs() / std::max(1.0, after.meanNs()),
+                        double(before.allocs) / callbacks, double(after.allocs) / callbacks,
+                        double(after.producerNs) / callbacks);
+        }
+    }
+    if (!ok)
+        std::printf("the two queues fired different events\n");
+    return ok ? 0 : 1;
+}
+
+namespace {
+
+// Snapshot `tag` of the params stress test.  Every field is derived from the
+// tag, which rides in maxTempo (unread with the trainer off), so a snapshot
+// mixing two publishes shows up as a mismatch.
+EngineParams stressParams(uint32_t tag)
+{
+    static const NoteValue beatNotes[] = { NoteValue::Quarter, NoteValue::Eighth,
+                                           NoteValue::TripletEighth, NoteValue::Sixteenth };
+    EngineParams p;
+    p.bpm = p.startTempo = 60 + tag % 181;
+    p.maxTempo  = tag;
+    p.numerator = 2 + int(tag % 6);
+    p.accents.assign(size_t(p.numerator), false);
+    p.accents[tag % uint32_t(p.numerator)] = true;
+    const int perBeat = 1 + int(tag / 7 % 4);
+    for (int i = 0; i < perBeat; ++i)
+        p.subdivision.pulses.append({beatNotes[perBeat - 1], false, false});
+    for (uint32_t t = 0; t < tag % 3; ++t) {
+        TrackParams track;
+        track.numerator = 3 + int((tag + t) % 4);
+        track.subdivision.pulses = { {NoteValue::Quarter, false, false} };
+        track.accents.assign(size_t(track.numerator), false);
+        track.accents[0] = true;
+        p.tracks.push_back(track);
+    }
+    return p;
+}
+
+bool stressParamsIntact(const EngineParams& p)
+{
+    const EngineParams want = stressParams(uint32_t(p.maxTempo));
+    if (p.bpm != want.bpm || p.numerator != want.numerator || p.accents != want.accents
+        || p.subdivision.pulses.size() != want.subdivision.pulses.size()
+        || p.tracks.size() != want.tracks.size())
+        return false;
+    for (size_t i = 0; i < p.subdivision.pulses.size(); ++i)
+        if (p.subdivision.pulses[i].noteValue != want.subdivision.pulses[i].noteValue)
+            return false;
+    for (size_t t = 0; t < p.tracks.size(); ++t)
+        if (p.tracks[t].numerator != want.tracks[t].numerator || p.tracks[t].accents != want.tracks[t].accents)
+            return false;
+    return true;
+}
+
+} // namespace
+
+int runParamsStress(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"check-params", "Concurrent setEngineParams stress mode."});
+    parser.addOption({"writers", "Threads calling setEngineParams.", "n", "4"});
+    parser.addOption({"seconds", "Wall time to run for.", "seconds", "10"});
+    parser.process(app);
+
+    const int    writers = std::max(1, parser.value("writers").toInt());
+    const double seconds = std::max(0.1, parser.value("seconds").toDouble());
+    const int    rate    = 48000;
+    const int    frames  = 256;
+
+    AudioEngine engine;
+    engine.prepareOffline(rate, frames);
+    engine.loadSample("accent", QStringLiteral(":/resources/accent.wav"));
+    engine.loadSample("click",  QStringLiteral(":/resources/click.wav"));
+    engine.startOffline(stressParams(0), false);
+
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> published(size_t(writers), 0);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w] {
+            uint64_t& n = published[size_t(w)];
+            for (uint32_t tag = uint32_t(w + 1); !stop.load(std::memory_order_relaxed); tag += uint32_t(writers)) {
+                engine.setEngineParams(stressParams(tag));
+                ++n;
+            }
+        });
+    }
+
+    // This thread is the producer and the device.
+    std::vector<float> out(frames);
+    uint64_t callbacks = 0, adopted = 0, torn = 0, allocs = 0;
+    int64_t  maxNs = 0, silentRun = 0, longestSilence = 0;
+    uint32_t lastTag = 0;
+    const Clock::time_point t0 = Clock::now();
+    while (std::chrono::duration<double>(Clock::now() - t0).count() < seconds) {
+        engine.produceOffline();
+        const EngineParams& p = engine.offlineParams();
+        if (uint32_t(p.maxTempo) != lastTag) {
+            lastTag = uint32_t(p.maxTempo);
+            ++adopted;
+            if (!stressParamsIntact(p)) ++torn;
+        }
+
+        t_allocCounter = &allocs;
+        const Clock::time_point c0 = Clock::now();
+        engine.offlineCallback(out.data(), frames);
+        maxNs = std::max<int64_t>(maxNs, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - c0).count());
+        t_allocCounter = nullptr;
+        ++callbacks;
+
+        const bool silent = std::all_of(out.begin(), out.end(), [](float s) { return std::abs(s) < 1e-6f; });
+        silentRun = silent ? silentRun + frames : 0;
+        longestSilence = std::max(longestSilence, silentRun);
+    }
+    stop.store(true);
+    for (std::thread& t : threads) t.join();
+
+    uint64_t publishes = 0;
+    for (uint64_t n : published) publishes += n;
+    const double audioSeconds = double(callbacks) * frames / rate;
+    const double gapSeconds   = double(longestSilence) / rate;
+    // The slowest snapshot clicks every beat at 60 BPM; anything much longer
+    // means the producer stopped queueing bars.
+    const bool stalled = gapSeconds > 2.0;
+    std::printf("%d writers, %.1f s: %llu publishes, %llu adopted by the producer, %llu torn\n",
+                writers, seconds, (unsigned long long)publishes, (unsigned long long)adopted,
+                (unsigned long long)torn);
+    std::printf("%llu callbacks (%.1f s of audio): %llu allocations, max %.1f us, longest silence %.2f s\n",
+                (unsigned long long)callbacks, audioSeconds, (unsigned long long)allocs,
+                maxNs / 1000.0, gapSeconds);
+    const bool ok = torn == 0 && allocs == 0 && !stalled && adopted > 1;
+    std::printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+namespace {
+
+// Track i of the track benchmark: simple meters that rarely share a bar line,
+// each with a different one-beat subdivision.
+TrackParams benchTrack(int i)
+{
+    static const int meters[][2] = { {3, 4}, {5, 4}, {7, 8}, {5, 8}, {7, 4}, {11, 8}, {13, 8}, {2, 4} };
+    static const QVector<SubdivisionPulse> beats[] = {
+        { {NoteValue::Eighth, false, false}, {NoteValue::Eighth, false, false} },
+        { {NoteValue::TripletEighth, false, false}, {NoteValue::TripletEighth, false, false},
+          {NoteValue::TripletEighth, false, false} },
+        { {NoteValue::Quarter, false, false} },
+        { {NoteValue::Sixteenth, false, false}, {NoteValue::Sixteenth, false, false},
+          {NoteValue::Sixteenth, false, false}, {NoteValue::Sixteenth, false, false} },
+    };
+    TrackParams t;
+    t.numerator   = meters[i % 8][0];
+    t.denominator = meters[i % 8][1];
+    t.subdivision.pulses = beats[i % 4];
+    t.accents = {true};
+    t.gain    = 0.5f;
+    return t;
+}
+
+// Scheduled pulses per second of the main bar and its tracks.
+double pulsesPerSecond(const EngineParams& p, int rate)
+{
+    double total = 0.0;
+    auto add = [&](const BarParams& bar) {
+        const BarSchedule s = buildBarSchedule(bar, p.bpm, false, rate);
+        if (s.barLength > 0)
+            total += double(s.pulses.size()) * rate * double(s.timeDen) / double(s.barLength);
+    };
+    add(p);
+    for (const TrackParams& t : p.tracks) add(t);
+    return total;
+}
+
+} // namespace
+
+int runTrackBenchmark(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"bench-tracks", "Polymeter track benchmark mode."});
+    parser.addOption({"seconds", "Synthetic audio per track count.", "seconds", "10"});
+    parser.process(app);
+
+    const double seconds = parser.value("seconds").toDouble();
+    const int rate   = 48000;
+    const int frames = 256;
+    const int bpm    = 120;
+    const QList<int> trackCounts{0, 1, 2, 4, 8, 16, EngineParams::kMaxTracks};
+
+    std::printf("%d Hz, %d-frame buffers, %d BPM, 4/4 eighths plus n tracks\n", rate, frames, bpm);
+    std::printf("%6s %9s %7s %9s %8s %8s %8s %12s %7s\n", "tracks", "pulses/s", "voices",
+                "ns/frame", "p50 us", "p99 us", "max us", "producer %", "allocs");
+    for (int n : trackCounts) {
+        bool withCountIn = false;
+        EngineParams p = benchParams(QStringLiteral("standard"), bpm, &withCountIn);
+        for (int i = 0; i < n; ++i)
+            p.tracks.push_back(benchTrack(i));
+
+        AudioEngine engine;
+        engine.prepareOffline(rate, frames);
+        engine.loadSample("accent", QStringLiteral(":/resources/accent.wav"));
+        engine.loadSample("click",  QStringLiteral(":/resources/click.wav"));
+        engine.startOffline(p, withCountIn);
+
+        const int callbacks = std::max(256, int(seconds * rate / frames));
+        const CallbackTimes t = timeCallbacks(engine, frames, callbacks);
+        const double audioNs = double(callbacks) * frames * 1e9 / rate;
+        std::printf("%6d %9.1f %7d %9.2f %8.1f %8.1f %8.1f %12.3f %7.2f\n", n, pulsesPerSecond(p, rate),
+                    engine.voicePool().peakVoices(), t.totalNs / (double(callbacks) * frames),
+                    t.pct(0.50) / 1000.0, t.pct(0.99) / 1000.0, t.ns.back() / 1000.0,
+                    100.0 * double(t.producerNs) / audioNs, double(t.allocs) / callbacks);
+    }
+    return 0;
+}
+
+int runChannelBenchmark(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"bench-channels", "Multichannel output benchmark mode."});
+    parser.addOption({"seconds", "Synthetic audio per channel count.", "seconds", "10"});
+    parser.process(app);
+
+    const double seconds = parser.value("seconds").toDouble();
+    const int channelCounts[] = {1, 2, 8};
+    const int sampleLen = 1024 * 4;
+
+    std::vector<SampleVector> data(kBenchVoices, SampleVector(sampleLen));
+    for (int v = 0; v < kBenchVoices; ++v)
+        for (int i = 0; i < sampleLen; ++i)
+            data[v][i] = std::sin(0.01f * float(i * (v + 1)));
+    float gains[VoicePool::kMaxChannels];
+    for (int c = 0; c < VoicePool::kMaxChannels; ++c)
+        gains[c] = 0.5f / float(c + 1);
+
+    // Kernel: one voice into an interleaved buffer, against the scalar loop.
+    float sink = 0.0f;
+    std::printf("%-8s %8s %8s %16s\n", "kernel", "channels", "frames", "voices/ms");
+    for (int channels : channelCounts) {
+        for (int frames : {64, 256, 1024}) {
+            double scalar = 0.0;
+            for (const MixKernel* kernel : availableMixKernels()) {
+                const double rate = voicesPerMs(frames, [&](float* out, int v, int n) {
+                    kernel->addInterleaved(out, data[v].data(), gains, channels, n);
+                }, sink, channels);
+                if (kernel == &scalarMixKernel()) scalar = rate;
+                std::printf("%-8s %8d %8d %16.1f  (x%.2f)\n", kernel->name, channels, frames,
+                            rate, rate / scalar);
+            }
+        }
+    }
+    std::printf("selected kernel: %s  (checksum %g)\n\n", bestMixKernel().name, double(sink));
+
+    // Engine: the polyrhythm mode routed over the device channels, accents
+    // and clicks on separate channels and the polyrhythm layer panned.
+    const int rate   = 48000;
+    const int frames = 256;
+    const int bpm    = 120;
+    std::printf("%d Hz, %d-frame buffers, %d BPM polyrhythm, routed callback\n", rate, frames, bpm);
+    std::printf("%8s %9s %8s %8s %8s %7s\n", "channels", "ns/frame", "p50 us", "p99 us", "max us", "allocs");
+    for (int channels : channelCounts) {
+        AudioEngine engine;
+        engine.prepareOffline(rate, frames, channels);
+        engine.loadSample("accent", QStringLiteral(":/resources/accent.wav"));
+        engine.loadSample("click",  QStringLiteral(":/resources/click.wav"));
+
+        using Routing = AudioEngine::OutputRouting;
+        Routing routing;
+        routing.classes[int(AudioEngine::RouteClass::Accent)]     = Routing::only(0);
+        routing.classes[int(AudioEngine::RouteClass::Click)]      = Routing::only(channels - 1);
+        routing.classes[int(AudioEngine::RouteClass::PolyAccent)] = Routing::pan(0.5f);
+        engine.setOutputRouting(routing);
+
+        bool withCountIn = false;
+        engine.startOffline(benchParams(QStringLiteral("polyrhythm"), bpm, &withCountIn), withCountIn);
+
+        const int callbacks = std::max(256, int(seconds * rate / frames));
+        const CallbackTimes t = timeCallbacks(engine, frames, callbacks, channels);
+        std::printf("%8d %9.2f %8.1f %8.1f %8.1f %7.2f\n", channels, t.totalNs / (double(callbacks) * frames),
+                    t.pct(0.50) / 1000.0, t.pct(0.99) / 1000.0, t.ns.back() / 1000.0,
+                    double(t.allocs) / callbacks);
+    }
+    return 0;
+}
+
+int runInputAnalysis(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"analyze-input", "Timing analysis of a recording.", "wav"});
+    parser.addOption({"bpm", "Tempo of the click the recording was played to.", "bpm", "120"});
+    parser.addOption({"beats", "Beats per bar (quarter notes).", "n", "4"});
+    parser.addOption({"pulses", "Pulses per beat, 1 to 4.", "n", "1"});
+    parser.addOption({"offset", "Input latency in the recording.", "ms", "0"});
+    parser.addOption({"rate", "Sample rate in Hz.", "hz", "48000"});
+    parser.process(app);
+
+    static const NoteValue pulseValues[] = { NoteValue::Quarter, NoteValue::Eighth,
+                                             NoteValue::TripletEighth, NoteValue::Sixteenth };
+    const int rate   = qBound(8000, parser.value("rate").toInt(), 384000);
+    const int frames = 256;
+    const int pulses = qBound(1, parser.value("pulses").toInt(), 4);
+    EngineParams p;
+    p.bpm = p.startTempo = qBound(20.0, parser.value("bpm").toDouble(), 600.0);
+    p.numerator   = qBound(1, parser.value("beats").toInt(), 32);
+    p.denominator = 4;
+    p.accents.assign(size_t(p.numerator), false);
+    p.accents[0] = true;
+    p.subdivision.pulses = QVector<SubdivisionPulse>(pulses, SubdivisionPulse{pulseValues[pulses - 1], false, false});
+
+    AudioEngine engine;
+    engine.prepareOffline(rate, frames);
+    if (!engine.setInputStandIn(parser.value("analyze-input"))) {
+        std::fprintf(stderr, "Cannot read %s\n", qPrintable(parser.value("analyze-input")));
+        return 1;
+    }
+    InputAnalyzer& input = engine.inputAnalyzer();
+    input.setEnabled(true);
+    input.setRoundTripNs(0);
+    input.setCalibrationMs(parser.value("offset").toInt());
+    engine.startOffline(p, false);
+
+    // One more second so the last onsets find their clicks.
+    const int64_t total = engine.inputStandInFrames() + rate;
+    std::vector<float> out(frames);
+    for (int64_t done = 0; done < total; done += frames) {
+        engine.produceOffline();
+        engine.offlineCallback(out.data(), frames);
+        input.process();
+    }
+
+    const TimingReport r = input.report();
+    std::printf("%.2f BPM, %d/4, %d pulse%s per beat, %.1f s; + is late\n", p.bpm, p.numerator, pulses,
+                pulses > 1 ? "s" : "", double(engine.inputStandInFrames()) / rate);
+    std::printf("%-8s %6s %9s %9s %9s %9s\n", "pulse", "count", "mean ms", "sd ms", "min ms", "max ms");
+    for (const TimingReport::Pulse& s : r.pulses) {
+        const QString name = s.isBeat ? QStringLiteral("beat %1").arg(s.beat)
+                                      : QStringLiteral("%1 +%2").arg(s.beat).arg(s.idx % pulses);
+        std::printf("%-8s %6d %+9.2f %9.2f %+9.2f %+9.2f\n", qPrintable(name), s.count,
+                    s.meanMs, s.sdMs, s.minMs, s.maxMs);
+    }
+    std::printf("%d of %d onsets matched, mean %+.2f ms, sd %.2f ms\n", r.matched, r.onsets, r.meanMs, r.sdMs);
+    return r.matched > 0 ? 0 : 1;
+}
+
+int runTempoBenchmark(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"bench-tempo", "Tempo detection over a directory of recordings.", "dir"});
+    parser.addOption({"beats", "Beats per bar (quarter notes).", "n", "4"});
+    parser.addOption({"rate", "Sample rate in Hz.", "hz", "48000"});
+    parser.process(app);
+
+    const QDir dir(parser.value("bench-tempo"));
+    const QStringList files = dir.entryList({"*.wav", "*.WAV"}, QDir::Files, QDir::Name);
+    if (files.isEmpty()) {
+        std::fprintf(stderr, "No WAV files in %s\n", qPrintable(parser.value("bench-tempo")));
+        return 1;
+    }
+    const int rate   = qBound(8000, parser.value("rate").toInt(), 384000);
+    const int beats  = qBound(1, parser.value("beats").toInt(), 32);
+    const int frames = InputAnalyzer::kBlockFrames;
+
+    // "128bpm_rock.wav", "take 3 - 97.5 BPM.wav" or "140_funk.wav".
+    static const QRegularExpression withUnit(QStringLiteral(R"((\d+(?:\.\d+)?)\s*bpm)"),
+                                             QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression leading(QStringLiteral(R"(^(\d+(?:\.\d+)?))"));
+    auto expectedBpm = [](const QString& name) {
+        QRegularExpressionMatch m = withUnit.match(name);
+        if (!m.hasMatch()) m = leading.match(name);
+        return m.hasMatch() ? m.captured(1).toDouble() : 0.0;
+    };
+    // Within 4% of the reference, as in the MIREX tempo task; the second
+    // measure also accepts the octave errors (x2, x3, 1/2, 1/3).
+    auto within = [](double bpm, double ref) { return std::fabs(bpm - ref) <= 0.04 * ref; };
+    auto octaveOf = [&within](double bpm, double ref) {
+        for (double f : {1.0, 2.0, 3.0, 0.5, 1.0 / 3.0})
+            if (within(bpm, ref * f)) return true;
+        return false;
+    };
+
+    std::printf("%d/4, %d Hz, %d-frame blocks; a proposal is the first stable estimate\n", beats, rate, frames);
+    std::printf("%-32s %7s %9s %8s %7s %8s  %s\n", "file", "ref", "proposed", "after s", "err %", "final", "");
+    int scored = 0, proposed = 0, acc1 = 0, acc2 = 0;
+    std::vector<double> latencies;
+    double cpuSeconds = 0.0, audioSeconds = 0.0;
+    for (const QString& name : files) {
+        PCMBuffer buf;
+        if (!buf.loadFromWavResource(dir.filePath(name), rate)) {
+            std::printf("%-32s unreadable\n", qPrintable(name.left(32)));
+            continue;
+        }
+        InputAnalyzer input;
+        input.setTempoDetection(true);
+        input.setBeatsPerBar(beats);
+
+        const float*  samples = buf.samples();
+        const int64_t total   = buf.frames();
+        double  firstBpm = 0.0;
+        int64_t firstAt  = -1;
+        for (int64_t done = 0; done < total; done += frames) {
+            const int n = int(std::min<int64_t>(frames, total - done));
+            input.pushInput(samples + done, n, done, rate);
+            const auto t0 = Clock::now();
+            input.process();
+            cpuSeconds += std::chrono::duration<double>(Clock::now() - t0).count();
+            if (firstAt < 0) {
+                const TempoEstimate e = input.tempo();
+                if (e.stable) { firstBpm = e.bpm; firstAt = done + n; }
+            }
+        }
+        audioSeconds += double(total) / rate;
+        const double finalBpm = input.tempo().bpm;
+
+        const double ref = expectedBpm(name);
+        const char* verdict = "";
+        if (ref > 0.0) {
+            ++scored;
+            if (firstAt >= 0) {
+                ++proposed;
+                latencies.push_back(double(firstAt) / rate);
+                if (within(firstBpm, ref))        { ++acc1; ++acc2; verdict = "ok"; }
+                else if (octaveOf(firstBpm, ref)) { ++acc2; verdict = "octave"; }
+                else                                verdict = "miss";
+            } else {
+                verdict = "none";
+            }
+        }
+        auto num = [](double v, const char* fmt) {
+            return v > 0.0 ? QString::asprintf(fmt, v) : QStringLiteral("-");
+        };
+        std::printf("%-32s %7s %9s %8s %7s %8s  %s\n", qPrintable(name.left(32)),
+                    qPrintable(num(ref, "%.1f")), qPrintable(num(firstBpm, "%.2f")),
+                    qPrintable(firstAt >= 0 ? QString::asprintf("%.2f", double(firstAt) / rate) : QStringLiteral("-")),
+                    qPrintable(ref > 0.0 && firstAt >= 0 ? QString::asprintf("%+.2f", 100.0 * (firstBpm - ref) / ref)
+                                                         : QStringLiteral("-")),
+                    qPrintable(num(finalBpm, "%.2f")), verdict);
+    }
+
+    if (scored == 0) {
+        std::printf("No file names carry a tempo; nothing scored\n");
+        return 0;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const double median = latencies.empty() ? 0.0 : latencies[latencies.size() / 2];
+    const double worst  = latencies.empty() ? 0.0 : latencies.back();
+    std::printf("%d files scored, %d proposed a tempo: accuracy %.1f%% (4%%), %.1f%% with octave errors\n",
+                scored, proposed, 100.0 * acc1 / scored, 100.0 * acc2 / scored);
+    std::printf("time to proposal: median %.2f s, max %.2f s; %.3f ms of CPU per second of audio\n",
+                median, worst, audioSeconds > 0.0 ? 1000.0 * cpuSeconds / audioSeconds : 0.0);
+    return 0;
+}
+
+namespace {
+
+// Peak resident set of the process so far, in KiB (0 where unknown).
+long peakRssKb()
+{
+#ifdef Q_OS_UNIX
+    rusage u;
+    if (getrusage(RUSAGE_SELF, &u) != 0) return 0;
+#ifdef Q_OS_MACOS
+    return long(u.ru_maxrss / 1024);   // bytes on macOS
+#else
+    return long(u.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+double msSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+} // namespace
+
+int runSoundSetBenchmark(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"bench-soundsets", "Sound set loading benchmark mode."});
+    parser.addOption({"rate", "Device sample rate.", "hz", "48000"});
+    parser.addOption({"cold", "Delete the PCM disk cache first."});
+    parser.addOption({"no-prefetch", "Switch sets without warming them first."});
+    parser.process(app);
+
+    const int rate = parser.value("rate").toInt();
+    const PcmDiskCache& disk = PcmDiskCache::instance();
+    if (parser.isSet("cold") && disk.isEnabled()) {
+        QDir dir(disk.directory());
+        for (const QString& f : dir.entryList({QStringLiteral("*.pcm")}, QDir::Files))
+            dir.remove(f);
+    }
+
+    const long rss0 = peakRssKb();
+    AudioEngine engine;
+    engine.prepareOffline(rate);
+
+    // What the controller does at startup: the selected set, then the rest
+    // in the background.
+    Clock::time_point t0 = Clock::now();
+    engine.loadSample("accent", QString::fromLatin1(kSoundSets[0].accent));
+    engine.loadSample("click",  QString::fromLatin1(kSoundSets[0].click));
+    const double startupMs = msSince(t0);
+
+    double prefetchMs = 0.0;
+    if (!parser.isSet("no-prefetch")) {
+        QStringList others;
+        for (size_t i = 1; i < std::size(kSoundSets); ++i)
+            others << QString::fromLatin1(kSoundSets[i].accent) << QString::fromLatin1(kSoundSets[i].click);
+        t0 = Clock::now();
+        engine.prefetchSamples(others);
+        QThreadPool::globalInstance()->waitForDone();
+        prefetchMs = msSince(t0);
+    }
+
+    // Then a switch through every other set, as applySettings() does.
+    double totalMs = 0.0, worstMs = 0.0;
+    for (size_t i = 1; i < std::size(kSoundSets); ++i) {
+        t0 = Clock::now();
+        engine.loadSample("accent", QString::fromLatin1(kSoundSets[i].accent));
+        engine.loadSample("click",  QString::fromLatin1(kSoundSets[i].click));
+        const double ms = msSince(t0);
+        totalMs += ms;
+        worstMs  = std::max(worstMs, ms);
+    }
+    const int switches = int(std::size(kSoundSets)) - 1;
+
+    std::printf("%d Hz, %s PCM disk cache%s\n", rate,
+                !disk.isEnabled() ? "no" : parser.isSet("cold") ? "cold" : "existing",
+                parser.isSet("no-prefetch") ? ", no prefetch" : "");
+    std::printf("startup %.2f ms | prefetch of %d sets %.2f ms | switch avg %.3f ms, worst %.3f ms"
+                " | peak RSS +%ld KiB\n",
+                startupMs, parser.isSet("no-prefetch") ? 0 : switches, prefetchMs,
+                totalMs / switches, worstMs, peakRssKb() - rss0);
+    return 0;
+}
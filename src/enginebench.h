@@ -0,0 +1,85 @@
+#pragma once
+
+// ---------------------------------------------------------------------------
+// Headless engine micro-benchmarks, built as their own executable
+// (SH4DOWNOME-bench, see benchmain.cpp) so the allocation counting in
+// enginebench.cpp never reaches the app.  Results go to stdout.
+// ---------------------------------------------------------------------------
+
+// Voices mixed per millisecond for every available mix kernel at 64-, 256-
+// and 1024-frame buffers.  Returns a process exit code.
+int runMixBenchmark();
+
+// AudioEngine's device callback driven by a virtual device on a synthetic
+// clock, swept over buffer sizes, sample rates, EngineParams modes and
+// tempos.  Prints one JSON document (ns/frame, p50/p99/max callback time,
+// allocations per callback) for tracking regressions between releases.
+// Options: --quick (reduced sweep), --out <file.json>.
+int runCallbackBenchmark(int argc, char* argv[]);
+
+// Sample-rate conversion: output samples per second and signal-to-noise /
+// alias rejection for the polyphase resampler against the linear
+// interpolator it replaced, across the common interface rate pairs.
+int runResampleBenchmark();
+
+// Polymeter tracks: callback time (ns per frame, p50/p99/max), allocations
+// and producer load as EngineParams::tracks grows from 0 to kMaxTracks,
+// in assorted meters under a 4/4 main bar.
+// Options: --seconds <n> of audio per track count (default 10).
+int runTrackBenchmark(int argc, char* argv[]);
+
+// Multichannel output: voices per millisecond of MixKernel::addInterleaved
+// for every available kernel at 1, 2 and 8 channels, then the routed device
+// callback (ns per frame, p50/p99/max, allocations) at each channel count.
+// Options: --seconds <n> of audio per channel count (default 10).
+int runChannelBenchmark(int argc, char* argv[]);
+
+// setEngineParams under contention: writer threads publish snapshots as fast
+// as they can while one thread drives the producer and the device callback.
+// Every snapshot the producer adopts is checked for tearing (each one is
+// derived from a single tag), the callback for allocations and the output
+// for gaps.  Returns non-zero on any of those.
+// Options: --writers <n> (default 4), --seconds <n> of wall time (default 10).
+int runParamsStress(int argc, char* argv[]);
+
+// Timing analysis of a recording: plays a WAV file into the InputAnalyzer
+// as a stand-in input against an offline click that starts with the file's
+// first sample, and prints the player's deviation from each pulse of the
+// bar (mean, standard deviation, range) and overall.
+// Options: --bpm <n> (default 120), --beats <n> per bar (4/4 by default),
+// --pulses <n> per beat (1 to 4), --offset <ms> of input latency in the
+// recording, --rate <hz> (default 48000).
+int runInputAnalysis(int argc, char* argv[]);
+
+// Tempo detection over a directory of recordings: each WAV file is fed to an
+// InputAnalyzer in device-sized blocks, and the first stable estimate (what
+// the app would propose) is scored against the tempo in the file name
+// ("128bpm_rock.wav", or a leading number).  Prints per file the proposal,
+// how much audio it took and the estimate at the end, then accuracy within
+// 4% (and allowing octave errors), time to proposal and CPU per second of
+// audio.  Options: --beats <n> per bar (default 4), --rate <hz> (default 48000).
+int runTempoBenchmark(int argc, char* argv[]);
+
+// Event queue: the device callback's share of scheduling on the densest
+// patterns (64ths in 4/4 and 12/8, nonuplets, a 64:60 polyrhythm at 300 BPM),
+// the event ring that is popped per buffer against the vector it replaced,
+// which was extended, scanned in full and pruned every callback.  Prints
+// events pending, mean and p99 ns per callback and allocations before and
+// after, and the producer's time for the ring.  Returns non-zero if the two
+// fire different events.
+// Options: --seconds <n> of audio per pattern and buffer size (default 60).
+int runQueueBenchmark(int argc, char* argv[]);
+
+// Sound set loading: times loading the first built-in set, prefetching the
+// rest the way the controller does at startup, then switching through them,
+// and reports the growth in peak RSS.
+// Options: --rate <hz> (default 48000), --cold to empty the PCM disk cache
+// first, --no-prefetch to switch without warming.
+int runSoundSetBenchmark(int argc, char* argv[]);
+
+// Schedule timing: lays hours of bars end to end the way the producer thread
+// does, over common sample rates, tempos (fractional ones included) and
+// playback modes, and checks every bar line and pulse against its exact
+// time.  Returns non-zero if anything drifts by a sample or more.
+// Options: --hours <n> of playback per configuration (default 12).
+int runTimingCheck(int argc, char* argv[]);
@@ -0,0 +1,117 @@
+#include "enginestats.h"
+#include <QDebug>
+#include <QString>
+#include <algorithm>
+
+uint64_t LatencyHistogram::count() const
+{
+    uint64_t n = 0;
+    for (const auto& b : m_buckets)
+        n += b.load(std::memory_order_relaxed);
+    return n;
+}
+
+double LatencyHistogram::quantileUs(double q) const
+{
+    uint32_t counts[kBuckets];
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets; ++i)
+        total += counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0.0;
+
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(q * double(total) + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return double(uint64_t(1) << i);
+    }
+    return double(uint64_t(1) << (kBuckets - 1));
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& b : m_buckets)
+        b.store(0, std::memory_order_relaxed);
+}
+
+void EngineStats::recordCallback(int64_t startNs, int64_t durationNs, int frames, int sampleRate,
+                                 int activeVoices, int eventBacklog) noexcept
+{
+    // reset() only raises a flag; the audio thread clears its own state so
+    // the running maximum and minimum never mix old and new values.
+    if (m_resetRequested.exchange(false, std::memory_order_acq_rel)) {
+        m_maxNs.store(0, std::memory_order_relaxed);
+        m_minHeadroomNs.store(INT64_MAX, std::memory_order_relaxed);
+        m_prevStartNs = 0;
+    }
+
+    const int64_t periodNs = sampleRate > 0 ? int64_t(frames) * 1000000000 / sampleRate : 0;
+    const int64_t headroom = periodNs - durationNs;
+
+    m_callbacks.fetch_add(1, std::memory_order_relaxed);
+    m_lastNs.store(durationNs, std::memory_order_relaxed);
+    m_deadlineNs.store(periodNs, std::memory_order_relaxed);
+    m_activeVoices.store(activeVoices, std::memory_order_relaxed);
+    m_eventBacklog.store(eventBacklog, std::memory_order_relaxed);
+    if (durationNs > m_maxNs.load(std::memory_order_relaxed))
+        m_maxNs.store(durationNs, std::memory_order_relaxed);
+    if (headroom < m_minHeadroomNs.load(std::memory_order_relaxed))
+        m_minHeadroomNs.store(headroom, std::memory_order_relaxed);
+
+    m_duration.record(uint32_t(std::min<int64_t>(durationNs / 1000, UINT32_MAX)));
+    m_headroom.record(uint32_t(std::clamp<int64_t>(headroom / 1000, 0, UINT32_MAX)));
+    if (headroom < 0)
+        m_deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+
+    // The device asks for the next buffer about one period after the last
+    // one.  Arriving more than a whole period late means it ran dry.
+    if (startNs != 0 && m_prevStartNs != 0 && m_prevPeriodNs > 0 &&
+        startNs - m_prevStartNs > 2 * m_prevPeriodNs)
+        m_lateCallbacks.fetch_add(1, std::memory_order_relaxed);
+    m_prevStartNs  = startNs;
+    m_prevPeriodNs = periodNs;
+}
+
+EngineStatsSnapshot EngineStats::snapshot() const
+{
+    EngineStatsSnapshot s;
+    s.callbacks      = m_callbacks.load(std::memory_order_relaxed);
+    s.deadlineMisses = m_deadlineMisses.load(std::memory_order_relaxed);
+    s.lateCallbacks  = m_lateCallbacks.load(std::memory_order_relaxed);
+    s.deadlineUs     = m_deadlineNs.load(std::memory_order_relaxed) / 1000.0;
+    s.lastUs         = m_lastNs.load(std::memory_order_relaxed) / 1000.0;
+    s.maxUs          = m_maxNs.load(std::memory_order_relaxed) / 1000.0;
+    s.p50Us          = m_duration.quantileUs(0.50);
+    s.p99Us          = m_duration.quantileUs(0.99);
+    s.p01HeadroomUs  = m_headroom.quantileUs(0.01);
+    s.activeVoices   = m_activeVoices.load(std::memory_order_relaxed);
+    s.eventBacklog   = m_eventBacklog.load(std::memory_order_relaxed);
+    const int64_t minHeadroom = m_minHeadroomNs.load(std::memory_order_relaxed);
+    s.minHeadroomUs  = minHeadroom == INT64_MAX ? 0.0 : minHeadroom / 1000.0;
+    return s;
+}
+
+void EngineStats::reset()
+{
+    m_duration.reset();
+    m_headroom.reset();
+    m_callbacks.store(0, std::memory_order_relaxed);
+    m_deadlineMisses.store(0, std::memory_order_relaxed);
+    m_lateCallbacks.store(0, std::memory_order_relaxed);
+    m_resetRequested.store(true, std::memory_order_release);
+}
+
+void RtLog::flush(const char* prefix)
+{
+    Record r;
+    while (m_ring.pop(r)) {
+        QString text = QString::fromLatin1(r.message);
+        if (text.contains(QLatin1String("%2")))
+            text = text.arg(qlonglong(r.a)).arg(qlonglong(r.b));
+        else if (text.contains(QLatin1String("%1")))
+            text = text.arg(qlonglong(r.a));
+        qDebug().noquote() << prefix << text;
+    }
+}
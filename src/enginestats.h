@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "spscring.h"
+
+// ---------------------------------------------------------------------------
+// Real-time instrumentation for the audio callback.
+//
+// EngineStats is written by the audio thread only, with relaxed atomic
+// stores and no locks, and read by the GUI thread through snapshot().
+// Values in a snapshot may come from neighbouring callbacks; they are meant
+// for a live health display, not for exact accounting.
+// ---------------------------------------------------------------------------
+
+// Log2-bucketed histogram of microsecond durations: bucket 0 holds < 1 µs,
+// bucket i holds [2^(i-1), 2^i) µs, and the last bucket everything above.
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 24;   // top bucket starts at ~4.2 s
+
+    void record(uint32_t us) noexcept {
+        int b = 0;
+        while (us && b < kBuckets - 1) { us >>= 1; ++b; }
+        m_buckets[b].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const;
+    // Upper edge, in µs, of the bucket holding the q-th quantile (0 if empty).
+    double quantileUs(double q) const;
+    void reset();
+
+private:
+    std::array<std::atomic<uint32_t>, kBuckets> m_buckets{};
+};
+
+struct EngineStatsSnapshot {
+    uint64_t callbacks       = 0;
+    uint64_t deadlineMisses  = 0;   // callback ran longer than its buffer lasts
+    uint64_t lateCallbacks   = 0;   // callback started over a buffer later than due (device xrun)
+    double   deadlineUs      = 0.0; // duration of the most recent buffer
+    double   lastUs          = 0.0;
+    double   maxUs           = 0.0;
+    double   p50Us           = 0.0;
+    double   p99Us           = 0.0;
+    double   minHeadroomUs   = 0.0; // smallest deadline - duration seen (negative after a miss)
+    double   p01HeadroomUs   = 0.0; // headroom exceeded by 99% of callbacks
+    int      activeVoices    = 0;
+    int      eventBacklog    = 0;   // scheduled events queued ahead of the playhead
+    // Filled in by AudioEngine::stats() from the voice pool, not per callback.
+    uint64_t stolenVoices    = 0;   // voices cut to make room at the polyphony cap
+    int64_t  worstCaseMix    = 0;   // multiply-adds of a callback with every slot busy
+
+    // Fraction of the buffer period the p99 callback uses.
+    double load() const { return deadlineUs > 0.0 ? p99Us / deadlineUs : 0.0; }
+};
+
+class EngineStats {
+public:
+    // Audio thread, once per callback that rendered audio.  startNs is a
+    // steady-clock timestamp of the callback start; late detection is
+    // skipped when it is 0 (offline rendering has no device clock).
+    void recordCallback(int64_t startNs, int64_t durationNs, int frames, int sampleRate,
+                        int activeVoices, int eventBacklog) noexcept;
+
+    EngineStatsSnapshot snapshot() const;
+    // GUI thread.  Counters restart from zero; safe while the callback runs.
+    void reset();
+
+    uint64_t deadlineMisses() const { return m_deadlineMisses.load(std::memory_order_relaxed); }
+    uint64_t lateCallbacks() const  { return m_lateCallbacks.load(std::memory_order_relaxed); }
+
+private:
+    LatencyHistogram m_duration;
+    LatencyHistogram m_headroom;   // clamped at zero; misses are counted separately
+
+    std::atomic<uint64_t> m_callbacks{0};
+    std::atomic<uint64_t> m_deadlineMisses{0};
+    std::atomic<uint64_t> m_lateCallbacks{0};
+    std::atomic<int64_t>  m_lastNs{0};
+    std::atomic<int64_t>  m_maxNs{0};
+    std::atomic<int64_t>  m_deadlineNs{0};
+    std::atomic<int64_t>  m_minHeadroomNs{INT64_MAX};
+    std::atomic<int>      m_activeVoices{0};
+    std::atomic<int>      m_eventBacklog{0};
+    std::atomic<bool>     m_resetRequested{false};
+
+    // Audio thread only
+    int64_t m_prevStartNs  = 0;
+    int64_t m_prevPeriodNs = 0;
+};
+
+// ---------------------------------------------------------------------------
+// RtLog: log messages posted from the audio thread and printed later by the
+// GUI thread.  A message is a string literal with up to two %1/%2 integer
+// arguments; posting copies three words into a ring and never allocates,
+// formats or blocks.  Single producer: post only from the audio callback.
+// ---------------------------------------------------------------------------
+class RtLog {
+public:
+    struct Record {
+        const char* message = nullptr;   // static storage duration
+        int64_t a = 0;
+        int64_t b = 0;
+    };
+
+    void post(const char* message, int64_t a = 0, int64_t b = 0) noexcept {
+        m_ring.push({message, a, b});
+    }
+
+    // GUI thread: print everything posted since the last call.
+    void flush(const char* prefix);
+    uint64_t dropped() const { return m_ring.overflowCount(); }
+
+private:
+    SpscRing<Record> m_ring{256};
+};
@@ -0,0 +1,239 @@
+#include "inputanalyzer.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void InputAnalyzer::Accumulator::add(double ms)
+{
+    if (count == 0) { min = max = ms; }
+    min = std::min(min, ms);
+    max = std::max(max, ms);
+    ++count;
+    const double d = ms - mean;
+    mean += d / count;
+    m2   += d * (ms - mean);
+}
+
+InputAnalyzer::InputAnalyzer() = default;
+
+InputAnalyzer::~InputAnalyzer()
+{
+    stopWorker();
+}
+
+void InputAnalyzer::pushInput(const float* in, int frames, int64_t samplePos, int sampleRate, int64_t capturedNs)
+{
+    Block b;
+    b.sampleRate = sampleRate;
+    for (int done = 0; done < frames; ) {
+        const int n = std::min(frames - done, kBlockFrames);
+        b.samplePos  = samplePos + done;
+        b.capturedNs = capturedNs ? capturedNs + int64_t(done) * 1000000000 / sampleRate : 0;
+        b.frames    = n;
+        if (in)
+            std::memcpy(b.samples, in + done, size_t(n) * sizeof(float));
+        else
+            std::memset(b.samples, 0, size_t(n) * sizeof(float));
+        m_input.push(b);
+        done += n;
+    }
+}
+
+void InputAnalyzer::startWorker()
+{
+    if (m_worker) return;
+    m_workerRunning.store(true);
+    m_worker = QThread::create([this] {
+        while (m_workerRunning.load(std::memory_order_acquire)) {
+            process();
+            QThread::msleep(kPollMs);
+        }
+    });
+    m_worker->setObjectName(QStringLiteral("InputAnalyzer"));
+    m_worker->start(QThread::LowPriority);
+}
+
+void InputAnalyzer::stopWorker()
+{
+    if (!m_worker) return;
+    m_workerRunning.store(false, std::memory_order_release);
+    m_worker->wait();
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+void InputAnalyzer::reset()
+{
+    m_input.clear();
+    m_clicks.clear();
+    m_detector.reset();
+    m_onsets.clear();
+    m_recentClicks.clear();
+    m_beat    = 0;
+    m_horizon = 0;
+    m_tempo.reset();
+    m_hops.clear();
+    m_clockPos = m_clockNs = 0;
+    resetStatistics();
+}
+
+void InputAnalyzer::resetStatistics()
+{
+    QMutexLocker lock(&m_reportMutex);
+    m_pulses.clear();
+    m_all        = Accumulator();
+    m_onsetCount = 0;
+    m_lastMs     = 0.0;
+    m_lastOnset  = -1;
+    m_tempoReport = TempoEstimate();
+}
+
+void InputAnalyzer::process()
+{
+    const bool tempoOn = tempoDetection();
+    Block b;
+    while (m_input.pop(b)) {
+        if (b.sampleRate != m_detector.sampleRate()) {
+            m_detector = OnsetDetector(b.sampleRate);
+            m_tempo    = TempoDetector(OnsetDetector::kHop, b.sampleRate);
+            m_onsets.clear();
+            m_recentClicks.clear();
+            m_hops.clear();
+        }
+        m_detector.process(b.samples, b.frames, b.samplePos, m_onsets, tempoOn ? &m_hops : nullptr);
+        m_horizon = b.samplePos + b.frames;
+        if (b.capturedNs) {
+            m_clockPos = b.samplePos;
+            m_clockNs  = b.capturedNs;
+        }
+    }
+    if (!m_hops.empty())
+        updateTempo();
+
+    // Every click before m_horizon was pushed before the input that got us there.
+    Click c;
+    while (m_clicks.pop(c)) {
+        if (!m_recentClicks.empty() && c.samplePos <= m_recentClicks.back().c.samplePos)
+            m_recentClicks.clear();   // the timeline restarted
+        if (c.firstInBar) m_beat = 0;
+        if (c.isBeat || m_beat == 0) ++m_beat;
+        if (c.audible)
+            m_recentClicks.push_back({c, m_beat, false});
+    }
+
+    matchOnsets(m_horizon);
+}
+
+void InputAnalyzer::matchOnsets(int64_t horizon)
+{
+    const int     rate      = m_detector.sampleRate();
+    const int64_t roundTrip = m_roundTripNs.load(std::memory_order_relaxed) * rate / 1000000000
+                            + int64_t(calibrationMs()) * rate / 1000;
+    const int64_t maxDev    = int64_t(kMaxDeviationMs * rate / 1000.0);
+
+    QMutexLocker lock(&m_reportMutex);
+    size_t done = 0;
+    for (; done < m_onsets.size(); ++done) {
+        const int64_t at = m_onsets[done].samplePos - roundTrip;
+        if (at + maxDev >= horizon)
+            break;   // a nearer click may still be on its way
+        ++m_onsetCount;
+
+        auto next = std::lower_bound(m_recentClicks.begin(), m_recentClicks.end(), at,
+                                     [](const PendingClick& p, int64_t pos) { return p.c.samplePos < pos; });
+        auto prev = next == m_recentClicks.begin() ? m_recentClicks.end() : next - 1;
+        if (next == m_recentClicks.end() && prev == m_recentClicks.end())
+            continue;
+
+        auto nearest = next;
+        if (next == m_recentClicks.end() ||
+            (prev != m_recentClicks.end() && at - prev->c.samplePos <= next->c.samplePos - at))
+            nearest = prev;
+        int64_t limit = maxDev;
+        if (next != m_recentClicks.end() && prev != m_recentClicks.end())
+            limit = std::min(limit, (next->c.samplePos - prev->c.samplePos) / 2);
+
+        const int64_t dev = at - nearest->c.samplePos;
+        if (std::llabs(dev) > limit || nearest->matched)
+            continue;
+        nearest->matched = true;
+        record(*nearest, 1000.0 * double(dev) / rate, m_onsets[done].samplePos);
+    }
+    m_onsets.erase(m_onsets.begin(), m_onsets.begin() + done);
+
+    // Keep one click before anything still to be matched.
+    const int64_t keepFrom = horizon - std::max<int64_t>(roundTrip, 0) - 2 * maxDev;
+    while (m_recentClicks.size() > 1 && m_recentClicks[1].c.samplePos < keepFrom)
+        m_recentClicks.pop_front();
+}
+
+void InputAnalyzer::updateTempo()
+{
+    m_tempo.setBeatsPerBar(m_beatsPerBar.load(std::memory_order_relaxed));
+    bool updated = false;
+    for (const OnsetDetector::Hop& h : m_hops)
+        updated |= m_tempo.addHop(h.samplePos, h.levelDb);
+    m_hops.clear();
+    if (!updated) return;
+
+    TempoEstimate e = m_tempo.estimate();
+    if (m_clockNs != 0 && e.beatPos >= 0) {
+        // The capture clock covers what the device reports; the calibration
+        // is the rest, and the player struck that much earlier.
+        const int64_t rate    = m_tempo.sampleRate();
+        const int64_t clockNs = m_clockNs - int64_t(calibrationMs()) * 1000000;
+        e.beatNs     = clockNs + (e.beatPos - m_clockPos) * 1000000000 / rate;
+        e.downbeatNs = clockNs + (e.downbeatPos - m_clockPos) * 1000000000 / rate;
+    }
+    QMutexLocker lock(&m_reportMutex);
+    m_tempoReport = e;
+}
+
+TempoEstimate InputAnalyzer::tempo() const
+{
+    QMutexLocker lock(&m_reportMutex);
+    return m_tempoReport;
+}
+
+void InputAnalyzer::record(const PendingClick& click, double ms, int64_t onsetPos)
+{
+    const size_t idx = size_t(std::max<int>(0, click.c.idx));
+    if (m_pulses.size() <= idx)
+        m_pulses.resize(idx + 1);
+    Accumulator& slot = m_pulses[idx];
+    slot.beat   = click.beat;
+    slot.isBeat = click.c.isBeat;
+    slot.add(ms);
+    m_all.add(ms);
+    m_lastMs    = ms;
+    m_lastOnset = onsetPos;
+}
+
+TimingReport InputAnalyzer::report() const
+{
+    TimingReport r;
+    QMutexLocker lock(&m_reportMutex);
+    for (size_t i = 0; i < m_pulses.size(); ++i) {
+        const Accumulator& a = m_pulses[i];
+        if (a.count == 0) continue;
+        TimingReport::Pulse s;
+        s.idx    = int(i);
+        s.beat   = a.beat;
+        s.isBeat = a.isBeat;
+        s.count  = a.count;
+        s.meanMs = a.mean;
+        s.sdMs   = a.count > 1 ? std::sqrt(a.m2 / (a.count - 1)) : 0.0;
+        s.minMs  = a.min;
+        s.maxMs  = a.max;
+        r.pulses.push_back(s);
+    }
+    r.onsets    = m_onsetCount;
+    r.matched   = m_all.count;
+    r.meanMs    = m_all.mean;
+    r.sdMs      = m_all.count > 1 ? std::sqrt(m_all.m2 / (m_all.count - 1)) : 0.0;
+    r.lastMs    = m_lastMs;
+    r.lastOnset = m_lastOnset;
+    return r;
+}
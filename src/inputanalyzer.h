@@ -0,0 +1,166 @@
+#pragma once
+
+#include <QMutex>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "onsetdetector.h"
+#include "spscring.h"
+#include "tempodetector.h"
+
+class QThread;
+
+// Deviation of the player from the click, gathered per pulse of the bar.
+// Positive values are late, negative early.
+struct TimingReport {
+    struct Pulse {
+        int    idx    = 0;       // pulse index within the bar
+        int    beat   = 0;       // 1-based beat the pulse belongs to
+        bool   isBeat = false;   // on the beat rather than a subdivision
+        int    count  = 0;
+        double meanMs = 0.0;
+        double sdMs   = 0.0;
+        double minMs  = 0.0;
+        double maxMs  = 0.0;
+    };
+    std::vector<Pulse> pulses;   // pulses that were matched at least once, by idx
+    int     onsets    = 0;       // everything the detector found
+    int     matched   = 0;
+    double  meanMs    = 0.0;     // over all matched onsets
+    double  sdMs      = 0.0;
+    double  lastMs    = 0.0;     // most recent matched onset
+    int64_t lastOnset = -1;      // its position on the device timeline (-1 = none yet)
+};
+
+// ---------------------------------------------------------------------------
+// InputAnalyzer: how far ahead of or behind the click the player is.
+//
+// The audio callback hands over captured input and the clicks it fires, both
+// on the device timeline, through two lock-free rings.  A worker thread runs
+// the OnsetDetector over the input and matches each onset to the nearest
+// click once the round trip (output plus input latency, plus a calibration)
+// is taken off.  An onset is unmatched when it is more than kMaxDeviationMs,
+// or more than half way to the neighbouring click, from the nearest click,
+// or when that click already has an onset.
+//
+// Clicks are pushed before the input of the same callback, so once the
+// worker has read input up to some position it also has every click before
+// it; an onset is only matched when clicks past it are known.
+//
+// With tempo detection on, the same worker feeds the detector's hop levels
+// to a TempoDetector; no clicks are needed for that.
+// ---------------------------------------------------------------------------
+class InputAnalyzer {
+public:
+    static constexpr int    kBlockFrames    = 256;
+    static constexpr size_t kInputBlocks    = 1024;   // ~5 s at 48 kHz
+    static constexpr size_t kClickCapacity  = 4096;
+    static constexpr double kMaxDeviationMs = 150.0;
+    static constexpr int    kPollMs         = 10;
+
+    struct Click {
+        int64_t samplePos;
+        int16_t idx;
+        bool    isBeat;
+        bool    firstInBar;
+        bool    audible;      // silent pulses only count beats
+    };
+
+    InputAnalyzer();
+    ~InputAnalyzer();
+
+    // ── Any thread ────────────────────────────────────────────────────────
+    void setEnabled(bool on) { m_enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const   { return m_enabled.load(std::memory_order_relaxed); }
+    // Device buffering both ways, known once the device is open.
+    void setRoundTripNs(int64_t ns) { m_roundTripNs.store(ns, std::memory_order_relaxed); }
+    int64_t roundTripNs() const     { return m_roundTripNs.load(std::memory_order_relaxed); }
+    // What the device does not report (converters, the room); added to it.
+    void setCalibrationMs(int ms)   { m_calibrationMs.store(ms, std::memory_order_relaxed); }
+    int  calibrationMs() const      { return m_calibrationMs.load(std::memory_order_relaxed); }
+
+    TimingReport report() const;
+    void resetStatistics();
+    uint64_t inputOverflows() const { return m_input.overflowCount(); }
+
+    // Forget the statistics and the timeline, and drop whatever is queued.
+    // Only while neither the audio thread nor the worker is running.
+    void reset();
+
+    void setTempoDetection(bool on) { m_tempoEnabled.store(on, std::memory_order_relaxed); }
+    bool tempoDetection() const     { return m_tempoEnabled.load(std::memory_order_relaxed); }
+    void setBeatsPerBar(int beats)  { m_beatsPerBar.store(beats, std::memory_order_relaxed); }
+    int  beatsPerBar() const        { return m_beatsPerBar.load(std::memory_order_relaxed); }
+    // The latest estimate, with steady_clock times when the input carried
+    // them (corrected by the calibration, like the click deviations).
+    TempoEstimate tempo() const;
+
+    // ── Audio thread ──────────────────────────────────────────────────────
+    // frames of input starting at samplePos; in == nullptr is silence.
+    // capturedNs is the steady_clock time of the first frame (0 = unknown).
+    void pushInput(const float* in, int frames, int64_t samplePos, int sampleRate, int64_t capturedNs = 0);
+    void pushClick(const Click& click) { m_clicks.push(click); }
+
+    // ── Worker ────────────────────────────────────────────────────────────
+    // The worker calls process() every kPollMs; offline callers without a
+    // worker call it themselves after rendering.
+    void startWorker();
+    void stopWorker();
+    void process();
+
+private:
+    struct Block {
+        int64_t samplePos;
+        int64_t capturedNs;
+        int     sampleRate;
+        int     frames;
+        float   samples[kBlockFrames];
+    };
+    struct PendingClick {
+        Click c;
+        int   beat;
+        bool  matched;
+    };
+    struct Accumulator {
+        int    beat = 0;
+        bool   isBeat = false;
+        int    count = 0;
+        double mean = 0.0, m2 = 0.0, min = 0.0, max = 0.0;
+        void add(double ms);
+    };
+
+    void matchOnsets(int64_t horizon);
+    void updateTempo();
+    void record(const PendingClick& click, double ms, int64_t onsetPos);
+
+    SpscRing<Block> m_input{kInputBlocks};
+    SpscRing<Click> m_clicks{kClickCapacity};
+    std::atomic<bool>    m_enabled{false};
+    std::atomic<int64_t> m_roundTripNs{0};
+    std::atomic<int>     m_calibrationMs{0};
+    std::atomic<bool>    m_tempoEnabled{false};
+    std::atomic<int>     m_beatsPerBar{4};
+
+    // Worker-owned.
+    OnsetDetector m_detector;
+    std::vector<OnsetDetector::Onset> m_onsets;   // found, not yet matched
+    std::deque<PendingClick> m_recentClicks;
+    int     m_beat    = 0;
+    int64_t m_horizon = 0;                        // end of the input read so far
+    TempoDetector m_tempo;
+    std::vector<OnsetDetector::Hop> m_hops;       // measured, not yet handed to m_tempo
+    int64_t m_clockPos = 0;                       // a capture time seen in the input:
+    int64_t m_clockNs  = 0;                       // position m_clockPos was captured at m_clockNs
+
+    QThread*          m_worker = nullptr;
+    std::atomic<bool> m_workerRunning{false};
+
+    mutable QMutex           m_reportMutex;       // worker writes, any thread reads
+    std::vector<Accumulator> m_pulses;             // by pulse index
+    Accumulator              m_all;
+    int     m_onsetCount = 0;
+    double  m_lastMs     = 0.0;
+    int64_t m_lastOnset  = -1;
+    TempoEstimate m_tempoReport;
+};
@@ -12,9 +12,76 @@
 #include "SectionListModel.h"
 #include "androidinputdialog.h"
 #include "updatechecker.h"
+#include "offlinerenderer.h"
+#include <QCommandLineParser>
+#include <cstdio>
+
+// SH4DOWNOME --render <preset> <out.wav> [--rate N] [--bars N] [--count-in] [--sounds SET]
+static int runRenderCli(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("SH4DOWSIX");
+    QCoreApplication::setApplicationName("SH4DOWNOME");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render a preset to a WAV click track.");
+    parser.addHelpOption();
+    parser.addOption({"render", "Render mode."});
+    parser.addOption({"rate", "Sample rate in Hz.", "hz", "48000"});
+    parser.addOption({"bars", "Playing bars per section (with --speed: bars at the final tempo).", "n", "8"});
+    parser.addOption({"count-in", "Count-in bar at the start."});
+    parser.addOption({"speed", "Speed trainer: bars per step, tempo step, max tempo.", "steps,inc,max"});
+    parser.addOption({"sounds", "Sound set name.", "set", "Default"});
+    parser.addPositionalArgument("preset", "Preset name.");
+    parser.addPositionalArgument("output", "Output WAV file.");
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2)
+        parser.showHelp(1);
+
+    PresetManager presets;
+    presets.loadFromDisk(MetronomeController::presetFilePath());
+    MetronomePreset preset;
+    if (!presets.loadPreset(args[0], preset)) {
+        std::fprintf(stderr, "Unknown preset: %s\n", qPrintable(args[0]));
+        return 1;
+    }
+
+    OfflineRenderOptions opt;
+    opt.sampleRate     = parser.value("rate").toInt();
+    opt.barsPerSection = qMax(1, parser.value("bars").toInt());
+    opt.countIn        = parser.isSet("count-in");
+    if (parser.isSet("speed")) {
+        const QStringList s = parser.value("speed").split(',');
+        if (s.size() != 3) parser.showHelp(1);
+        opt.speedEnabled = true;
+        opt.barsPerStep  = s[0].toInt();
+        opt.tempoStep    = s[1].toInt();
+        opt.maxTempo     = s[2].toInt();
+    }
+    opt.accentSound = MetronomeController::soundFileForSet(parser.value("sounds"), true);
+    opt.clickSound  = MetronomeController::soundFileForSet(parser.value("sounds"), false);
+
+    OfflineRenderResult r = renderPresetToWav(preset, opt, args[1]);
+    if (!r.ok) {
+        std::fprintf(stderr, "Render failed: %s\n", qPrintable(r.error));
+        return 1;
+    }
+    std::printf("%lld frames, %.1f s of audio in %.3f s (%.0fx realtime)\n",
+                (long long)r.frames, r.audioSeconds, r.renderSeconds, r.realtimeMultiple());
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    // Headless mode: no GUI, no audio device.  The engine benchmarks are a
+    // separate executable (benchmain.cpp).
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--render") == 0)
+            return runRenderCli(argc, argv);
+    }
+
     QApplication::setHighDpiScaleFactorRoundingPolicy(Qt::HighDpiScaleFactorRoundingPolicy::PassThrough);
     QApplication app(argc, argv);
     QApplication::setOrganizationName("SH4DOWSIX");
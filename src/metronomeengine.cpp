@@ -4,18 +4,6 @@
 #include <cmath>
 #include <algorithm>
 
-// --- Helper ---
-static int lcm(int a, int b) {
-    if (a == 0 || b == 0) return 0;
-    int x = a, y = b;
-    while (y != 0) {
-        int t = y;
-        y = x % y;
-        x = t;
-    }
-    return (a / x) * b;
-}
-
 MetronomeEngine::MetronomeEngine(QObject *parent)
     : QObject(parent)
 {
@@ -33,13 +21,13 @@ MetronomeEngine::MetronomeEngine(QObject *parent)
     };
 }
 
-void MetronomeEngine::setTempo(int bpm) {
+void MetronomeEngine::setTempo(double bpm) {
     m_tempoBpm = bpm;
     if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
 }
 
 // Kept for backward compat — now just an alias for setTempo when running.
-void MetronomeEngine::setTempoNow(int bpm) {
+void MetronomeEngine::setTempoNow(double bpm) {
     m_tempoBpm = bpm;
     if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
 }
@@ -71,6 +59,11 @@ void MetronomeEngine::setPolyrhythm(int main, int poly) {
     if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
 }
 
+void MetronomeEngine::setTracks(const std::vector<TrackParams>& tracks) {
+    m_tracks = tracks;
+    if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
+}
+
 int MetronomeEngine::beatsPerBar() const {
     if (isCompoundTime())
         return m_numerator / 3;
@@ -193,56 +186,24 @@ void MetronomeEngine::updatePulseSchedule(int /*countInBeats*/, bool skipAudioSc
 
     // --- SCHEDULE MAIN PULSES ---
     if (m_polyrhythmEnabled && m_polyrhythm.primaryBeats > 0 && m_polyrhythm.secondaryBeats > 0) {
-        // Polyrhythm scheduling (unchanged)
         int main = m_polyrhythm.primaryBeats;
         int poly = m_polyrhythm.secondaryBeats;
-        int columns = lcm(main, poly);
-
-        struct PulseInfo {
-            double time;
-            int gridColumn;
-            bool isMain;
-            bool isPoly;
-        };
-
-        std::vector<PulseInfo> pulses;
-        for (int i = 0; i < main; ++i) {
-            double t = i * barLenSec / main;
-            int col = int(std::round(t / barLenSec * columns));
-            pulses.push_back({t, col, true, false});
-        }
-        for (int i = 0; i < poly; ++i) {
-            double t = i * barLenSec / poly;
-            int col = int(std::round(t / barLenSec * columns));
-            pulses.push_back({t, col, false, true});
-        }
-        std::sort(pulses.begin(), pulses.end(), [](const PulseInfo& a, const PulseInfo& b) {
-            return a.time < b.time;
-        });
-
-        std::vector<PulseInfo> merged;
-        const double eps = 1e-6;
-        for (const auto& pi : pulses) {
-            if (!merged.empty() && std::abs(pi.time - merged.back().time) < eps) {
-                merged.back().isMain |= pi.isMain;
-                merged.back().isPoly |= pi.isPoly;
-            } else {
-                merged.push_back(pi);
-            }
-        }
+        int columns = polyrhythmColumns(main, poly);
+        const std::vector<PolyrhythmHit> merged = polyrhythmHits(main, poly);
 
         int barsNeeded = 1;
         for (int barNum = 0; barNum < barsNeeded; ++barNum) {
             for (size_t idx = 0; idx < merged.size(); ++idx) {
-                const auto& pi = merged[idx];
+                const PolyrhythmHit& hit = merged[idx];
+                const double t = hit.column * barLenSec / columns;
                 AudioPulseEvent ev;
                 ev.idx = int(idx);
-                ev.gridColumn = pi.gridColumn;
-                ev.isBeat = (pi.isMain && idx == 0);
-                ev.accent = pi.isMain;
-                ev.polyAccent = pi.isPoly;
+                ev.gridColumn = hit.column;
+                ev.isBeat = (hit.isMain && idx == 0);
+                ev.accent = hit.isMain;
+                ev.polyAccent = hit.isPoly;
                 ev.playPulse = true;
-                ev.samplePosInBar = int(std::round(pi.time * sampleRate)) + barNum * barLenSamples + countInEndSample;
+                ev.samplePosInBar = int(std::round(t * sampleRate)) + barNum * barLenSamples + countInEndSample;
                 ev.startOfCycle = (idx == 0);
                 m_pulseSchedule.push_back(ev);
             }
@@ -254,25 +215,8 @@ void MetronomeEngine::updatePulseSchedule(int /*countInBeats*/, bool skipAudioSc
         int subdivs = m_subdivisionPattern.pulses.size();
         if (subdivs == 0) subdivs = 1;
 
-        // Compute total pattern duration in beat fractions using NoteValue
-        double totalPatternDuration = 0.0;
-        for (const auto& pulse : m_subdivisionPattern.pulses) {
-            totalPatternDuration += noteValueBeatFraction(pulse.noteValue, compound);
-        }
-
-        // Determine whether this pattern is a "standard" pattern (fits exactly in one beat)
-        const double TOLERANCE = 1e-3;
-        bool isStandardPattern = false;
-        if (m_subdivisionPattern.category == SubdivisionCategory::Custom) {
-            isStandardPattern = false;
-        } else if (compound && m_subdivisionPattern.pulses.size() == 1 &&
-                   std::abs(noteValueBeatFraction(m_subdivisionPattern.pulses[0].noteValue, compound) - 1.0) < TOLERANCE) {
-            isStandardPattern = true;
-        } else {
-            isStandardPattern = (std::abs(totalPatternDuration - 1.0) < TOLERANCE);
-        }
-
-        if (isStandardPattern) {
+        // A "standard" pattern fits exactly in one beat (exact rational total)
+        if (isStandardPattern(m_subdivisionPattern, compound)) {
             // Classic metronome: repeat the pattern for each beat
             for (int b = 0; b < beats; ++b) {
                 double beatStartSec = b * secondsPerBeat;
@@ -310,28 +254,15 @@ void MetronomeEngine::updatePulseSchedule(int /*countInBeats*/, bool skipAudioSc
                 actualPatternDurationSeconds += noteValueBeatFraction(p.noteValue, compound) * secondsPerBeat;
             }
 
-            std::vector<double> beatStartTimes;
-            for (int b = 0; b < beats; ++b)
-                beatStartTimes.push_back(b * secondsPerBeat);
-
             double pulseOffsetSec = 0.0;
+            Fraction pulseStartBeats;
             for (int s = 0; s < m_subdivisionPattern.pulses.size(); ++s) {
                 const auto& pulse = m_subdivisionPattern.pulses[s];
                 AudioPulseEvent ev;
                 ev.idx = s;
                 ev.gridColumn = -1;
-                ev.isBeat = false;
-
-                double pulseStartSec = pulseOffsetSec;
-
-                bool accent = false;
-                for (int b = 0; b < beats; ++b) {
-                    if (std::abs(pulseStartSec - beatStartTimes[b]) < 1e-6) {
-                        accent = (m_accentPattern.size() > b && m_accentPattern[b]);
-                        ev.isBeat = true;
-                        break;
-                    }
-                }
+                ev.isBeat = pulseStartBeats.isInteger() && pulseStartBeats.num < beats;
+                pulseStartBeats += noteValueBeats(pulse.noteValue, compound);
 
                 ev.accent = pulse.accent;
                 ev.isBeat = (s == 0) ? true : ev.isBeat;
@@ -374,6 +305,12 @@ void MetronomeEngine::onAudioPulse(AudioPulseEvent ev) {
     // after a new session has already started.
     if (ev.runId != m_expectedRunId) return;
 
+    // Track pulses have their own bars and leave the main counters alone.
+    if (ev.track > 0) {
+        emit trackPulse(ev);
+        return;
+    }
+
     if (ev.newTempo > 0) {
         // A speed-trainer step-up just came into effect at this exact pulse.
         // Update the stored tempo so callers of currentTempo() see the new value.
@@ -398,7 +335,7 @@ void MetronomeEngine::onAudioPulse(AudioPulseEvent ev) {
 }
 
 // Called (via queued connection) when audio thread steps up the tempo.
-void MetronomeEngine::onAudioTempoSteppedUp(int newTempo) {
+void MetronomeEngine::onAudioTempoSteppedUp(double newTempo) {
     m_tempoBpm         = newTempo;
     m_globalPulseCount = 0;  // will be 1 on first pulse of new tempo (or after count-in)
     m_justExitedCountIn = false;
@@ -422,6 +359,8 @@ EngineParams MetronomeEngine::buildEngineParams() const {
     p.tempoStep        = m_speedTempoStep;
     p.maxTempo         = m_speedMaxTempo;
     p.startTempo       = m_tempoBpm;
+    p.sounds           = m_soundRouting;
+    p.tracks           = m_tracks;
     return p;
 }
 
@@ -436,10 +375,16 @@ bool MetronomeEngine::loadSample(const QString& name, const QString& resourcePat
     return m_audioEngine->loadSample(name, resourcePath);
 }
 void MetronomeEngine::setAccentSound(const QString& name) {
-    m_audioEngine->setAccentSound(name);
+    m_soundRouting.accent = m_audioEngine->soundId(name);
+    if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
 }
 void MetronomeEngine::setClickSound(const QString& name) {
-    m_audioEngine->setClickSound(name);
+    m_soundRouting.click = m_audioEngine->soundId(name);
+    if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
+}
+void MetronomeEngine::setSoundRouting(const SoundRouting& routing) {
+    m_soundRouting = routing;
+    if (m_running) m_audioEngine->setEngineParams(buildEngineParams());
 }
 void MetronomeEngine::setVolume(float vol) {
     m_audioEngine->setVolume(vol);
@@ -471,7 +416,7 @@ void MetronomeEngine::setCountInEnabled(bool enabled) {
     m_countInEnabled = enabled;
 }
 
-AudioEngine* MetronomeEngine::audioEngine() { 
+AudioEngine* MetronomeEngine::audioEngine() const { 
     return m_audioEngine; 
 }
 
@@ -487,28 +432,19 @@ void MetronomeEngine::scheduleCustomSubdivisionLoop() {
     // Use tempo BPM directly so dotted-quarter in compound time matches quarter-note duration for same BPM
     double secondsPerBeat = 60.0 / m_tempoBpm;
 
-    std::vector<double> beatStartTimes;
-    for (int b = 0; b < beatsPerBar; ++b)
-        beatStartTimes.push_back(b * secondsPerBeat);
-
     double pulseOffsetSec = 0.0;
+    Fraction pulseStartBeats;
     for (int s = 0; s < m_subdivisionPattern.pulses.size(); ++s) {
         const auto& pulse = m_subdivisionPattern.pulses[s];
         AudioPulseEvent ev;
         ev.idx = s;
         ev.gridColumn = -1;
-        ev.isBeat = false;
-
-        double pulseStartSec = pulseOffsetSec;
-        bool accent = false;
-        for (int b = 0; b < beatsPerBar; ++b) {
-            if (std::abs(pulseStartSec - beatStartTimes[b]) < 1e-6) {
-                accent = (m_accentPattern.size() > b && m_accentPattern[b]);
-                ev.isBeat = true;
-                break;
-            }
-        }
-        ev.accent = accent;
+
+        // Pulses that land exactly on a beat take that beat's accent.
+        const int beat = int(pulseStartBeats.num);
+        ev.isBeat = pulseStartBeats.isInteger() && beat < beatsPerBar;
+        ev.accent = ev.isBeat && int(m_accentPattern.size()) > beat && m_accentPattern[beat];
+        pulseStartBeats += noteValueBeats(pulse.noteValue, compound);
         ev.polyAccent = false;
         ev.playPulse = true;
         ev.isRest = pulse.isRest;
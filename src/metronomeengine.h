@@ -23,15 +23,18 @@ public:
 
     void setPulseIdx(int idx) { m_pulseIdx = idx; }
 
-    int currentTempo() const { return m_tempoBpm; }
-    void setTempo(int bpm);
-    void setTempoNow(int bpm);
+    double currentTempo() const { return m_tempoBpm; }
+    void setTempo(double bpm);
+    void setTempoNow(double bpm);
     void setTimeSignature(int num, int denom);
     void setAccentPattern(const std::vector<bool> &accents);
     void setSubdivisionPattern(const SubdivisionPattern& pattern);
     SubdivisionPattern subdivisionPattern() const { return m_subdivisionPattern; }
     void setPolyrhythmEnabled(bool enable);
     void setPolyrhythm(int main, int poly);
+    // Polymeter tracks played under the main bar (see TrackParams).
+    void setTracks(const std::vector<TrackParams>& tracks);
+    std::vector<TrackParams> tracks() const { return m_tracks; }
     void playCountInClick(bool accent = false);
 
     // Speed trainer params — set before calling start()
@@ -55,6 +58,9 @@ public:
     bool loadSample(const QString& name, const QString& resourcePath);
     void setAccentSound(const QString& name);
     void setClickSound(const QString& name);
+    // Per-pulse-kind sound IDs (see AudioEngine::soundId()).
+    void setSoundRouting(const SoundRouting& routing);
+    SoundRouting soundRouting() const { return m_soundRouting; }
     void setVolume(float vol);
     void playAccent();
     void playClick();
@@ -64,19 +70,20 @@ public:
 
     void startWithCountIn(int countInBeats);
 
-    AudioEngine* audioEngine();
+    AudioEngine* audioEngine() const;
 
 signals:
     void pulse(AudioPulseEvent ev);
-    void tempoSteppedUp(int newTempo);   // forwarded from AudioEngine (queued)
+    void trackPulse(AudioPulseEvent ev);   // ev.track >= 1; the main bar's pulses go to pulse()
+    void tempoSteppedUp(double newTempo);   // forwarded from AudioEngine (queued)
 
 private slots:
     void onAudioPulse(AudioPulseEvent ev);
-    void onAudioTempoSteppedUp(int newTempo);
+    void onAudioTempoSteppedUp(double newTempo);
 
 private:
     // General metronome state
-    int m_tempoBpm = 120;
+    double m_tempoBpm = 120;
     int m_numerator = 4;
     int m_denominator = 4;
     int m_pulseIdx = 0;
@@ -101,12 +108,15 @@ private:
 
     SubdivisionPattern m_subdivisionPattern;
     std::vector<bool> m_accentPattern;
+    SoundRouting m_soundRouting;
 
     // Polyrhythm state
     bool m_polyrhythmEnabled = false;
     Polyrhythm m_polyrhythm;
     double m_barLengthSeconds = 0.0;
 
+    std::vector<TrackParams> m_tracks;
+
     AudioEngine* m_audioEngine = nullptr;
 
     // Pulse schedule for current bar/cycle
@@ -0,0 +1,443 @@
+#include "mixkernel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define MIX_X86 1
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#  define MIX_NEON 1
+#  include <arm_neon.h>
+#endif
+
+// GCC/Clang only emit AVX2 code inside functions that ask for it; MSVC
+// accepts the intrinsics anywhere.
+#if defined(MIX_X86) && (defined(__GNUC__) || defined(__clang__))
+#  define MIX_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define MIX_TARGET(isa)
+#endif
+
+static void addScaledScalar(float* dst, const float* src, float gain, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] += src[i] * gain;
+}
+
+static void addInterleavedScalar(float* dst, const float* src, const float* gains, int channels, int n)
+{
+    for (int i = 0; i < n; ++i, dst += channels)
+        for (int c = 0; c < channels; ++c)
+            dst[c] += src[i] * gains[c];
+}
+
+static float dotScalar(const float* a, const float* b, int n)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+// 2^31 itself is not representable as int32; this is the largest float below it.
+static constexpr float kS32Max = 2147483520.0f;
+
+static void toS16Scalar(int16_t* dst, const float* src, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = int16_t(std::lrintf(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f));
+}
+
+static void toS32Scalar(int32_t* dst, const float* src, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = int32_t(std::lrintf(std::clamp(src[i] * 2147483648.0f, -2147483648.0f, kS32Max)));
+}
+
+void convertToS24(uint8_t* dst, const float* src, int n)
+{
+    for (int i = 0; i < n; ++i, dst += 3) {
+        const int32_t v = int32_t(std::lrintf(std::clamp(src[i], -1.0f, 1.0f) * 8388607.0f));
+        dst[0] = uint8_t(v);
+        dst[1] = uint8_t(v >> 8);
+        dst[2] = uint8_t(v >> 16);
+    }
+}
+
+#if defined(MIX_X86)
+MIX_TARGET("sse2")
+static void addScaledSse2(float* dst, const float* src, float gain, int n)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(dst + i),     _mm_mul_ps(_mm_loadu_ps(src + i),     g));
+        __m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(dst + i,     a);
+        _mm_storeu_ps(dst + i + 4, b);
+    }
+    for (; i < n; ++i)
+        dst[i] += src[i] * gain;
+}
+
+MIX_TARGET("sse2")
+static void addInterleavedSse2(float* dst, const float* src, const float* gains, int channels, int n)
+{
+    int i = 0;
+    switch (channels) {
+    case 1:
+        addScaledSse2(dst, src, gains[0], n);
+        return;
+    case 2: {
+        // Four frames at a time: each sample duplicated into an L/R pair.
+        const __m128 g = _mm_setr_ps(gains[0], gains[1], gains[0], gains[1]);
+        for (; i + 4 <= n; i += 4) {
+            const __m128 s = _mm_loadu_ps(src + i);
+            float* d = dst + 2 * i;
+            _mm_storeu_ps(d,     _mm_add_ps(_mm_loadu_ps(d),     _mm_mul_ps(_mm_unpacklo_ps(s, s), g)));
+            _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), g)));
+        }
+        break;
+    }
+    case 4: {
+        const __m128 g = _mm_loadu_ps(gains);
+        for (; i < n; ++i) {
+            float* d = dst + 4 * i;
+            _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), _mm_mul_ps(_mm_set1_ps(src[i]), g)));
+        }
+        break;
+    }
+    case 8: {
+        const __m128 g0 = _mm_loadu_ps(gains), g1 = _mm_loadu_ps(gains + 4);
+        for (; i < n; ++i) {
+            const __m128 s = _mm_set1_ps(src[i]);
+            float* d = dst + 8 * i;
+            _mm_storeu_ps(d,     _mm_add_ps(_mm_loadu_ps(d),     _mm_mul_ps(s, g0)));
+            _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_mul_ps(s, g1)));
+        }
+        break;
+    }
+    }
+    addInterleavedScalar(dst + size_t(i) * size_t(channels), src + i, gains, channels, n - i);
+}
+
+MIX_TARGET("sse2")
+static float dotSse2(const float* a, const float* b, int n)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),     _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    float sum = _mm_cvtss_f32(acc);
+    for (; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+MIX_TARGET("sse2")
+static void toS16Sse2(int16_t* dst, const float* src, int n)
+{
+    const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i),     lo), hi), scale);
+        __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi), scale);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    toS16Scalar(dst + i, src + i, n - i);
+}
+
+MIX_TARGET("sse2")
+static void toS32Sse2(int32_t* dst, const float* src, int n)
+{
+    const __m128 lo = _mm_set1_ps(-2147483648.0f), hi = _mm_set1_ps(kS32Max);
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo), hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_epi32(a));
+    }
+    toS32Scalar(dst + i, src + i, n - i);
+}
+
+MIX_TARGET("avx2,fma")
+static void addScaledAvx2(float* dst, const float* src, float gain, int n)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_fmadd_ps(_mm256_loadu_ps(src + i),     g, _mm256_loadu_ps(dst + i));
+        __m256 b = _mm256_fmadd_ps(_mm256_loadu_ps(src + i + 8), g, _mm256_loadu_ps(dst + i + 8));
+        _mm256_storeu_ps(dst + i,     a);
+        _mm256_storeu_ps(dst + i + 8, b);
+    }
+    for (; i < n; ++i)
+        dst[i] += src[i] * gain;
+}
+
+MIX_TARGET("avx2,fma")
+static void addInterleavedAvx2(float* dst, const float* src, const float* gains, int channels, int n)
+{
+    int i = 0;
+    switch (channels) {
+    case 1:
+        addScaledAvx2(dst, src, gains[0], n);
+        return;
+    case 2: {
+        // unpack duplicates within each 128-bit lane; permute2f128 puts the
+        // pairs back in frame order (s0 s0 .. s3 s3, then s4 s4 .. s7 s7).
+        const __m256 g = _mm256_setr_ps(gains[0], gains[1], gains[0], gains[1],
+                                        gains[0], gains[1], gains[0], gains[1]);
+        for (; i + 8 <= n; i += 8) {
+            const __m256 s  = _mm256_loadu_ps(src + i);
+            const __m256 lo = _mm256_unpacklo_ps(s, s);
+            const __m256 hi = _mm256_unpackhi_ps(s, s);
+            float* d = dst + 2 * i;
+            _mm256_storeu_ps(d,     _mm256_fmadd_ps(_mm256_permute2f128_ps(lo, hi, 0x20), g, _mm256_loadu_ps(d)));
+            _mm256_storeu_ps(d + 8, _mm256_fmadd_ps(_mm256_permute2f128_ps(lo, hi, 0x31), g, _mm256_loadu_ps(d + 8)));
+        }
+        break;
+    }
+    case 4: {
+        // Two frames per register.
+        const __m256  g   = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(gains));
+        const __m256i f01 = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+        const __m256i f23 = _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3);
+        for (; i + 4 <= n; i += 4) {
+            const __m256 s = _mm256_castps128_ps256(_mm_loadu_ps(src + i));
+            float* d = dst + 4 * i;
+            _mm256_storeu_ps(d,     _mm256_fmadd_ps(_mm256_permutevar8x32_ps(s, f01), g, _mm256_loadu_ps(d)));
+            _mm256_storeu_ps(d + 8, _mm256_fmadd_ps(_mm256_permutevar8x32_ps(s, f23), g, _mm256_loadu_ps(d + 8)));
+        }
+        break;
+    }
+    case 8: {
+        const __m256 g = _mm256_loadu_ps(gains);
+        for (; i < n; ++i) {
+            float* d = dst + 8 * i;
+            _mm256_storeu_ps(d, _mm256_fmadd_ps(_mm256_broadcast_ss(src + i), g, _mm256_loadu_ps(d)));
+        }
+        break;
+    }
+    }
+    addInterleavedScalar(dst + size_t(i) * size_t(channels), src + i, gains, channels, n - i);
+}
+
+MIX_TARGET("avx2,fma")
+static float dotAvx2(const float* a, const float* b, int n)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i),     _mm256_loadu_ps(b + i),     acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    __m256 acc8 = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    float sum = _mm_cvtss_f32(acc);
+    for (; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+MIX_TARGET("avx2,fma")
+static void toS16Avx2(int16_t* dst, const float* src, int n)
+{
+    const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f), scale = _mm256_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i),     lo), hi), scale);
+        __m256 b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i + 8), lo), hi), scale);
+        // packs works per 128-bit lane; restore sample order across lanes.
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    toS16Scalar(dst + i, src + i, n - i);
+}
+
+MIX_TARGET("avx2,fma")
+static void toS32Avx2(int32_t* dst, const float* src, int n)
+{
+    const __m256 lo = _mm256_set1_ps(-2147483648.0f), hi = _mm256_set1_ps(kS32Max);
+    const __m256 scale = _mm256_set1_ps(2147483648.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo), hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtps_epi32(a));
+    }
+    toS32Scalar(dst + i, src + i, n - i);
+}
+
+static bool cpuHasSse2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;   // part of the x86-64 baseline
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuHasAvx2Fma()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool fma     = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;   // OS saves YMM state
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif // MIX_X86
+
+#if defined(MIX_NEON)
+static void addScaledNeon(float* dst, const float* src, float gain, int n)
+{
+    const float32x4_t g = vdupq_n_f32(gain);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a = vmlaq_f32(vld1q_f32(dst + i),     vld1q_f32(src + i),     g);
+        float32x4_t b = vmlaq_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), g);
+        vst1q_f32(dst + i,     a);
+        vst1q_f32(dst + i + 4, b);
+    }
+    for (; i < n; ++i)
+        dst[i] += src[i] * gain;
+}
+
+static void addInterleavedNeon(float* dst, const float* src, const float* gains, int channels, int n)
+{
+    int i = 0;
+    switch (channels) {
+    case 1:
+        addScaledNeon(dst, src, gains[0], n);
+        return;
+    case 2: {
+        const float32x2_t lr = vld1_f32(gains);
+        const float32x4_t g  = vcombine_f32(lr, lr);
+        for (; i + 4 <= n; i += 4) {
+            const float32x4_t s = vld1q_f32(src + i);
+            const float32x4x2_t pairs = vzipq_f32(s, s);   // s0 s0 s1 s1 / s2 s2 s3 s3
+            float* d = dst + 2 * i;
+            vst1q_f32(d,     vmlaq_f32(vld1q_f32(d),     pairs.val[0], g));
+            vst1q_f32(d + 4, vmlaq_f32(vld1q_f32(d + 4), pairs.val[1], g));
+        }
+        break;
+    }
+    case 4: {
+        const float32x4_t g = vld1q_f32(gains);
+        for (; i < n; ++i) {
+            float* d = dst + 4 * i;
+            vst1q_f32(d, vmlaq_n_f32(vld1q_f32(d), g, src[i]));
+        }
+        break;
+    }
+    case 8: {
+        const float32x4_t g0 = vld1q_f32(gains), g1 = vld1q_f32(gains + 4);
+        for (; i < n; ++i) {
+            float* d = dst + 8 * i;
+            vst1q_f32(d,     vmlaq_n_f32(vld1q_f32(d),     g0, src[i]));
+            vst1q_f32(d + 4, vmlaq_n_f32(vld1q_f32(d + 4), g1, src[i]));
+        }
+        break;
+    }
+    }
+    addInterleavedScalar(dst + size_t(i) * size_t(channels), src + i, gains, channels, n - i);
+}
+
+static float dotNeon(const float* a, const float* b, int n)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i),     vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(half, half), 0);
+    for (; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+// vcvtnq (round to nearest) is AArch64; 32-bit ARM falls back to scalar.
+#if defined(__aarch64__)
+static void toS16Neon(int16_t* dst, const float* src, int n)
+{
+    const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i),     lo), hi), 32767.0f);
+        float32x4_t b = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), lo), hi), 32767.0f);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    toS16Scalar(dst + i, src + i, n - i);
+}
+
+static void toS32Neon(int32_t* dst, const float* src, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4)   // vcvtnq saturates, so no clamp is needed
+        vst1q_s32(dst + i, vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + i), 2147483648.0f)));
+    toS32Scalar(dst + i, src + i, n - i);
+}
+#else
+#  define toS16Neon toS16Scalar
+#  define toS32Neon toS32Scalar
+#endif
+#endif
+
+static const MixKernel kScalarKernel{"scalar", addScaledScalar, addInterleavedScalar,
+                                     toS16Scalar, toS32Scalar, dotScalar};
+#if defined(MIX_X86)
+static const MixKernel kSse2Kernel{"sse2", addScaledSse2, addInterleavedSse2, toS16Sse2, toS32Sse2, dotSse2};
+static const MixKernel kAvx2Kernel{"avx2", addScaledAvx2, addInterleavedAvx2, toS16Avx2, toS32Avx2, dotAvx2};
+#endif
+#if defined(MIX_NEON)
+static const MixKernel kNeonKernel{"neon", addScaledNeon, addInterleavedNeon, toS16Neon, toS32Neon, dotNeon};
+#endif
+
+const MixKernel& scalarMixKernel()
+{
+    return kScalarKernel;
+}
+
+std::vector<const MixKernel*> availableMixKernels()
+{
+    std::vector<const MixKernel*> kernels{&kScalarKernel};
+#if defined(MIX_X86)
+    if (cpuHasSse2())    kernels.push_back(&kSse2Kernel);
+    if (cpuHasAvx2Fma()) kernels.push_back(&kAvx2Kernel);
+#endif
+#if defined(MIX_NEON)
+    kernels.push_back(&kNeonKernel);
+#endif
+    return kernels;
+}
+
+const MixKernel& bestMixKernel()
+{
+    static const MixKernel* best = availableMixKernels().back();
+    return *best;
+}
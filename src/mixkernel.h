@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Mix kernels: the inner "dst[i] += src[i] * gain" loop of sample playback.
+//
+// Each instruction set gets its own implementation; bestMixKernel() picks the
+// widest one the running CPU supports (AVX2 > SSE2 on x86, NEON on ARM) and
+// falls back to the scalar loop elsewhere.  The choice is made once, so call
+// it off the audio thread (VoicePool does so in its constructor).
+//
+// Kernels use unaligned loads for the output buffer, whose alignment is up to
+// the audio backend, but sample data is stored in SampleVector so that voices
+// starting at frame 0 read from kMixAlignment-aligned memory.
+//
+// The same kernel set also converts the finished f32 mix to the integer
+// formats a device may want natively (clamped to [-1, 1], rounded to nearest),
+// and provides the dot product the resampler's FIR filter runs on.
+//
+// addInterleaved() is addScaled() into an interleaved multichannel buffer:
+// dst[i * channels + c] += src[i] * gains[c] for n frames.  1, 2, 4 and 8
+// channels have vector paths; other counts take the scalar loop.
+// ---------------------------------------------------------------------------
+struct MixKernel {
+    const char* name;
+    void (*addScaled)(float* dst, const float* src, float gain, int n);
+    void (*addInterleaved)(float* dst, const float* src, const float* gains, int channels, int n);
+    void (*toS16)(int16_t* dst, const float* src, int n);
+    void (*toS32)(int32_t* dst, const float* src, int n);
+    float (*dot)(const float* a, const float* b, int n);
+};
+
+// Packed little-endian 24-bit output; rare enough that it stays scalar.
+void convertToS24(uint8_t* dst, const float* src, int n);
+
+const MixKernel& scalarMixKernel();
+const MixKernel& bestMixKernel();
+// Every kernel usable on this CPU, scalar first (for benchmarking).
+std::vector<const MixKernel*> availableMixKernels();
+
+constexpr std::size_t kMixAlignment = 32;   // one AVX register
+
+template <typename T, std::size_t Align>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+using SampleVector = std::vector<float, AlignedAllocator<float, kMixAlignment>>;
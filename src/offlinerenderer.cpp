@@ -0,0 +1,239 @@
+#include "offlinerenderer.h"
+#include "audioengine.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSaveFile>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr int kMaxBarsPerSection = 100000;   // guards against a trainer that never arrives
+constexpr int kMaxTailSeconds    = 4;
+// A RIFF size field is 32 bits and counts 36 header bytes besides the samples
+constexpr qsizetype kMaxWavSamples     = qsizetype((0xFFFFFFFFull - 36) / sizeof(qint16));
+constexpr qsizetype kWriteBlockSamples = 1 << 16;
+
+struct SectionAudio {
+    SampleVector body;   // whole bars, count-ins included
+    SampleVector tail;   // ring-out of the last clicks past the final bar line
+    QString      error;
+};
+
+EngineParams paramsForSection(const MetronomeSection& s, const OfflineRenderOptions& o, AudioEngine& engine)
+{
+    EngineParams p;
+    p.bpm               = s.tempo;
+    p.numerator         = s.numerator;
+    p.denominator       = s.denominator;
+    p.polyrhythmEnabled = s.hasPolyrhythm;
+    if (s.hasPolyrhythm) {
+        Polyrhythm poly = enginePolyrhythmForSection(s);
+        p.polyMain      = poly.primaryBeats;
+        p.polySecondary = poly.secondaryBeats;
+    }
+    p.subdivision    = s.subdivisionPattern;
+    p.accents        = s.accents;
+    p.countInEnabled = o.countIn;
+    p.speedEnabled   = o.speedEnabled && o.tempoStep > 0;
+    p.barsPerStep    = o.barsPerStep;
+    p.tempoStep      = o.tempoStep;
+    p.maxTempo       = o.maxTempo;
+    p.startTempo     = s.tempo;
+    // Track sound sets load into this section's engine once each, under their file path
+    QHash<QString, int> loaded;
+    p.tracks         = engineTracksForSection(s, [&](const QString& file) {
+        if (!loaded.contains(file))
+            loaded.insert(file, engine.loadSample(file, file) ? engine.soundId(file) : -1);
+        return loaded.value(file);
+    });
+    return p;
+}
+
+bool cancelled(const OfflineRenderOptions& o)
+{
+    return o.cancel && o.cancel->load(std::memory_order_relaxed);
+}
+
+// countIn: the section opens the render and gets the count-in bar.
+void renderSection(const MetronomeSection& s, const OfflineRenderOptions& o, bool countIn, SectionAudio& out)
+{
+    AudioEngine engine;
+    engine.prepareOffline(o.sampleRate);
+    if (!engine.loadSample("accent", o.accentSound) || !engine.loadSample("click", o.clickSound)) {
+        out.error = QStringLiteral("could not load click sounds");
+        return;
+    }
+    EngineParams params = paramsForSection(s, o, engine);
+    if (!o.polyAccentSound.isEmpty()) {
+        if (!engine.loadSample("polyAccent", o.polyAccentSound)) {
+            out.error = QStringLiteral("could not load the polyrhythm sound");
+            return;
+        }
+        params.sounds.polyAccent = engine.soundId("polyAccent");
+    }
+    engine.setVolume(o.volume);
+    engine.startOffline(params, countIn);
+
+    // Without the trainer every playing bar counts; with it, only the bars
+    // played once the tempo has stopped climbing.
+    int counted = 0;
+    AudioEngine::OfflineBar bar;
+    for (int n = 0; counted < o.barsPerSection && n < kMaxBarsPerSection; ++n) {
+        if (cancelled(o)) return;
+        if (!engine.renderOfflineBar(out.body, &bar)) break;
+        if (!bar.countIn && (!params.speedEnabled || bar.tempo >= params.maxTempo))
+            ++counted;
+    }
+    engine.renderOfflineTail(out.tail, kMaxTailSeconds * o.sampleRate);
+}
+
+// Written through QSaveFile: a failed or cancelled write leaves no partial
+// file behind, and an existing file is only replaced once the new one is complete.
+bool writeWav16(const QString& path, const SampleVector& samples, int sampleRate,
+                const OfflineRenderOptions& o, QString* error)
+{
+    if (qsizetype(samples.size()) > kMaxWavSamples) {
+        *error = QStringLiteral("render too long for a WAV file (4 GiB limit)");
+        return false;
+    }
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        *error = f.errorString();
+        return false;
+    }
+
+    const quint32 dataBytes = quint32(qsizetype(samples.size()) * qsizetype(sizeof(qint16)));
+    QByteArray header(44, '\0');
+    char* h = header.data();
+    auto put32 = [](char* p, quint32 v) { qToLittleEndian(v, p); };
+    auto put16 = [](char* p, quint16 v) { qToLittleEndian(v, p); };
+    std::memcpy(h, "RIFF", 4);      put32(h + 4, 36 + dataBytes);
+    std::memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);              // fmt chunk size
+    put16(h + 20, 1);               // PCM
+    put16(h + 22, 1);               // mono
+    put32(h + 24, quint32(sampleRate));
+    put32(h + 28, quint32(sampleRate) * 2);
+    put16(h + 32, 2);               // block align
+    put16(h + 34, 16);              // bits per sample
+    std::memcpy(h + 36, "data", 4); put32(h + 40, dataBytes);
+    if (f.write(header) != header.size()) {
+        *error = f.errorString();
+        return false;
+    }
+
+    // Converted a block at a time, polling for cancellation between blocks
+    QByteArray pcm(kWriteBlockSamples * qsizetype(sizeof(qint16)), Qt::Uninitialized);
+    for (qsizetype at = 0; at < qsizetype(samples.size()); at += kWriteBlockSamples) {
+        if (cancelled(o)) {
+            f.cancelWriting();
+            *error = QStringLiteral("render cancelled");
+            return false;
+        }
+        const qsizetype n = std::min(kWriteBlockSamples, qsizetype(samples.size()) - at);
+        char* dst = pcm.data();
+        for (qsizetype k = 0; k < n; ++k) {
+            qint16 v = qint16(std::lround(std::clamp(samples[size_t(at + k)], -1.0f, 1.0f) * 32767.0f));
+            qToLittleEndian(v, dst);
+            dst += 2;
+        }
+        const qsizetype bytes = n * qsizetype(sizeof(qint16));
+        if (f.write(pcm.constData(), bytes) != bytes) {
+            *error = f.errorString();
+            f.cancelWriting();
+            return false;
+        }
+    }
+
+    if (!f.commit()) {
+        *error = f.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+OfflineRenderResult renderPresetToWav(const MetronomePreset& preset,
+                                      const OfflineRenderOptions& options,
+                                      const QString& wavPath)
+{
+    OfflineRenderResult result;
+    QElapsedTimer clock;
+    clock.start();
+
+    const int count = int(preset.sections.size());
+    if (count == 0) {
+        result.error = QStringLiteral("preset has no sections");
+        return result;
+    }
+    if (options.sampleRate < 8000 || options.sampleRate > 384000) {
+        result.error = QStringLiteral("unsupported sample rate %1").arg(options.sampleRate);
+        return result;
+    }
+
+    // ── Render sections in parallel ───────────────────────────────────────
+    std::vector<SectionAudio> sections(count);
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int i = next++; i < count; i = next++)
+            renderSection(preset.sections[i], options, options.countIn && i == 0, sections[i]);
+    };
+    int threads = options.threads > 0 ? options.threads : QThread::idealThreadCount();
+    threads = std::clamp(threads, 1, count);
+    std::vector<std::unique_ptr<QThread>> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.emplace_back(QThread::create(worker));
+        pool.back()->start();
+    }
+    worker();
+    for (auto& th : pool)
+        th->wait();
+    if (cancelled(options)) {
+        result.error = QStringLiteral("render cancelled");
+        return result;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (!sections[i].error.isEmpty()) {
+            result.error = QStringLiteral("section %1: %2").arg(i + 1).arg(sections[i].error);
+            return result;
+        }
+    }
+
+    // ── Stitch: bars end to end, each ring-out mixed over what follows ────
+    std::vector<size_t> offsets(count);
+    size_t end = 0, total = 0;
+    for (int i = 0; i < count; ++i) {
+        offsets[i] = end;
+        end += sections[i].body.size();
+        total = std::max(total, end + sections[i].tail.size());
+    }
+    if (total > size_t(kMaxWavSamples)) {
+        result.error = QStringLiteral("render too long for a WAV file (4 GiB limit)");
+        return result;
+    }
+    SampleVector mix(total, 0.0f);
+    for (int i = 0; i < count; ++i) {
+        const SectionAudio& s = sections[i];
+        float* dst = mix.data() + offsets[i];
+        for (size_t k = 0; k < s.body.size(); ++k) dst[k] += s.body[k];
+        dst += s.body.size();
+        for (size_t k = 0; k < s.tail.size(); ++k) dst[k] += s.tail[k];
+    }
+
+    if (!writeWav16(wavPath, mix, options.sampleRate, options, &result.error))
+        return result;
+
+    result.ok            = true;
+    result.frames        = qint64(mix.size());
+    result.audioSeconds  = double(mix.size()) / options.sampleRate;
+    result.renderSeconds = clock.nsecsElapsed() / 1e9;
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include "presetmanager.h"
+
+// ---------------------------------------------------------------------------
+// Offline render of a whole preset to a WAV click track.
+//
+// Every section is played by its own AudioEngine in offline mode, so the
+// bar state machine, count-ins, speed trainer and mixer are exactly the ones
+// used live.  Sections render in parallel on worker threads; each section's
+// bars are laid end to end and the ring-out of its last clicks is mixed over
+// the start of the next section, so the stitched file is sample-accurate.
+// ---------------------------------------------------------------------------
+struct OfflineRenderOptions {
+    int     sampleRate     = 48000;
+    int     barsPerSection = 8;      // playing bars; with the speed trainer, bars held at maxTempo
+    bool    countIn        = false;  // count-in bar at the start (and after each step-up)
+    bool    speedEnabled   = false;
+    int     barsPerStep    = 4;
+    int     tempoStep      = 2;
+    int     maxTempo       = 180;
+    QString accentSound    = QStringLiteral(":/resources/accent.wav");
+    QString clickSound     = QStringLiteral(":/resources/click.wav");
+    QString polyAccentSound;         // second polyrhythm layer; empty = accentSound
+    float   volume         = 0.8f;
+    int     threads        = 0;      // 0 = one per core
+    const std::atomic<bool>* cancel = nullptr;   // polled between bars; set to abandon the render
+};
+
+struct OfflineRenderResult {
+    bool    ok = false;
+    QString error;
+    qint64  frames = 0;
+    double  audioSeconds  = 0.0;
+    double  renderSeconds = 0.0;     // wall-clock time, including the WAV write
+    double  realtimeMultiple() const { return renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0; }
+};
+
+OfflineRenderResult renderPresetToWav(const MetronomePreset& preset,
+                                      const OfflineRenderOptions& options,
+                                      const QString& wavPath);
@@ -0,0 +1,109 @@
+#include "onsetdetector.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Below any level a real input reaches; keeps log10 finite on digital silence.
+constexpr double kSilenceDb = -140.0;
+
+// Noise floor tracking: follows the level straight down, creeps up slowly.
+constexpr double kNoiseRise = 0.002;   // fraction of the gap per hop
+
+double levelDb(double meanSquare)
+{
+    return meanSquare > 1e-14 ? 10.0 * std::log10(meanSquare) : kSilenceDb;
+}
+
+} // namespace
+
+OnsetDetector::OnsetDetector(int sampleRate, const MixKernel& kernel)
+    : m_kernel(&kernel)
+    , m_sampleRate(std::max(1, sampleRate))
+    , m_minInterval(int64_t(kMinIntervalMs * m_sampleRate / 1000.0))
+    , m_pole(float(std::exp(-2.0 * 3.14159265358979 * kHighPassHz / m_sampleRate)))
+    , m_buf(2 * kHop, 0.0f)
+{
+}
+
+void OnsetDetector::reset()
+{
+    m_started      = false;
+    m_fill         = 0;
+    m_prevIn       = 0.0f;
+    m_prevOut      = 0.0f;
+    m_contextCount = 0;
+    m_contextPos   = 0;
+    m_hadOnset     = false;
+    std::fill(m_buf.begin(), m_buf.end(), 0.0f);
+}
+
+void OnsetDetector::process(const float* in, int n, int64_t pos, std::vector<Onset>& onsets,
+                            std::vector<Hop>* hops)
+{
+    if (!m_started || pos != m_expectPos) {
+        reset();
+        m_started = true;
+        m_hopPos  = pos;
+        m_prevIn  = n > 0 ? in[0] : 0.0f;
+    }
+    m_expectPos = pos + n;
+
+    float* hop = m_buf.data() + kHop;
+    for (int i = 0; i < n; ) {
+        const int take = std::min(n - i, kHop - m_fill);
+        for (int k = 0; k < take; ++k) {
+            const float x = in[i + k];
+            m_prevOut = x - m_prevIn + m_pole * m_prevOut;
+            m_prevIn  = x;
+            hop[m_fill + k] = m_prevOut;
+        }
+        m_fill += take;
+        i      += take;
+        if (m_fill == kHop) {
+            finishHop(onsets, hops);
+            std::copy(hop, hop + kHop, m_buf.data());
+            m_fill    = 0;
+            m_hopPos += kHop;
+        }
+    }
+}
+
+void OnsetDetector::finishHop(std::vector<Onset>& onsets, std::vector<Hop>* hops)
+{
+    const float* hop = m_buf.data() + kHop;
+    const double db  = levelDb(double(m_kernel->dot(hop, hop, kHop)) / kHop);
+    if (hops)
+        hops->push_back({m_hopPos, float(db)});
+
+    if (m_contextCount == 0)
+        m_noiseDb = db;
+    else if (db < m_noiseDb)
+        m_noiseDb = db;
+    else
+        m_noiseDb += (db - m_noiseDb) * kNoiseRise;
+
+    if (m_contextCount > 0) {
+        const double quietest = *std::min_element(m_context, m_context + m_contextCount);
+        const bool   spaced   = !m_hadOnset || m_hopPos - m_lastOnset >= m_minInterval;
+        if (spaced && db - quietest >= kRiseDb && db >= kFloorDb && db >= m_noiseDb + kNoiseMarginDb) {
+            float peak = 0.0f;
+            for (int k = 0; k < kHop; ++k)
+                peak = std::max(peak, std::fabs(hop[k]));
+            int first = 2 * kHop - 1;
+            for (int k = 0; k < 2 * kHop; ++k) {
+                if (std::fabs(m_buf[k]) >= 0.5f * peak) { first = k; break; }
+            }
+            const int64_t at = m_hopPos - kHop + first;
+            if (!m_hadOnset || at - m_lastOnset >= m_minInterval) {
+                onsets.push_back({at, float(db)});
+                m_lastOnset = at;
+                m_hadOnset  = true;
+            }
+        }
+    }
+
+    m_context[m_contextPos] = db;
+    m_contextPos = (m_contextPos + 1) % kContextHops;
+    m_contextCount = std::min(m_contextCount + 1, kContextHops);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "mixkernel.h"
+
+// ---------------------------------------------------------------------------
+// OnsetDetector: streaming note-onset detection on a mono input signal.
+//
+// The input is high-passed (one pole at kHighPassHz, which drops rumble and
+// most hum but keeps the body of low notes) and cut into kHop-frame hops;
+// each hop's energy is one MixKernel::dot of the hop with itself.  A hop is
+// an onset when its level rises kRiseDb over the quietest of the (up to)
+// kContextHops before it, clears both kFloorDb and the tracked noise floor by
+// kNoiseMarginDb, and comes at least kMinIntervalMs after the previous onset.
+// The onset time is then refined to the first sample, in that hop or the one
+// before, that reaches half of the hop's peak, so it is not quantised to the
+// hop grid.
+//
+// Positions are on the caller's timeline.  A block that does not continue
+// where the previous one ended restarts detection.  Not thread-safe; meant
+// for a worker thread, never the audio callback.
+// ---------------------------------------------------------------------------
+class OnsetDetector {
+public:
+    static constexpr int    kHop           = 128;     // 2.7 ms at 48 kHz
+    static constexpr int    kContextHops   = 4;
+    static constexpr double kRiseDb        = 9.0;
+    static constexpr double kFloorDb       = -60.0;   // dBFS of the filtered signal
+    static constexpr double kNoiseMarginDb = 12.0;
+    static constexpr double kMinIntervalMs = 40.0;
+    static constexpr double kHighPassHz    = 150.0;
+
+    struct Onset {
+        int64_t samplePos;
+        float   levelDb;    // hop level at detection
+    };
+    // The level of every hop, for callers that want the envelope itself.
+    struct Hop {
+        int64_t samplePos;  // first sample of the hop
+        float   levelDb;
+    };
+
+    explicit OnsetDetector(int sampleRate = 48000, const MixKernel& kernel = bestMixKernel());
+
+    // Feed n samples that start at timeline position pos; onsets found are
+    // appended to `onsets`, and each completed hop to `hops` if given.
+    void process(const float* in, int n, int64_t pos, std::vector<Onset>& onsets,
+                 std::vector<Hop>* hops = nullptr);
+    void reset();
+
+    int sampleRate() const { return m_sampleRate; }
+
+private:
+    void finishHop(std::vector<Onset>& onsets, std::vector<Hop>* hops);
+
+    const MixKernel* m_kernel;
+    int     m_sampleRate;
+    int64_t m_minInterval;
+    float   m_pole;                // high-pass feedback coefficient
+    SampleVector m_buf;            // previous hop, then the hop being filled
+    int     m_fill      = 0;       // samples of the current hop so far
+    int64_t m_hopPos    = 0;       // timeline position of the current hop
+    int64_t m_expectPos = 0;       // where the next block should start
+    bool    m_started   = false;
+    float   m_prevIn  = 0.0f;      // high-pass state
+    float   m_prevOut = 0.0f;
+    double  m_context[kContextHops];
+    int     m_contextCount = 0;
+    int     m_contextPos   = 0;
+    double  m_noiseDb    = 0.0;
+    int64_t m_lastOnset  = 0;
+    bool    m_hadOnset   = false;
+};
@@ -0,0 +1,152 @@
+#include "pcmcache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'P', 'C', 'M', 'F', '3', '2', 0};
+
+// On-disk header; all fields little-endian.
+struct CacheHeader {
+    char    magic[8];
+    quint32 version;
+    quint32 sampleRate;   // rate of the stored frames
+    quint32 channels;     // always 1
+    quint32 reserved0;
+    quint64 frames;
+    quint8  reserved[32];
+};
+static_assert(sizeof(CacheHeader) == PcmDiskCache::kHeaderBytes, "cache header must stay 64 bytes");
+
+// Faults a mapped range in and keeps it resident until it is unmapped.
+// False where the platform, or RLIMIT_MEMLOCK, does not allow it.
+bool lockResident(const uchar* data, size_t bytes)
+{
+#ifdef Q_OS_UNIX
+    const uintptr_t page  = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t start = uintptr_t(data) & ~(page - 1);
+    return mlock(reinterpret_cast<const void*>(start), uintptr_t(data) + bytes - start) == 0;
+#else
+    Q_UNUSED(data); Q_UNUSED(bytes);
+    return false;
+#endif
+}
+
+} // namespace
+
+std::shared_ptr<const PcmData> PcmData::fromSamples(SampleVector samples, int sampleRate)
+{
+    std::shared_ptr<PcmData> pcm(new PcmData);
+    pcm->m_owned      = std::move(samples);
+    pcm->m_samples    = pcm->m_owned.data();
+    pcm->m_frames     = pcm->m_owned.size();
+    pcm->m_sampleRate = sampleRate;
+    return pcm;
+}
+
+PcmData::~PcmData() = default;
+
+PcmDiskCache::PcmDiskCache(const QString& directory)
+    : m_directory(directory)
+{
+    if (!m_directory.isEmpty() && !QDir().mkpath(m_directory))
+        m_directory.clear();
+}
+
+QString PcmDiskCache::defaultDirectory()
+{
+    const QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return base.isEmpty() ? QString() : base + "/pcm";
+}
+
+PcmDiskCache& PcmDiskCache::instance()
+{
+    static PcmDiskCache cache;
+    return cache;
+}
+
+QByteArray PcmDiskCache::contentKey(const QByteArray& encoded)
+{
+    return QCryptographicHash::hash(encoded, QCryptographicHash::Sha1).toHex();
+}
+
+QString PcmDiskCache::pathFor(const QByteArray& key, int rate) const
+{
+    return QStringLiteral("%1/%2-%3.pcm").arg(m_directory, QString::fromLatin1(key)).arg(rate);
+}
+
+std::shared_ptr<const PcmData> PcmDiskCache::load(const QByteArray& key, int rate) const
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    Q_UNUSED(key); Q_UNUSED(rate);
+    return nullptr;   // frames are stored little-endian and mapped as-is
+#else
+    if (!isEnabled() || key.isEmpty()) return nullptr;
+
+    auto file = std::make_unique<QFile>(pathFor(key, rate));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < kHeaderBytes)
+        return nullptr;
+
+    CacheHeader h;
+    if (file->read(reinterpret_cast<char*>(&h), sizeof h) != qint64(sizeof h))
+        return nullptr;
+    const quint64 frames = qFromLittleEndian(h.frames);
+    if (std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 ||
+        qFromLittleEndian(h.version) != kFormatVersion ||
+        qFromLittleEndian(h.channels) != 1 || frames == 0 ||
+        quint64(file->size()) != kHeaderBytes + frames * sizeof(float))
+        return nullptr;
+
+    uchar* mapped = file->map(kHeaderBytes, qint64(frames * sizeof(float)));
+    if (!mapped)
+        return nullptr;
+
+    // Loads run off the audio thread; the mapping has to be resident before
+    // it is handed to voices.
+    std::shared_ptr<PcmData> pcm(new PcmData);
+    const float* samples = reinterpret_cast<const float*>(mapped);
+    if (lockResident(mapped, size_t(frames * sizeof(float)))) {
+        pcm->m_samples = samples;
+        pcm->m_file    = std::move(file);
+    } else {
+        pcm->m_owned.assign(samples, samples + frames);
+        pcm->m_samples = pcm->m_owned.data();
+    }
+    pcm->m_frames     = size_t(frames);
+    pcm->m_sampleRate = int(qFromLittleEndian(h.sampleRate));
+    return pcm;
+#endif
+}
+
+bool PcmDiskCache::store(const QByteArray& key, int rate, const PcmData& pcm) const
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    Q_UNUSED(key); Q_UNUSED(rate); Q_UNUSED(pcm);
+    return false;
+#else
+    if (!isEnabled() || key.isEmpty() || pcm.frames() == 0) return false;
+
+    CacheHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version    = qToLittleEndian(kFormatVersion);
+    h.sampleRate = qToLittleEndian(quint32(pcm.sampleRate()));
+    h.channels   = qToLittleEndian(quint32(1));
+    h.frames     = qToLittleEndian(quint64(pcm.frames()));
+
+    QSaveFile file(pathFor(key, rate));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char*>(&h), sizeof h);
+    file.write(reinterpret_cast<const char*>(pcm.samples()), qint64(pcm.frames() * sizeof(float)));
+    return file.commit();
+#endif
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include "mixkernel.h"
+
+class QFile;
+
+// ---------------------------------------------------------------------------
+// PcmData: decoded mono float samples at one rate, immutable once built.
+//
+// The samples are either owned (decoded or resampled in this process) or a
+// read-only mapping of a PcmDiskCache file.  A mapping is shared with the
+// page cache, and with every other process that maps the same file.  It is
+// locked into memory as it is loaded, so a voice never takes a page fault
+// on the audio thread; where locking is not allowed the samples are copied
+// into owned memory instead and the file is not kept mapped.
+// ---------------------------------------------------------------------------
+class PcmData {
+public:
+    static std::shared_ptr<const PcmData> fromSamples(SampleVector samples, int sampleRate);
+    ~PcmData();
+
+    const float* samples() const { return m_samples; }
+    size_t       frames() const  { return m_frames; }
+    int          sampleRate() const { return m_sampleRate; }
+    bool         isMapped() const { return m_file != nullptr; }
+
+private:
+    friend class PcmDiskCache;
+    PcmData() = default;
+
+    SampleVector m_owned;
+    std::unique_ptr<QFile> m_file;   // keeps the mapping alive
+    const float* m_samples = nullptr;
+    size_t       m_frames  = 0;
+    int          m_sampleRate = 0;
+};
+
+// ---------------------------------------------------------------------------
+// PcmDiskCache: decoded, rate-converted PCM kept between runs.
+//
+// One file per (content key, rate): a 64-byte header followed by
+// little-endian float32 frames, so the sample data starts 64-byte aligned in
+// a mapping.  The key is a hash of the encoded file bytes, so renamed or
+// re-imported sounds hit the same entry and edited ones miss.  Rate 0 holds
+// the decode at the file's own rate.
+//
+// The header carries kFormatVersion; bump it whenever the decoder or the
+// resampler changes what a given input turns into, and stale entries are
+// ignored and rewritten.  Files are written through QSaveFile, so a reader
+// never maps a half-written entry.
+// ---------------------------------------------------------------------------
+class PcmDiskCache {
+public:
+    static constexpr quint32 kFormatVersion = 1;
+    static constexpr int     kHeaderBytes   = 64;
+
+    explicit PcmDiskCache(const QString& directory = defaultDirectory());
+
+    // <cache location>/pcm, or empty if the platform has no cache location.
+    static QString defaultDirectory();
+    // Shared instance used by PCMBuffer.
+    static PcmDiskCache& instance();
+
+    static QByteArray contentKey(const QByteArray& encoded);
+
+    // nullptr when there is no valid entry.
+    std::shared_ptr<const PcmData> load(const QByteArray& key, int rate) const;
+    bool store(const QByteArray& key, int rate, const PcmData& pcm) const;
+
+    bool    isEnabled() const { return !m_directory.isEmpty(); }
+    QString directory() const { return m_directory; }
+
+private:
+    QString pathFor(const QByteArray& key, int rate) const;
+    QString m_directory;
+};
@@ -1,4 +1,5 @@
 #include "presetmanager.h"
+#include "soundsets.h"
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -8,6 +9,51 @@
 
 PresetManager::PresetManager(QObject* parent) : QObject(parent) {}
 
+int sectionBeatCount(const MetronomeSection& s)
+{
+    if (s.denominator == 8 && s.numerator % 3 == 0 && s.numerator > 3)
+        return qMax(1, s.numerator / 3);
+    return qMax(1, s.numerator);
+}
+
+Polyrhythm enginePolyrhythmForSection(const MetronomeSection& s)
+{
+    Polyrhythm p = s.polyrhythm;
+    if (s.polyrhythmPerBeat) {
+        const int beats = sectionBeatCount(s);
+        p.primaryBeats *= beats;
+        p.secondaryBeats *= beats;
+    }
+    return p;
+}
+
+std::vector<TrackParams> engineTracksForSection(const MetronomeSection& s,
+                                                const std::function<int(const QString&)>& soundFor)
+{
+    std::vector<TrackParams> tracks;
+    for (const SectionTrack& st : s.tracks) {
+        TrackParams t;
+        t.numerator   = st.numerator;
+        t.denominator = st.denominator;
+        t.subdivision = st.subdivision;
+        t.accents.assign(size_t(qMax(1, st.numerator)), false);
+        t.accents[0]  = true;
+        t.gain        = st.gain;
+        if (soundFor && !st.soundSet.isEmpty()) {
+            for (const SoundSet& set : kSoundSets) {
+                if (st.soundSet != QLatin1String(set.name)) continue;
+                const int accent = soundFor(QString::fromLatin1(set.accent));
+                const int click  = soundFor(QString::fromLatin1(set.click));
+                if (accent >= 0) t.sounds.accent = accent;
+                if (click >= 0)  t.sounds.click  = click;
+                break;
+            }
+        }
+        tracks.push_back(t);
+    }
+    return tracks;
+}
+
 // --- Helpers for serializing SubdivisionPattern ---
 
 static QJsonObject toJson(const SubdivisionPattern& pattern) {
@@ -50,6 +96,48 @@ static SubdivisionPattern fromJson(const QJsonObject& obj) {
     return pattern;
 }
 
+static QJsonArray toJson(const std::vector<SectionTrack>& tracks) {
+    QJsonArray arr;
+    for (const SectionTrack& t : tracks) {
+        QJsonObject obj;
+        obj["numerator"]   = t.numerator;
+        obj["denominator"] = t.denominator;
+        obj["gain"]        = t.gain;
+        obj["subdivision"] = toJson(t.subdivision);
+        if (!t.soundSet.isEmpty())
+            obj["soundSet"] = t.soundSet;
+        if (t.dest != QLatin1String("all")) {
+            obj["dest"] = t.dest;
+            obj["pan"]  = t.pan;
+        }
+        arr.append(obj);
+    }
+    return arr;
+}
+
+static std::vector<SectionTrack> tracksFromJson(const QJsonArray& arr) {
+    std::vector<SectionTrack> tracks;
+    for (const QJsonValue& v : arr) {
+        QJsonObject obj = v.toObject();
+        SectionTrack t;
+        t.numerator   = qBound(1, obj.value("numerator").toInt(3), 32);
+        const int den = obj.value("denominator").toInt(4);
+        t.denominator = (den == 2 || den == 8 || den == 16) ? den : 4;
+        t.gain        = float(qBound(0.0, obj.value("gain").toDouble(1.0), 1.0));
+        if (obj.contains("subdivision")) {
+            SubdivisionPattern p = fromJson(obj.value("subdivision").toObject());
+            if (!p.pulses.isEmpty())
+                t.subdivision = p;
+        }
+        t.soundSet    = obj.value("soundSet").toString();
+        t.dest        = obj.value("dest").toString(QStringLiteral("all"));
+        t.pan         = float(qBound(-1.0, obj.value("pan").toDouble(0.0), 1.0));
+        tracks.push_back(t);
+        if (int(tracks.size()) == EngineParams::kMaxTracks) break;
+    }
+    return tracks;
+}
+
 // Resolve a file:// or content:// URL string to a usable QFile path
 static QString resolveFilePath(const QString& uriOrPath) {
     QUrl url(uriOrPath);
@@ -82,6 +170,8 @@ bool PresetManager::exportToFile(const QStringList& names, const QString& filePa
                 poly["perBeat"]        = s.polyrhythmPerBeat;
                 secObj["polyrhythm"] = poly;
             }
+            if (!s.tracks.empty())
+                secObj["tracks"] = toJson(s.tracks);
             sectionsArr.append(secObj);
         }
         obj["sections"] = sectionsArr;
@@ -209,7 +299,7 @@ static void loadPresetsFromObject(const QJsonObject& presetsObj, QMap<QString, M
         for (const QJsonValue& secVal : sectionsArr) {
             QJsonObject secObj = secVal.toObject();
             MetronomeSection s;
-            s.tempo = secObj.value("tempo").toInt();
+            s.tempo = secObj.value("tempo").toDouble();
             s.numerator = secObj.value("numerator").toInt();
             s.denominator = secObj.value("denominator").toInt();
             if (secObj.contains("subdivisionPattern") && secObj.value("subdivisionPattern").isObject()) {
@@ -234,6 +324,7 @@ static void loadPresetsFromObject(const QJsonObject& presetsObj, QMap<QString, M
                     ? polyObj.value("perBeat").toBool(true)
                     : false;
             }
+            s.tracks = tracksFromJson(secObj.value("tracks").toArray());
             p.sections.push_back(s);
         }
         out[p.songName] = p;
@@ -289,6 +380,8 @@ void PresetManager::saveToDisk(const QString& filename) const {
                 polyObj["perBeat"] = s.polyrhythmPerBeat;
                 secObj["polyrhythm"] = polyObj;
             }
+            if (!s.tracks.empty())
+                secObj["tracks"] = toJson(s.tracks);
             sectionsArr.append(secObj);
         }
         obj["sections"] = sectionsArr;
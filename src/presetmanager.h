@@ -4,13 +4,29 @@
 #include <QString>
 #include <QMap>
 #include <QVector>
+#include <functional>
 #include <vector>
 #include "metronomeengine.h"
 #include "subdivisionpattern.h"
 
+// A polymeter track under a section: its own meter and subdivision at the
+// section's tempo, the first beat accented.  soundSet names one of
+// kSoundSets; empty plays the main accent and click.  dest is an output
+// route as in the settings ("all", "2", "3+4" panned by pan); "all" leaves
+// the track on the event-class routes.
+struct SectionTrack {
+    int   numerator   = 3;
+    int   denominator = 4;
+    float gain        = 1.0f;
+    SubdivisionPattern subdivision{SubdivisionCategory::Standard, "Quarter Note", { {NoteValue::Quarter, false, false} }};
+    QString soundSet;
+    QString dest      = QStringLiteral("all");
+    float   pan       = 0.0f;
+};
+
 // --- PATCH: Use only SubdivisionPattern for per-section custom playback ---
 struct MetronomeSection {
-    int tempo;
+    double tempo;   // BPM, fractional to 1/100
     int numerator;
     int denominator;
     SubdivisionPattern subdivisionPattern;        // Only one pattern per section
@@ -19,6 +35,7 @@ struct MetronomeSection {
     bool hasPolyrhythm = false;
     Polyrhythm polyrhythm;
     bool polyrhythmPerBeat = true;
+    std::vector<SectionTrack> tracks;
 };
 
 struct MetronomePreset {
@@ -26,6 +43,17 @@ struct MetronomePreset {
     std::vector<MetronomeSection> sections;
 };
 
+// Beats per bar of a section (dotted-quarter beats in compound time).
+int sectionBeatCount(const MetronomeSection& s);
+// The section's polyrhythm as the engine plays it: per-beat ratios are
+// expanded to the whole bar.
+Polyrhythm enginePolyrhythmForSection(const MetronomeSection& s);
+// The section's tracks as the engine plays them.  soundFor loads a sound file
+// and returns its bank ID (-1 on failure); without it, or for a track on the
+// main sounds, the track keeps the default routing.
+std::vector<TrackParams> engineTracksForSection(const MetronomeSection& s,
+                                                const std::function<int(const QString&)>& soundFor = {});
+
 class PresetManager : public QObject {
     Q_OBJECT
 public:
@@ -377,7 +377,7 @@ Item {
 
             Text {
                 anchors { top: parent.top; left: parent.left; topMargin: 22; leftMargin: 24 }
-                text: controller.tempo
+                text: controller.tempoText
                 color: "#1c241d"; font.pixelSize: 58; font.bold: true
             }
 
@@ -453,7 +453,7 @@ Item {
         Text {
             width: parent.width
             anchors { horizontalCenter: parent.horizontalCenter; bottom: stageBeat.top; bottomMargin: 6 }
-            text: controller.tempo + " BPM"
+            text: controller.tempoText + " BPM"
             color: "#d6d6d6"; font.pixelSize: 30; font.bold: true
             horizontalAlignment: Text.AlignHCenter
         }
@@ -541,7 +541,7 @@ Item {
 
         Text {
             width: parent.width
-            text: controller.tempo + " BPM"
+            text: controller.tempoText + " BPM"
             color: "white"; font.pixelSize: 48; font.bold: true
             horizontalAlignment: Text.AlignHCenter
         }
@@ -43,6 +43,7 @@ ApplicationWindow {
     property var     _pendingNumCallback:  null
     property int     _pendingMin:          0
     property int     _pendingMax:          300
+    property int     _pendingDecimals:     0
     property int     _pendingSectionIndex: -1
     property string  _pendingPresetName:   ""
     property string  _pendingPresetSource:  "" // "desktop" or "android"
@@ -51,7 +52,7 @@ ApplicationWindow {
         target: androidInput
         function onAccepted(text) {
             if (root._pendingInputType === "number") {
-                var v = parseInt(text)
+                var v = root.parseNumber(text, root._pendingDecimals)
                 if (!isNaN(v) && v >= root._pendingMin && v <= root._pendingMax && root._pendingNumCallback)
                     root._pendingNumCallback(v)
             } else if (root._pendingInputType === "label") {
@@ -81,17 +82,27 @@ ApplicationWindow {
         function onCancelled() { root._pendingInputType = "" }
     }
 
-    function openNumberInput(label, val, minV, maxV, cb) {
+    // decimals > 0 takes a fractional value, rounded to that many places
+    function openNumberInput(label, val, minV, maxV, cb, decimals) {
+        decimals = decimals || 0
         if (Qt.platform.os === "android") {
             root._pendingInputType = "number"
             root._pendingMin = minV; root._pendingMax = maxV; root._pendingNumCallback = cb
-            androidInput.showNumber(label, val)
+            root._pendingDecimals = decimals
+            androidInput.showNumber(label, val, decimals > 0)
         } else {
             numberInputSheet.sheetLabel = label; numberInputSheet.currentVal = val
             numberInputSheet.minVal = minV; numberInputSheet.maxVal = maxV
+            numberInputSheet.decimals = decimals
             numberInputSheet.applyValue = cb; numberInputSheet.openWithFocus()
         }
     }
+    function parseNumber(text, decimals) {
+        if (decimals <= 0)
+            return parseInt(text)
+        var scale = Math.pow(10, decimals)
+        return Math.round(parseFloat(text.replace(",", ".")) * scale) / scale
+    }
     function openLabelInput(idx, currentLabel) {
         if (Qt.platform.os === "android") {
             root._pendingInputType = "label"; root._pendingSectionIndex = idx
@@ -122,6 +133,7 @@ ApplicationWindow {
     SubdivisionPickerSheet  { id: subSheet }
     TimeSignatureSheet      { id: timeSigSheet }
     PolyrhythmSheet         { id: polySheet }
+    PolymeterSheet          { id: tracksSheet }
     SettingsSheet           { id: settingsSheet }
     PresetPickerSheet       { id: pieceSheet }
     CustomSubdivisionSheet  { id: customSubSheet }
@@ -167,9 +179,19 @@ ApplicationWindow {
         property string sheetLabel: "Value"
         property int minVal: 0
         property int maxVal: 300
-        property int currentVal: 0
+        property real currentVal: 0
+        property int decimals: 0
         property var applyValue: null
 
+        IntValidator { id: numberIntValidator; bottom: numberInputSheet.minVal; top: numberInputSheet.maxVal }
+        DoubleValidator {
+            id: numberDoubleValidator
+            bottom: numberInputSheet.minVal; top: numberInputSheet.maxVal
+            decimals: numberInputSheet.decimals
+            notation: DoubleValidator.StandardNotation
+            locale: "C"
+        }
+
         ColumnLayout {
             anchors { fill: parent; margins: 16 }
             spacing: 12
@@ -181,12 +203,12 @@ ApplicationWindow {
             TextField {
                 id: numberField
                 Layout.fillWidth: true
-                inputMethodHints: Qt.ImhDigitsOnly
+                inputMethodHints: numberInputSheet.decimals > 0 ? Qt.ImhFormattedNumbersOnly : Qt.ImhDigitsOnly
                 horizontalAlignment: TextInput.AlignHCenter
                 font.pixelSize: 22; color: "white"
                 selectionColor: controller.accentColor; selectedTextColor: "white"
                 background: Rectangle { color: "#333"; radius: 4 }
-                validator: IntValidator { bottom: numberInputSheet.minVal; top: numberInputSheet.maxVal }
+                validator: numberInputSheet.decimals > 0 ? numberDoubleValidator : numberIntValidator
                 onAccepted: numberInputSheet.commitAndClose()
             }
             RowLayout {
@@ -209,7 +231,7 @@ ApplicationWindow {
 
         function close() { visible = false }
         function commitAndClose() {
-            var v = parseInt(numberField.text)
+            var v = root.parseNumber(numberField.text, decimals)
             if (!isNaN(v) && v >= minVal && v <= maxVal && applyValue) applyValue(v)
             close()
         }
@@ -452,10 +474,10 @@ ApplicationWindow {
         z: 200; visible: false
         color: "#1e1e1e"; border.color: "#555"; border.width: 1; radius: 6
 
-        property int fromTempo: 0
+        property string fromTempo: ""
 
         function open() {
-            fromTempo = controller.tempo
+            fromTempo = controller.tempoText
             bulkTargetField.text = ""
             bulkStepInput.text = "5"
             visible = true
@@ -895,7 +917,7 @@ ApplicationWindow {
                 }
             }
 
-            // Poly / Count In / Tap buttons
+            // Poly / Count In / Tap / Listen buttons
             ModeButton {
                 Layout.preferredHeight: 56; implicitWidth: 50
                 enabled: controller.sectionTableEnabled
@@ -903,6 +925,13 @@ ApplicationWindow {
                 active: controller.polyrhythmEnabled
                 onClicked: controller.togglePolyrhythm()
             }
+            ModeButton {
+                Layout.preferredHeight: 56; implicitWidth: 56
+                enabled: controller.sectionTableEnabled
+                text: "Tracks"
+                active: controller.tracks.length > 0
+                onClicked: tracksSheet.open()
+            }
             ModeButton {
                 Layout.preferredHeight: 56; implicitWidth: 56
                 text: "Count In"
@@ -914,6 +943,13 @@ ApplicationWindow {
                 text: "Tap"
                 onClicked: controller.tapTempo()
             }
+            ModeButton {
+                Layout.preferredHeight: 56; implicitWidth: 56
+                text: !controller.tempoListening ? "Listen"
+                      : controller.detectedTempo > 0 ? controller.detectedTempo.toFixed(0) + "?" : "..."
+                active: controller.tempoListening
+                onClicked: controller.toggleTempoListening()
+            }
 
         }
 
@@ -963,13 +999,13 @@ ApplicationWindow {
                 }
                 Text {
                     anchors.centerIn: parent
-                    text: controller.tempo
+                    text: controller.tempoText
                     color: "white"; font.pixelSize: 14
                 }
                 MouseArea {
                     anchors.fill: parent
                     onClicked: root.openNumberInput("Tempo", controller.tempo, 1, 300,
-                                   function(v) { controller.tempo = v })
+                                   function(v) { controller.tempo = v }, 2)
                 }
             }
         }
@@ -1266,12 +1302,117 @@ ApplicationWindow {
         }
     }
 
+    // ── Performance overlay (engine health; toggle in Settings or Ctrl+Shift+P) ──
+    Rectangle {
+        id: perfHud
+        visible: controller.perfHudVisible
+        anchors { top: parent.top; right: parent.right; topMargin: 52; rightMargin: 8 }
+        width: perfHudColumn.implicitWidth + 16
+        height: perfHudColumn.implicitHeight + 12
+        radius: 6
+        color: "#d0101010"
+        border.color: controller.engineDeadlineMisses > 0 || controller.engineXruns > 0 ? "#a03030" : "#3b3b3b"
+        z: 150
+
+        Column {
+            id: perfHudColumn
+            anchors.centerIn: parent
+            spacing: 1
+
+            Text {
+                text: "Load " + controller.engineLoadPercent + "%  ("
+                      + controller.engineCallbackP99Us.toFixed(0) + " / "
+                      + controller.engineDeadlineUs.toFixed(0) + " \u00b5s p99)"
+                color: controller.engineLoadPercent >= 70 ? "#ff6060" : "white"
+                font.pixelSize: 11; font.family: "monospace"
+            }
+            Text {
+                text: "Last " + controller.engineCallbackUs.toFixed(0) + "  max "
+                      + controller.engineCallbackMaxUs.toFixed(0) + "  headroom "
+                      + controller.engineHeadroomUs.toFixed(0) + " \u00b5s"
+                color: root.mutedText; font.pixelSize: 11; font.family: "monospace"
+            }
+            Text {
+                text: "Misses " + controller.engineDeadlineMisses + "  xruns "
+                      + controller.engineXruns + "  underruns " + controller.engineUnderruns
+                color: controller.engineDeadlineMisses > 0 || controller.engineXruns > 0 ? "#ff6060" : root.mutedText
+                font.pixelSize: 11; font.family: "monospace"
+            }
+            Text {
+                text: "Voices " + controller.engineVoices + "  queued " + controller.engineBacklog
+                      + "  out " + controller.outputLatencyMs.toFixed(1) + " ms"
+                color: root.mutedText; font.pixelSize: 11; font.family: "monospace"
+            }
+            Text {
+                text: "Stolen " + controller.engineStolenVoices + "  worst mix "
+                      + controller.engineWorstCaseMix + " MAC/cb"
+                color: root.mutedText; font.pixelSize: 11; font.family: "monospace"
+            }
+        }
+
+        MouseArea {
+            anchors.fill: parent
+            onDoubleClicked: controller.resetEngineStats()
+        }
+    }
+
+    // ── Timing feedback (player vs. click; enable in Settings) ─────────────
+    Rectangle {
+        id: timingHud
+        visible: controller.inputAnalysisEnabled
+        anchors { top: perfHud.visible ? perfHud.bottom : parent.top; right: parent.right
+                  topMargin: perfHud.visible ? 6 : 52; rightMargin: 8 }
+        width: timingHudColumn.implicitWidth + 16
+        height: timingHudColumn.implicitHeight + 12
+        radius: 6
+        color: "#d0101010"
+        border.color: "#3b3b3b"
+        z: 150
+
+        function signedMs(v) { return (v >= 0 ? "+" : "") + v.toFixed(1) }
+
+        Column {
+            id: timingHudColumn
+            anchors.centerIn: parent
+            spacing: 1
+
+            Text {
+                text: controller.timingMatched === 0
+                      ? (controller.running && !controller.inputCapturing ? "No input device" : "Play along\u2026")
+                      : "Last " + timingHud.signedMs(controller.timingLastMs) + "  mean "
+                        + timingHud.signedMs(controller.timingMeanMs) + "  sd "
+                        + controller.timingSdMs.toFixed(1) + " ms"
+                color: "white"; font.pixelSize: 11; font.family: "monospace"
+            }
+            Repeater {
+                model: controller.timingStats
+                Text {
+                    text: (modelData.isBeat ? "Beat " + modelData.beat : "  " + modelData.beat + "+" + modelData.idx)
+                          + "  " + timingHud.signedMs(modelData.meanMs) + " \u00b1 "
+                          + modelData.sdMs.toFixed(1) + "  (" + modelData.count + ")"
+                    color: Math.abs(modelData.meanMs) > 20 ? "#ff6060" : root.mutedText
+                    font.pixelSize: 11; font.family: "monospace"
+                }
+            }
+            Text {
+                text: controller.timingMatched + " of " + controller.timingOnsets + " onsets matched"
+                color: root.mutedText; font.pixelSize: 11; font.family: "monospace"
+            }
+        }
+
+        MouseArea {
+            anchors.fill: parent
+            onDoubleClicked: controller.resetTimingStats()
+        }
+    }
+
     // ── Keyboard shortcuts (Shortcut works at app level regardless of focus) ──
     Shortcut { sequence: " ";          onActivated: controller.startStop() }
     Shortcut { sequence: "Up";         onActivated: { var r = controller.currentSectionIndex; if (r > 0) controller.selectSection(r - 1) } }
     Shortcut { sequence: "Down";       onActivated: { controller.selectSection(controller.currentSectionIndex + 1) } }
     Shortcut { sequence: "Ctrl+Up";    enabled: controller.sectionTableEnabled; onActivated: controller.moveSectionUp() }
     Shortcut { sequence: "Ctrl+Down";  enabled: controller.sectionTableEnabled; onActivated: controller.moveSectionDown() }
+    Shortcut { sequence: "Ctrl+Shift+P"; onActivated: controller.perfHudVisible = !controller.perfHudVisible }
 
     // ── Reusable inline components ─────────────────────────────────────────
     component DarkButton: Button {
@@ -30,7 +30,7 @@ Window {
         // BPM display
         Text {
             Layout.fillWidth: true
-            text: controller.tempo + " BPM"
+            text: controller.tempoText + " BPM"
             color: "white"
             font.pixelSize: 36
             font.bold: true
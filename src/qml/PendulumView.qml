@@ -375,7 +375,7 @@ Item {
     Text {
         anchors.horizontalCenter: parent.horizontalCenter
         y: root.faceBot - 20
-        text: controller.tempo + " BPM"
+        text: controller.tempoText + " BPM"
         color: Qt.rgba(1, 1, 1, 0.75)
         font.pixelSize: 12; font.bold: true
         style: Text.Outline; styleColor: "#000"
@@ -0,0 +1,257 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+
+Drawer {
+    id: root
+    edge: Qt.BottomEdge
+    width: parent.width
+    height: 520
+    dragMargin: 0
+    background: Rectangle { color: "#252525" }
+
+    readonly property var denomValues: [2, 4, 8, 16]
+
+    // "Main" plays a track on the main accent and click
+    readonly property var trackSoundSets: ["Main"].concat(controller.soundSets)
+
+    // Output routes on the open device, as in Settings: all channels, each
+    // one alone, or a pan between neighbouring pairs
+    readonly property var routeDests: {
+        var dests = ["all"]
+        var n = controller.outputDeviceChannels
+        for (var c = 1; c <= n; ++c)
+            dests.push(String(c))
+        for (var l = 1; l + 1 <= n; l += 2)
+            dests.push(l + "+" + (l + 1))
+        return dests
+    }
+    function routeDestName(dest) {
+        if (dest === "all")
+            return "All channels"
+        return dest.indexOf("+") >= 0 ? "Channels " + dest : "Channel " + dest
+    }
+
+    function nextDenominator(d) {
+        var i = denomValues.indexOf(d)
+        return denomValues[(i + 1) % denomValues.length]
+    }
+
+    // ComboBox in the sheet's dark style
+    component TrackComboBox: ComboBox {
+        id: tc
+        Layout.preferredHeight: 34
+        background: Rectangle { color: "#2a2a2a"; radius: 3; border.color: "#555" }
+        contentItem: Text {
+            text: tc.displayText; color: "white"; font.pixelSize: 13
+            leftPadding: 6; verticalAlignment: Text.AlignVCenter; elide: Text.ElideRight
+        }
+        popup: Popup {
+            y: tc.height + 2
+            width: tc.width
+            padding: 0
+            background: Rectangle { color: "#1e1e1e"; border.color: "#555"; radius: 3 }
+            contentItem: ListView {
+                implicitHeight: Math.min(contentHeight, 240)
+                model: tc.delegateModel
+                clip: true
+                ScrollIndicator.vertical: ScrollIndicator {}
+            }
+        }
+        delegate: ItemDelegate {
+            width: tc.width
+            highlighted: tc.highlightedIndex === index
+            background: Rectangle {
+                color: highlighted ? controller.accentColor : (hovered ? "#2e2e2e" : "#1e1e1e")
+            }
+            contentItem: Text {
+                text: modelData
+                color: "white"
+                font.pixelSize: 13
+                verticalAlignment: Text.AlignVCenter
+                leftPadding: 6
+            }
+        }
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        spacing: 0
+
+        // ── Title bar ────────────────────────────────────────────────────
+        Rectangle {
+            Layout.fillWidth: true
+            height: 44
+            color: "#1e1e1e"
+            RowLayout {
+                anchors { fill: parent; leftMargin: 14; rightMargin: 6 }
+                Text { text: "Polymeter Tracks"; color: "white"; font.pixelSize: 14; font.bold: true; Layout.fillWidth: true }
+                Item {
+                    width: 36; height: 36
+                    Rectangle { width: 18; height: 2; color: "#aaa"; anchors.centerIn: parent; rotation: 45 }
+                    Rectangle { width: 18; height: 2; color: "#aaa"; anchors.centerIn: parent; rotation: -45 }
+                    MouseArea { anchors.fill: parent; onClicked: root.close() }
+                }
+            }
+        }
+
+        // ── Track list ───────────────────────────────────────────────────
+        ColumnLayout {
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            Layout.margins: 14
+            spacing: 8
+
+            Text {
+                text: "Each track counts its own meter under the section at the same tempo. "
+                      + "Changes are saved with the section and play from the next bar line."
+                color: "#ccc"; font.pixelSize: 11; wrapMode: Text.Wrap
+                Layout.fillWidth: true
+            }
+
+            ScrollView {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                clip: true
+
+                ColumnLayout {
+                    width: parent.width
+                    spacing: 6
+
+                    // The rows read controller.tracks by index so an edit,
+                    // which re-emits the list, does not rebuild them mid-drag
+                    Repeater {
+                        model: controller.tracks.length
+                        delegate: ColumnLayout {
+                            id: trackRow
+                            required property int index
+                            readonly property var track: controller.tracks[index]
+                                || { numerator: 3, denominator: 4, gain: 1, subdivision: "", soundSet: "", subdivisions: [], dest: "all", pan: 0 }
+                            Layout.fillWidth: true
+                            spacing: 4
+
+                            RowLayout {
+                                Layout.fillWidth: true
+                                spacing: 8
+
+                                // Beat light, brighter on the track's downbeat
+                                Rectangle {
+                                    id: beatLight
+                                    width: 12; height: 12; radius: 6
+                                    color: "#444"
+                                    Connections {
+                                        target: controller
+                                        function onTrackPulse(track, accent) {
+                                            if (track !== trackRow.index + 1) return
+                                            beatLight.color = accent ? controller.accentColor : "#aaa"
+                                            beatFade.restart()
+                                        }
+                                    }
+                                    ColorAnimation on color { id: beatFade; running: false; to: "#444"; duration: 150 }
+                                }
+
+                                SpinBox {
+                                    id: numSpin
+                                    from: 1; to: 32
+                                    value: trackRow.track.numerator
+                                    editable: true
+                                    Layout.preferredWidth: 110
+                                    contentItem: TextInput {
+                                        text: numSpin.textFromValue(numSpin.value, numSpin.locale)
+                                        color: "white"; horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter
+                                        readOnly: !numSpin.editable; validator: numSpin.validator; inputMethodHints: Qt.ImhDigitsOnly
+                                    }
+                                    background: Rectangle { color: "#2a2a2a"; border.color: "#555"; radius: 3 }
+                                    onValueModified: controller.setTrack(trackRow.index, value, trackRow.track.denominator, trackRow.track.gain)
+                                }
+
+                                Button {
+                                    text: "/ " + trackRow.track.denominator
+                                    Layout.preferredWidth: 48; Layout.preferredHeight: 36
+                                    onClicked: controller.setTrack(trackRow.index, trackRow.track.numerator,
+                                                                   root.nextDenominator(trackRow.track.denominator), trackRow.track.gain)
+                                    background: Rectangle { color: "#2a2a2a"; border.color: "#555"; radius: 3 }
+                                    contentItem: Text {
+                                        text: parent.text; color: "white"; font.pixelSize: 14
+                                        horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter
+                                    }
+                                }
+
+                                Slider {
+                                    id: gainSlider
+                                    Layout.fillWidth: true
+                                    from: 0; to: 1
+                                    value: trackRow.track.gain
+                                    // Saved once the drag ends: every edit rewrites the preset file
+                                    onPressedChanged: if (!pressed)
+                                        controller.setTrack(trackRow.index, trackRow.track.numerator, trackRow.track.denominator, value)
+                                }
+
+                                Item {
+                                    width: 30; height: 30
+                                    Rectangle { width: 14; height: 2; color: "#aaa"; anchors.centerIn: parent; rotation: 45 }
+                                    Rectangle { width: 14; height: 2; color: "#aaa"; anchors.centerIn: parent; rotation: -45 }
+                                    MouseArea { anchors.fill: parent; onClicked: controller.removeTrack(trackRow.index) }
+                                }
+                            }
+
+                            // Subdivision and sound set, indented under the beat light
+                            RowLayout {
+                                Layout.fillWidth: true
+                                Layout.leftMargin: 20
+                                spacing: 8
+
+                                TrackComboBox {
+                                    model: trackRow.track.subdivisions
+                                    currentIndex: Math.max(0, model.indexOf(trackRow.track.subdivision))
+                                    Layout.fillWidth: true
+                                    onActivated: controller.setTrackSubdivision(trackRow.index, currentText)
+                                }
+
+                                TrackComboBox {
+                                    model: root.trackSoundSets
+                                    currentIndex: Math.max(0, model.indexOf(trackRow.track.soundSet))
+                                    Layout.fillWidth: true
+                                    onActivated: controller.setTrackSoundSet(trackRow.index, currentIndex === 0 ? "" : currentText)
+                                }
+                            }
+
+                            // Output route, on devices with more than one channel
+                            RowLayout {
+                                Layout.fillWidth: true
+                                Layout.leftMargin: 20
+                                spacing: 8
+                                visible: controller.outputDeviceChannels >= 2
+
+                                TrackComboBox {
+                                    model: root.routeDests.map(root.routeDestName)
+                                    currentIndex: Math.max(0, root.routeDests.indexOf(trackRow.track.dest))
+                                    Layout.fillWidth: true
+                                    onActivated: controller.setTrackRoute(trackRow.index, root.routeDests[currentIndex], trackRow.track.pan)
+                                }
+
+                                Slider {
+                                    visible: trackRow.track.dest.indexOf("+") >= 0
+                                    Layout.fillWidth: true
+                                    from: -1; to: 1
+                                    value: trackRow.track.pan
+                                    onPressedChanged: if (!pressed)
+                                        controller.setTrackRoute(trackRow.index, trackRow.track.dest, value)
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            Button {
+                text: "Add track"
+                enabled: controller.tracks.length < 32
+                Layout.fillWidth: true; Layout.preferredHeight: 40
+                onClicked: controller.addTrack(3, 4)
+                background: Rectangle { color: controller.accentColor; radius: 3; opacity: parent.enabled ? 1 : 0.5 }
+                contentItem: Text { text: parent.text; color: "white"; font.pixelSize: 15; horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter }
+            }
+        }
+    }
+}
@@ -10,21 +10,61 @@ Drawer {
     background: Rectangle { color: "#252525" }
 
     // Animate height transition between settings and colour picker panels
-    height: showingColorPicker ? 380 : 470
+    height: showingColorPicker ? 380 : (routeChannels >= 2 ? 608 : 562)
     Behavior on height { NumberAnimation { duration: 180; easing.type: Easing.OutCubic } }
 
     signal openBackupRequested()
 
-    property var soundSets: ["Default", "Bongo", "Cowbell", "Digital", "Drum", "Hihat", "Metal", "Wooden", "Wooden 2", "Wooden 3"]
+    readonly property var soundSets: controller.soundSets
 
     property bool showingColorPicker: false
+    property bool showingRouting: false
 
     // Pending settings values
     property string pendingSoundSet:    controller.soundSet
+    property string pendingPolySoundSet: controller.polySoundSet
     property color  pendingAccentColor: controller.accentColor
     property bool   pendingAlwaysOnTop:    controller.alwaysOnTop
     property bool   pendingBeatWindowAuto: controller.beatWindowAuto
     property string pendingTerminology: controller.terminology
+    property bool   pendingPerfHud:     controller.perfHudVisible
+    property bool   pendingLowLatency:  controller.lowLatencyMode
+    property int    pendingPeriodFrames: controller.outputPeriodFrames
+    property int    pendingChannels:    controller.outputChannels
+    property int    pendingUiOffset:    controller.uiLatencyOffsetMs
+    property int    pendingMaxVoices:   controller.maxVoices
+    property bool   pendingInputAnalysis: controller.inputAnalysisEnabled
+    property int    pendingInputOffset: controller.inputLatencyOffsetMs
+    property bool   pendingTempoAutoStart: controller.tempoListenAutoStart
+    readonly property var periodChoices: [0, 64, 128, 256, 512, 1024]
+    readonly property var channelChoices: [0, 1, 2, 4, 8]
+    property var pendingRoutes: controller.outputRoutes
+
+    // Channels the routing panel offers: the chosen count, or the device's
+    // own in low-latency mode, where "Default" opens it natively
+    readonly property int routeChannels: pendingChannels >= 2 ? pendingChannels
+                                         : (pendingChannels === 0 && pendingLowLatency ? controller.outputDeviceChannels : 1)
+
+    // Destinations for a route on n channels: all of them, each one alone,
+    // or a pan between neighbouring pairs
+    function routeDests(n) {
+        var dests = ["all"]
+        for (var c = 1; c <= n; ++c)
+            dests.push(String(c))
+        for (var l = 1; l + 1 <= n; l += 2)
+            dests.push(l + "+" + (l + 1))
+        return dests
+    }
+    function routeDestName(dest) {
+        if (dest === "all")
+            return "All channels"
+        return dest.indexOf("+") >= 0 ? "Channels " + dest : "Channel " + dest
+    }
+    function setPendingRoute(index, dest, pan) {
+        var routes = pendingRoutes.slice()
+        routes[index] = { name: routes[index].name, dest: dest, pan: pan }
+        pendingRoutes = routes
+    }
 
     function displaySoundSetName(name) {
         if (name === "Woodblock")
@@ -79,19 +119,80 @@ Drawer {
         }
     }
 
+    // ComboBox in the sheet's dark style
+    component SheetComboBox: ComboBox {
+        id: sc
+        Layout.preferredHeight: 38
+        background: Rectangle { color: "#2a2a2a"; radius: 3; border.color: "#555" }
+        contentItem: Text {
+            text: sc.displayText; color: "white"; font.pixelSize: 15
+            leftPadding: 6; verticalAlignment: Text.AlignVCenter
+        }
+        popup: Popup {
+            y: sc.height + 2
+            width: sc.width
+            padding: 0
+            background: Rectangle { color: "#1e1e1e"; border.color: "#555"; radius: 3 }
+            contentItem: ListView {
+                implicitHeight: contentHeight
+                model: sc.delegateModel
+                clip: true
+                ScrollIndicator.vertical: ScrollIndicator {}
+            }
+        }
+        delegate: ItemDelegate {
+            width: sc.width
+            highlighted: sc.highlightedIndex === index
+            background: Rectangle {
+                color: highlighted ? controller.accentColor : (hovered ? "#2e2e2e" : "#1e1e1e")
+            }
+            contentItem: Text {
+                text: modelData
+                color: "white"
+                font.pixelSize: 15
+                verticalAlignment: Text.AlignVCenter
+                leftPadding: 6
+            }
+        }
+    }
+
     onOpened: {
         showingColorPicker = false
+        showingRouting = false
         pendingSoundSet    = displaySoundSetName(controller.soundSet)
+        pendingPolySoundSet = controller.polySoundSet
         pendingAccentColor = controller.accentColor
         pendingAlwaysOnTop = controller.alwaysOnTop
         pendingBeatWindowAuto = controller.beatWindowAuto
         pendingTerminology = controller.terminology
+        pendingPerfHud     = controller.perfHudVisible
+        pendingLowLatency  = controller.lowLatencyMode
+        pendingPeriodFrames = controller.outputPeriodFrames
+        pendingChannels    = controller.outputChannels
+        pendingRoutes      = controller.outputRoutes
+        pendingUiOffset    = controller.uiLatencyOffsetMs
+        pendingMaxVoices   = controller.maxVoices
+        pendingInputAnalysis = controller.inputAnalysisEnabled
+        pendingInputOffset = controller.inputLatencyOffsetMs
+        pendingTempoAutoStart = controller.tempoListenAutoStart
         var i = soundSets.indexOf(pendingSoundSet)
         soundSetCombo.currentIndex = i >= 0 ? i : 0
+        polySoundCombo.currentIndex = soundSets.indexOf(pendingPolySoundSet) + 1
         var ti = ["Piece", "Song", "Preset"].indexOf(pendingTerminology)
         terminologyCombo.currentIndex = ti >= 0 ? ti : 0
         topCheck.checked = pendingAlwaysOnTop
         beatWindowAutoCheck.checked = pendingBeatWindowAuto
+        perfHudCheck.checked = pendingPerfHud
+        lowLatencyCheck.checked = pendingLowLatency
+        var pi = periodChoices.indexOf(pendingPeriodFrames)
+        periodCombo.currentIndex = pi >= 0 ? pi : 0
+        var ci = channelChoices.indexOf(pendingChannels)
+        channelCombo.currentIndex = ci >= 0 ? ci : 0
+        uiOffsetSpin.value = pendingUiOffset
+        maxVoicesSpin.value = pendingMaxVoices
+        inputAnalysisCheck.checked = pendingInputAnalysis
+        inputOffsetSpin.value = pendingInputOffset
+        tempoAutoStartCheck.checked = pendingTempoAutoStart
     }
 
     function openColorPicker() {
@@ -127,9 +228,9 @@ Drawer {
             RowLayout {
                 anchors { fill: parent; leftMargin: 14; rightMargin: 6 }
                 ToolButton {
-                    visible: root.showingColorPicker
+                    visible: root.showingColorPicker || root.showingRouting
                     implicitWidth: 36; implicitHeight: 36
-                    onClicked: root.showingColorPicker = false
+                    onClicked: { root.showingColorPicker = false; root.showingRouting = false }
                     contentItem: Image {
                         source: "qrc:/resources/svg/section_down.svg"
                         sourceSize: Qt.size(512,512); width: 20; height: 20
@@ -140,7 +241,7 @@ Drawer {
                     }
                 }
                 Text {
-                    text: root.showingColorPicker ? "Accent Color" : "Settings"
+                    text: root.showingColorPicker ? "Accent Color" : root.showingRouting ? "Output Routing" : "Settings"
                     color: "white"; font.pixelSize: 14; font.bold: true
                     Layout.fillWidth: true
                 }
@@ -155,7 +256,7 @@ Drawer {
 
         // ── Settings panel ───────────────────────────────────────────────
         ColumnLayout {
-            visible: !root.showingColorPicker
+            visible: !root.showingColorPicker && !root.showingRouting
             Layout.fillWidth: true
             Layout.fillHeight: true
             Layout.margins: 12
@@ -204,6 +305,17 @@ Drawer {
                 }
             }
 
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Polyrhythm Sound:"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                SheetComboBox {
+                    id: polySoundCombo
+                    model: ["Accent"].concat(root.soundSets)
+                    Layout.preferredWidth: 140
+                    onActivated: root.pendingPolySoundSet = currentIndex === 0 ? "" : currentText
+                }
+            }
+
             RowLayout {
                 Layout.fillWidth: true
                 Text { text: "Terminology:"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
@@ -284,6 +396,213 @@ Drawer {
                 }
             }
 
+            CheckBox {
+                id: perfHudCheck
+                text: "Show performance overlay"
+                onCheckedChanged: root.pendingPerfHud = checked
+                contentItem: Text {
+                    text: parent.text; color: "white"; font.pixelSize: 15
+                    verticalAlignment: Text.AlignVCenter
+                    leftPadding: parent.indicator.width + parent.spacing
+                }
+            }
+
+            CheckBox {
+                id: lowLatencyCheck
+                text: "Low-latency output"
+                onCheckedChanged: root.pendingLowLatency = checked
+                contentItem: Text {
+                    text: parent.text; color: "white"; font.pixelSize: 15
+                    verticalAlignment: Text.AlignVCenter
+                    leftPadding: parent.indicator.width + parent.spacing
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Buffer size:"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                ComboBox {
+                    id: periodCombo
+                    model: root.periodChoices.map(function(f) { return f === 0 ? "Default" : f + " frames" })
+                    Layout.preferredWidth: 140
+                    Layout.preferredHeight: 38
+                    background: Rectangle { color: "#2a2a2a"; radius: 3; border.color: "#555" }
+                    contentItem: Text {
+                        text: periodCombo.displayText; color: "white"; font.pixelSize: 15
+                        leftPadding: 6; verticalAlignment: Text.AlignVCenter
+                    }
+                    popup: Popup {
+                        y: periodCombo.height + 2
+                        width: periodCombo.width
+                        padding: 0
+                        background: Rectangle { color: "#1e1e1e"; border.color: "#555"; radius: 3 }
+                        contentItem: ListView {
+                            implicitHeight: contentHeight
+                            model: periodCombo.delegateModel
+                            clip: true
+                            ScrollIndicator.vertical: ScrollIndicator {}
+                        }
+                    }
+                    delegate: ItemDelegate {
+                        width: periodCombo.width
+                        highlighted: periodCombo.highlightedIndex === index
+                        background: Rectangle {
+                            color: highlighted ? controller.accentColor : (hovered ? "#2e2e2e" : "#1e1e1e")
+                        }
+                        contentItem: Text {
+                            text: modelData
+                            color: "white"
+                            font.pixelSize: 15
+                            verticalAlignment: Text.AlignVCenter
+                            leftPadding: 6
+                        }
+                    }
+                    onActivated: root.pendingPeriodFrames = root.periodChoices[currentIndex]
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Output channels:"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                ComboBox {
+                    id: channelCombo
+                    model: root.channelChoices.map(function(c) {
+                        return c === 0 ? "Default" : c === 1 ? "Mono" : c === 2 ? "Stereo" : c + " channels"
+                    })
+                    Layout.preferredWidth: 140
+                    Layout.preferredHeight: 38
+                    background: Rectangle { color: "#2a2a2a"; radius: 3; border.color: "#555" }
+                    contentItem: Text {
+                        text: channelCombo.displayText; color: "white"; font.pixelSize: 15
+                        leftPadding: 6; verticalAlignment: Text.AlignVCenter
+                    }
+                    popup: Popup {
+                        y: channelCombo.height + 2
+                        width: channelCombo.width
+                        padding: 0
+                        background: Rectangle { color: "#1e1e1e"; border.color: "#555"; radius: 3 }
+                        contentItem: ListView {
+                            implicitHeight: contentHeight
+                            model: channelCombo.delegateModel
+                            clip: true
+                            ScrollIndicator.vertical: ScrollIndicator {}
+                        }
+                    }
+                    delegate: ItemDelegate {
+                        width: channelCombo.width
+                        highlighted: channelCombo.highlightedIndex === index
+                        background: Rectangle {
+                            color: highlighted ? controller.accentColor : (hovered ? "#2e2e2e" : "#1e1e1e")
+                        }
+                        contentItem: Text {
+                            text: modelData
+                            color: "white"
+                            font.pixelSize: 15
+                            verticalAlignment: Text.AlignVCenter
+                            leftPadding: 6
+                        }
+                    }
+                    onActivated: root.pendingChannels = root.channelChoices[currentIndex]
+                }
+            }
+
+            Button {
+                text: "Channel routing…"
+                visible: root.routeChannels >= 2
+                Layout.fillWidth: true; Layout.preferredHeight: 36
+                onClicked: root.showingRouting = true
+                background: Rectangle { color: "#333"; radius: 3; border.color: "#555" }
+                contentItem: Text {
+                    text: parent.text; color: "white"; font.pixelSize: 14
+                    horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Visual offset (ms):"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                SpinBox {
+                    id: uiOffsetSpin
+                    from: -250; to: 250; stepSize: 5
+                    editable: true
+                    Layout.preferredWidth: 140
+                    contentItem: TextInput {
+                        text: uiOffsetSpin.textFromValue(uiOffsetSpin.value, uiOffsetSpin.locale)
+                        color: "white"; horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter
+                        readOnly: !uiOffsetSpin.editable; validator: uiOffsetSpin.validator; inputMethodHints: Qt.ImhFormattedNumbersOnly
+                    }
+                    background: Rectangle { color: "#2a2a2a"; border.color: "#555"; radius: 3 }
+                    onValueModified: root.pendingUiOffset = value
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                Text { text: "Max voices:"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                SpinBox {
+                    id: maxVoicesSpin
+                    from: 1; to: 32
+                    editable: true
+                    Layout.preferredWidth: 140
+                    contentItem: TextInput {
+                        text: maxVoicesSpin.textFromValue(maxVoicesSpin.value, maxVoicesSpin.locale)
+                        color: "white"; horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter
+                        readOnly: !maxVoicesSpin.editable; validator: maxVoicesSpin.validator; inputMethodHints: Qt.ImhDigitsOnly
+                    }
+                    background: Rectangle { color: "#2a2a2a"; border.color: "#555"; radius: 3 }
+                    onValueModified: root.pendingMaxVoices = value
+                }
+            }
+
+            CheckBox {
+                id: inputAnalysisCheck
+                text: "Timing feedback (microphone)"
+                onCheckedChanged: root.pendingInputAnalysis = checked
+                contentItem: Text {
+                    text: parent.text; color: "white"; font.pixelSize: 15
+                    verticalAlignment: Text.AlignVCenter
+                    leftPadding: parent.indicator.width + parent.spacing
+                }
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                visible: root.pendingInputAnalysis
+                Text { text: "Input offset (ms):"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                SpinBox {
+                    id: inputOffsetSpin
+                    from: -250; to: 250; stepSize: 1
+                    editable: true
+                    Layout.preferredWidth: 140
+                    contentItem: TextInput {
+                        text: inputOffsetSpin.textFromValue(inputOffsetSpin.value, inputOffsetSpin.locale)
+                        color: "white"; horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter
+                        readOnly: !inputOffsetSpin.editable; validator: inputOffsetSpin.validator; inputMethodHints: Qt.ImhFormattedNumbersOnly
+                    }
+                    background: Rectangle { color: "#2a2a2a"; border.color: "#555"; radius: 3 }
+                    onValueModified: root.pendingInputOffset = value
+                }
+            }
+
+            CheckBox {
+                id: tempoAutoStartCheck
+                text: "Start on the downbeat after Listen"
+                onCheckedChanged: root.pendingTempoAutoStart = checked
+                contentItem: Text {
+                    text: parent.text; color: "white"; font.pixelSize: 15
+                    verticalAlignment: Text.AlignVCenter
+                    leftPadding: parent.indicator.width + parent.spacing
+                }
+            }
+
+            Text {
+                Layout.fillWidth: true
+                visible: controller.outputDeviceInfo !== ""
+                text: "Output latency " + controller.outputLatencyMs.toFixed(1) + " ms\n"
+                      + controller.outputDeviceInfo
+                color: "#a8a8a8"; font.pixelSize: 12; wrapMode: Text.Wrap
+            }
+
             Item { Layout.fillHeight: true }
 
             Button {
@@ -323,6 +642,16 @@ Drawer {
                         controller.applySettings(root.pendingSoundSet, root.pendingAccentColor,
                                                   root.pendingAlwaysOnTop, root.pendingBeatWindowAuto,
                                                   root.pendingTerminology)
+                        controller.perfHudVisible = root.pendingPerfHud
+                        controller.setOutputMode(root.pendingLowLatency, root.pendingPeriodFrames, root.pendingChannels)
+                        for (var r = 0; r < root.pendingRoutes.length; ++r)
+                            controller.setOutputRoute(r, root.pendingRoutes[r].dest, root.pendingRoutes[r].pan)
+                        controller.uiLatencyOffsetMs = root.pendingUiOffset
+                        controller.maxVoices = root.pendingMaxVoices
+                        controller.polySoundSet = root.pendingPolySoundSet
+                        controller.inputAnalysisEnabled = root.pendingInputAnalysis
+                        controller.inputLatencyOffsetMs = root.pendingInputOffset
+                        controller.tempoListenAutoStart = root.pendingTempoAutoStart
                         root.close()
                     }
                     background: Rectangle { color: controller.accentColor; radius: 3 }
@@ -331,6 +660,68 @@ Drawer {
             }
         }
 
+        // ── Output routing panel ─────────────────────────────────────────
+        ColumnLayout {
+            visible: root.showingRouting
+            Layout.fillWidth: true; Layout.fillHeight: true; Layout.margins: 12; spacing: 6
+
+            // One row per route; the rows read pendingRoutes rather than
+            // taking it as the model so editing a route does not rebuild them
+            Repeater {
+                model: controller.outputRoutes.length
+                delegate: ColumnLayout {
+                    id: routeRow
+                    required property int index
+                    readonly property var modelData: root.pendingRoutes[index]
+                    readonly property var dests: root.routeDests(root.routeChannels)
+                    Layout.fillWidth: true
+                    spacing: 2
+                    // The controls drop their bindings once used, so resync
+                    // them each time the panel is shown
+                    onVisibleChanged: if (visible) {
+                        routeCombo.currentIndex = Math.max(0, dests.indexOf(modelData.dest))
+                        panSlider.value = (modelData.pan + 1) / 2
+                    }
+
+                    RowLayout {
+                        Layout.fillWidth: true
+                        Text { text: routeRow.modelData.name + ":"; color: "white"; font.pixelSize: 15; Layout.fillWidth: true }
+                        SheetComboBox {
+                            id: routeCombo
+                            Layout.preferredWidth: 160
+                            model: routeRow.dests.map(root.routeDestName)
+                            currentIndex: Math.max(0, routeRow.dests.indexOf(routeRow.modelData.dest))
+                            onActivated: root.setPendingRoute(routeRow.index, routeRow.dests[currentIndex], routeRow.modelData.pan)
+                        }
+                    }
+                    RowLayout {
+                        Layout.fillWidth: true; spacing: 8
+                        visible: routeRow.modelData.dest.indexOf("+") >= 0
+                        Text { text: "Pan"; color: "#aaa"; font.pixelSize: 11; Layout.preferredWidth: 26 }
+                        ColorSlider {
+                            id: panSlider
+                            onMoved: (v) => root.setPendingRoute(routeRow.index, routeRow.modelData.dest, v * 2 - 1)
+                            trackGradient: Gradient {
+                                orientation: Gradient.Horizontal
+                                GradientStop { position: 0; color: "#555" }
+                                GradientStop { position: 0.5; color: "#888" }
+                                GradientStop { position: 1; color: "#555" }
+                            }
+                        }
+                    }
+                }
+            }
+
+            Item { Layout.fillHeight: true }
+
+            Button {
+                Layout.fillWidth: true; Layout.preferredHeight: 40
+                text: "Done"; onClicked: root.showingRouting = false
+                background: Rectangle { color: controller.accentColor; radius: 3 }
+                contentItem: Text { text: parent.text; color: "white"; font.pixelSize: 15; horizontalAlignment: Text.AlignHCenter; verticalAlignment: Text.AlignVCenter }
+            }
+        }
+
         // ── Color picker panel ───────────────────────────────────────────
         ColumnLayout {
             visible: root.showingColorPicker
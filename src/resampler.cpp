@@ -0,0 +1,101 @@
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Zeroth-order modified Bessel function of the first kind (power series).
+double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+        term *= q / (double(k) * double(k));
+        sum  += term;
+    }
+    return sum;
+}
+
+double sinc(double x)
+{
+    return std::fabs(x) < 1e-12 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+}
+
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler(int srcRate, int dstRate, const MixKernel& kernel)
+    : m_kernel(&kernel)
+{
+    srcRate = std::max(1, srcRate);
+    dstRate = std::max(1, dstRate);
+    const int g = std::gcd(srcRate, dstRate);
+    m_up   = dstRate / g;
+    m_down = srcRate / g;
+    m_exact  = m_up <= kMaxPhases;
+    m_phases = m_exact ? int(m_up) : kMaxPhases;
+
+    // Cutoff in units of the input Nyquist: below the output Nyquist when
+    // decimating, so nothing folds back into the audible band.
+    const double cutoff    = kPassband * std::min(1.0, double(dstRate) / double(srcRate));
+    const double halfWidth = kZeroCrossings / cutoff;   // in input samples
+    m_taps = (2 * int(std::ceil(halfWidth)) + 7) & ~7;
+    const double i0Beta = besselI0(kKaiserBeta);
+
+    m_bank.assign(size_t(m_phases) * size_t(m_taps), 0.0f);
+    for (int p = 0; p < m_phases; ++p) {
+        const double frac = double(p) / m_phases;
+        float* row = m_bank.data() + size_t(p) * m_taps;
+        double sum = 0.0;
+        for (int k = 0; k < m_taps; ++k) {
+            // Tap k reads input (base - taps/2 + 1 + k); d is its distance
+            // from the output position base + frac.
+            const double d = double(k - m_taps / 2 + 1) - frac;
+            const double x = d / halfWidth;
+            if (std::fabs(x) >= 1.0) continue;
+            const double w = besselI0(kKaiserBeta * std::sqrt(1.0 - x * x)) / i0Beta;
+            const double h = cutoff * sinc(cutoff * d) * w;
+            row[k] = float(h);
+            sum += h;
+        }
+        // Unity gain at DC for every phase.
+        if (sum != 0.0)
+            for (int k = 0; k < m_taps; ++k)
+                row[k] = float(row[k] / sum);
+    }
+}
+
+size_t PolyphaseResampler::outputLength(size_t inputLength) const
+{
+    return size_t((inputLength * m_up + m_down - 1) / m_down);
+}
+
+SampleVector PolyphaseResampler::process(const float* in, size_t n) const
+{
+    const size_t outLen = outputLength(n);
+    SampleVector out(outLen);
+    if (n == 0) return out;
+
+    // Zero padding on both sides keeps the inner loop free of bounds checks.
+    const size_t pad = size_t(m_taps);
+    SampleVector padded(n + 2 * pad, 0.0f);
+    std::copy(in, in + n, padded.begin() + pad);
+    const float* base0 = padded.data() + pad - size_t(m_taps / 2) + 1;
+
+    for (size_t i = 0; i < outLen; ++i) {
+        const unsigned long long num = (unsigned long long)i * (unsigned long long)m_down;
+        size_t base = size_t(num / (unsigned long long)m_up);
+        int phase;
+        if (m_exact) {
+            phase = int(num % (unsigned long long)m_up);
+        } else {
+            const double frac = double(num % (unsigned long long)m_up) / double(m_up);
+            phase = int(std::lround(frac * m_phases));
+            if (phase == m_phases) { phase = 0; ++base; }
+        }
+        out[i] = m_kernel->dot(m_bank.data() + size_t(phase) * m_taps, base0 + base, m_taps);
+    }
+    return out;
+}
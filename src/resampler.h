@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include "mixkernel.h"
+
+// ---------------------------------------------------------------------------
+// Windowed-sinc polyphase resampler for whole sample buffers.
+//
+// The rate ratio is reduced to up/down (44.1 kHz -> 48 kHz is 160/147).  A
+// Kaiser-windowed sinc with its cutoff just below the lower of the two
+// Nyquist frequencies is tabulated once per output phase; each output sample
+// is then a single dot product (MixKernel::dot) of one phase with the input
+// around its position.  Ratios with more than kMaxPhases phases round each
+// position to the nearest of kMaxPhases.
+// ---------------------------------------------------------------------------
+class PolyphaseResampler {
+public:
+    static constexpr int    kMaxPhases     = 512;
+    static constexpr int    kZeroCrossings = 64;     // sinc lobes per side at the cutoff
+    static constexpr double kPassband      = 0.91;   // cutoff / lower Nyquist
+    static constexpr double kKaiserBeta    = 9.0;    // about -90 dB stopband
+
+    PolyphaseResampler(int srcRate, int dstRate, const MixKernel& kernel = bestMixKernel());
+
+    size_t outputLength(size_t inputLength) const;
+    SampleVector process(const float* in, size_t n) const;
+
+    int taps() const   { return m_taps; }
+    int phases() const { return m_phases; }
+
+private:
+    long long m_up   = 1;
+    long long m_down = 1;
+    int  m_phases = 1;
+    bool m_exact  = true;    // m_phases == m_up: every position hits a phase exactly
+    int  m_taps   = 0;       // per phase, a multiple of 8
+    SampleVector m_bank;     // m_phases rows of m_taps coefficients
+    const MixKernel* m_kernel;
+};
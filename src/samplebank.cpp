@@ -0,0 +1,201 @@
+#include "samplebank.h"
+#include "audioengine.h"
+#include <QThread>
+
+namespace {
+// Frames a voice started on buf may keep reading it for.
+uint64_t lifetimeFrames(const PCMBuffer* buf)
+{
+    return uint64_t(double(buf->frames()) / VoicePool::kMinRateStep) + 1;
+}
+} // namespace
+
+SampleBank::SampleBank()
+{
+    for (int i = 0; i < kMaxSounds; ++i) {
+        m_slots[i].store(nullptr);
+        // Only the accent chokes itself by default, so a retrigger cuts its
+        // tail; other sounds opt in with setChokeGroup().
+        m_chokeGroups[i].store(i == kAccentSound ? kAccentSound + 1 : 0);
+    }
+    m_ids.insert(QStringLiteral("accent"), kAccentSound);
+    m_ids.insert(QStringLiteral("click"),  kClickSound);
+}
+
+SampleBank::~SampleBank()
+{
+    for (auto& slot : m_slots)
+        delete slot.load();
+    for (const Retired& r : m_retired)
+        delete r.buf;
+    for (PCMBuffer* buf : m_staged)
+        delete buf;
+}
+
+int SampleBank::idFor(const QString& name)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_ids.constFind(name);
+    if (it != m_ids.constEnd())
+        return it.value();
+    if (m_ids.size() >= kMaxSounds)
+        return -1;
+    int id = int(m_ids.size());
+    m_ids.insert(name, id);
+    return id;
+}
+
+int SampleBank::find(const QString& name) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_ids.value(name, -1);
+}
+
+QString SampleBank::nameOf(int id) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_ids.key(id);
+}
+
+void SampleBank::install(int id, PCMBuffer* buf)
+{
+    if (unsigned(id) >= unsigned(kMaxSounds)) {
+        delete buf;
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    PCMBuffer* old = m_slots[id].exchange(buf, std::memory_order_acq_rel);
+    uint64_t gen = m_generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (old)
+        m_retired.push_back({old, gen, 0});
+}
+
+void SampleBank::setChokeGroup(int id, int group)
+{
+    if (unsigned(id) < unsigned(kMaxSounds))
+        m_chokeGroups[id].store(group, std::memory_order_relaxed);
+}
+
+std::vector<int> SampleBank::loadedIds() const
+{
+    std::vector<int> ids;
+    for (int i = 0; i < kMaxSounds; ++i)
+        if (m_slots[i].load(std::memory_order_acquire))
+            ids.push_back(i);
+    return ids;
+}
+
+void SampleBank::reclaim(bool audioIdle)
+{
+    QMutexLocker lock(&m_mutex);
+    retireCommittedLocked();
+    const uint64_t acked    = m_ackGeneration.load(std::memory_order_acquire);
+    const uint64_t rendered = m_renderedFrames.load(std::memory_order_acquire);
+
+    auto it = m_retired.begin();
+    while (it != m_retired.end()) {
+        if (!audioIdle && it->freeAtFrame == 0 && acked >= it->generation) {
+            // Callbacks from here on see the new buffer.  Voices started
+            // earlier read at most the whole old buffer, at the slowest step.
+            it->freeAtFrame = rendered + lifetimeFrames(it->buf);
+        }
+        if (audioIdle || (it->freeAtFrame != 0 && rendered >= it->freeAtFrame)) {
+            delete it->buf;
+            it = m_retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int SampleBank::retiredCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return int(m_retired.size());
+}
+
+void SampleBank::stage(int id, PCMBuffer* buf)
+{
+    QMutexLocker lock(&m_mutex);
+    retireCommittedLocked();
+    if (unsigned(id) >= unsigned(kMaxSounds) || m_stageState.load(std::memory_order_acquire) != kStageOpen) {
+        delete buf;
+        return;
+    }
+    delete m_staged[id];
+    m_staged[id] = buf;
+}
+
+void SampleBank::publishStaged()
+{
+    QMutexLocker lock(&m_mutex);
+    int expected = kStageOpen;
+    m_stageState.compare_exchange_strong(expected, kStagePublished, std::memory_order_acq_rel);
+}
+
+bool SampleBank::hasStaged() const
+{
+    return m_stageState.load(std::memory_order_acquire) == kStagePublished;
+}
+
+void SampleBank::cancelStaged()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!withdrawLocked())
+        return;   // too late: the audio thread took it
+    for (PCMBuffer*& buf : m_staged) {
+        delete buf;
+        buf = nullptr;
+    }
+}
+
+void SampleBank::installStaged()
+{
+    PCMBuffer* staged[kMaxSounds];
+    {
+        QMutexLocker lock(&m_mutex);
+        withdrawLocked();   // if the audio thread took it, m_staged is empty now
+        for (int i = 0; i < kMaxSounds; ++i) {
+            staged[i] = m_staged[i];
+            m_staged[i] = nullptr;
+        }
+    }
+    for (int i = 0; i < kMaxSounds; ++i)
+        if (staged[i])
+            install(i, staged[i]);
+}
+
+// m_mutex held.  Takes a published set back so the GUI side owns m_staged
+// again.  False if the audio thread claimed it first; once its commit is
+// done the buffers it replaced are retired.
+bool SampleBank::withdrawLocked()
+{
+    int state = kStagePublished;
+    if (m_stageState.compare_exchange_strong(state, kStageOpen, std::memory_order_acq_rel))
+        return true;
+    // commitStaged() is a handful of pointer swaps; wait them out.
+    while (state == kStageCommitting) {
+        QThread::yieldCurrentThread();
+        state = m_stageState.load(std::memory_order_acquire);
+    }
+    if (state == kStageCommitted) {
+        retireCommittedLocked();
+        return false;
+    }
+    return true;
+}
+
+// m_mutex held.  After a commit, m_staged holds what the audio thread
+// replaced; it has seen the swap, so the lifetime clock starts now.
+void SampleBank::retireCommittedLocked()
+{
+    if (m_stageState.load(std::memory_order_acquire) != kStageCommitted)
+        return;
+    const uint64_t rendered = m_renderedFrames.load(std::memory_order_acquire);
+    for (PCMBuffer*& buf : m_staged) {
+        if (buf)
+            m_retired.push_back({buf, 0, rendered + lifetimeFrames(buf)});
+        buf = nullptr;
+    }
+    m_stageState.store(kStageOpen, std::memory_order_release);
+}
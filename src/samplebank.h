@@ -0,0 +1,127 @@
+#pragma once
+
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+struct PCMBuffer;
+
+// ---------------------------------------------------------------------------
+// SampleBank: loaded sounds addressed by small integer IDs.
+//
+// Names are mapped to IDs once, on the GUI side; the audio thread only ever
+// does get(id), a single atomic load from a fixed array.  Installing a new
+// buffer for an ID swaps the pointer and retires the old buffer.  A retired
+// buffer is freed by reclaim() once the audio thread has acknowledged the
+// swap and any voice that might still be reading it has run out, so voices
+// never see their sample data disappear underneath them.
+//
+// A set of buffers can also be staged and handed to the audio thread, which
+// swaps all of them in at once with commitStaged() at a point of its choosing
+// (the engine uses the next bar line), so a reload never changes sounds in
+// the middle of a bar.
+//
+// IDs 0 and 1 are reserved for "accent" and "click" so default routing needs
+// no lookup.
+// ---------------------------------------------------------------------------
+class SampleBank {
+public:
+    static constexpr int kMaxSounds   = 32;
+    static constexpr int kAccentSound = 0;
+    static constexpr int kClickSound  = 1;
+
+    SampleBank();
+    ~SampleBank();
+    SampleBank(const SampleBank&) = delete;
+    SampleBank& operator=(const SampleBank&) = delete;
+
+    // ── GUI thread ────────────────────────────────────────────────────────
+    int     idFor(const QString& name);        // allocates on first use; -1 if the bank is full
+    int     find(const QString& name) const;   // -1 if unknown
+    QString nameOf(int id) const;
+
+    // Publish buf for id; the previous buffer (if any) is retired.
+    void install(int id, PCMBuffer* buf);
+    void setChokeGroup(int id, int group);
+
+    // IDs that currently have a buffer installed.
+    std::vector<int> loadedIds() const;
+
+    // Free retired buffers that can no longer be playing.  With audioIdle
+    // (device stopped, voices cleared) everything retired is freed at once.
+    void reclaim(bool audioIdle = false);
+    int  retiredCount() const;
+
+    // Staged replacement set.  stage() takes ownership; publishStaged()
+    // offers the set to the audio thread.  cancelStaged() frees a set the
+    // audio thread has not taken, and installStaged() installs it directly
+    // (for when no callback is running).  Either one that finds the set
+    // already taken only retires what it replaced.
+    void stage(int id, PCMBuffer* buf);
+    void publishStaged();
+    bool hasStaged() const;
+    void cancelStaged();
+    void installStaged();
+
+    // ── Audio thread ──────────────────────────────────────────────────────
+    // Once per callback, before any get(): acknowledges installed buffers and
+    // advances the clock used to age retired ones.
+    void beginCallback(int frames) {
+        m_ackGeneration.store(m_generation.load(std::memory_order_acquire), std::memory_order_release);
+        m_renderedFrames.fetch_add(uint64_t(frames), std::memory_order_release);
+    }
+
+    // Swap in a published set, if there is one.  Lock-free; the replaced
+    // buffers are retired by the next reclaim().  The set is claimed first,
+    // so the GUI side cannot withdraw it while it is being swapped in.
+    bool commitStaged() noexcept {
+        if (m_stageState.load(std::memory_order_relaxed) != kStagePublished) return false;
+        int expected = kStagePublished;
+        if (!m_stageState.compare_exchange_strong(expected, kStageCommitting, std::memory_order_acq_rel))
+            return false;
+        for (int i = 0; i < kMaxSounds; ++i)
+            if (m_staged[i])
+                m_staged[i] = m_slots[i].exchange(m_staged[i], std::memory_order_acq_rel);
+        m_stageState.store(kStageCommitted, std::memory_order_release);
+        return true;
+    }
+
+    const PCMBuffer* get(int id) const {
+        if (unsigned(id) >= unsigned(kMaxSounds)) return nullptr;
+        return m_slots[id].load(std::memory_order_acquire);
+    }
+    int chokeGroup(int id) const {
+        if (unsigned(id) >= unsigned(kMaxSounds)) return 0;
+        return m_chokeGroups[id].load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Retired {
+        PCMBuffer* buf;
+        uint64_t   generation;     // generation that replaced it
+        uint64_t   freeAtFrame;    // 0 until the audio thread has acknowledged the swap
+    };
+
+    std::atomic<PCMBuffer*> m_slots[kMaxSounds];
+    std::atomic<int>        m_chokeGroups[kMaxSounds];
+
+    // Open: the GUI side owns m_staged.  Published: the audio thread may
+    // claim it.  Committing: the audio thread owns m_staged and is swapping.
+    // Committed: m_staged holds the replaced buffers, to be retired.
+    enum StageState { kStageOpen, kStagePublished, kStageCommitting, kStageCommitted };
+    PCMBuffer*       m_staged[kMaxSounds] = {};
+    std::atomic<int> m_stageState{kStageOpen};
+    void retireCommittedLocked();
+    bool withdrawLocked();
+
+    std::atomic<uint64_t> m_generation{0};      // bumped by install()
+    std::atomic<uint64_t> m_ackGeneration{0};   // last generation seen by the audio thread
+    std::atomic<uint64_t> m_renderedFrames{0};  // frames rendered since construction
+
+    mutable QMutex       m_mutex;   // names and the retired list; never taken by the audio thread
+    QMap<QString, int>   m_ids;
+    std::vector<Retired> m_retired;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// ---------------------------------------------------------------------------
+// The built-in sound sets, in the order Settings lists them, with the accent
+// and click each one loads.  MetronomeController exposes the names to QML
+// (soundSets) and resolves them (soundFileForSet).
+// ---------------------------------------------------------------------------
+struct SoundSet {
+    const char* name;
+    const char* accent;
+    const char* click;
+};
+
+inline constexpr SoundSet kSoundSets[] = {
+    { "Default",  ":/resources/accent.wav",           ":/resources/click.wav" },
+    { "Bongo",    ":/resources/bongo_accent.wav",     ":/resources/bongo.wav" },
+    { "Cowbell",  ":/resources/cowbell_accent.wav",   ":/resources/cowbell.wav" },
+    { "Digital",  ":/resources/digital_accent.wav",   ":/resources/digital.wav" },
+    { "Drum",     ":/resources/drum_accent.wav",      ":/resources/drum.wav" },
+    { "Hihat",    ":/resources/hihat_accent.wav",     ":/resources/hihat.wav" },
+    { "Metal",    ":/resources/metal_accent.wav",     ":/resources/metal.wav" },
+    { "Wooden",   ":/resources/woodblock_accent.wav", ":/resources/woodblock.wav" },
+    { "Wooden 2", ":/resources/wooden_accent.wav",    ":/resources/wooden.wav" },
+    { "Wooden 3", ":/resources/wooden2_accent.wav",   ":/resources/wooden2.wav" },
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// SpscRing: fixed-capacity single-producer / single-consumer FIFO.
+//
+// Storage is allocated once in the constructor; push() and pop() never
+// allocate or block, so the producer side is safe to call from the audio
+// thread.  Capacity is rounded up to a power of two.  A push into a full ring
+// is dropped and counted in overflowCount() instead of overwriting data the
+// consumer may be reading.
+// ---------------------------------------------------------------------------
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t minCapacity)
+    {
+        size_t cap = 2;
+        while (cap < minCapacity) cap <<= 1;
+        m_slots.resize(cap);
+        m_mask = cap - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return m_slots.size(); }
+
+    // ── Producer side ─────────────────────────────────────────────────────
+    bool push(const T& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_slots.size()) {
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t freeSpace() const {
+        return m_slots.size() - (m_tail.load(std::memory_order_relaxed) -
+                                 m_head.load(std::memory_order_acquire));
+    }
+
+    // ── Consumer side ─────────────────────────────────────────────────────
+    bool pop(T& out) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        out = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Oldest element, or nullptr when empty.  Valid until the next pop().
+    const T* front() const {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_slots[head & m_mask];
+    }
+
+    void discardFront() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Drop everything currently queued (consumer side).
+    void clear() {
+        m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // ── Either side (approximate while the other side is active) ──────────
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+    uint64_t overflowCount() const { return m_overflows.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head{0};   // consumer-owned
+    alignas(64) std::atomic<size_t> m_tail{0};   // producer-owned
+    std::atomic<uint64_t> m_overflows{0};
+};
@@ -1,70 +1,8 @@
 #include "subdivisionpattern.h"
+#include <algorithm>
 #include <cmath>
 #include <QMap>
 
-// ---------------------------------------------------------------------------
-// NoteValue lookup table
-// ---------------------------------------------------------------------------
-NoteValueInfo getNoteValueInfo(NoteValue nv) {
-    // { noteType,                          dotted,  tuplet, wholeNoteFraction, beatDivisor }
-    switch (nv) {
-    case NoteValue::Whole:            return { AssembledNoteType::Whole,        false, 0,  1.0,        0 };
-    case NoteValue::Half:             return { AssembledNoteType::Half,         false, 0,  0.5,        0 };
-    case NoteValue::DottedHalf:       return { AssembledNoteType::Half,         true,  0,  0.75,       0 };
-    case NoteValue::Quarter:          return { AssembledNoteType::Quarter,      false, 0,  0.25,       0 };
-    case NoteValue::DottedQuarter:    return { AssembledNoteType::Quarter,      true,  0,  0.375,      0 };
-    case NoteValue::Eighth:           return { AssembledNoteType::Eighth,       false, 0,  0.125,      0 };
-    case NoteValue::DottedEighth:     return { AssembledNoteType::Eighth,       true,  0,  0.1875,     0 };
-    case NoteValue::Sixteenth:        return { AssembledNoteType::Sixteenth,    false, 0,  0.0625,     0 };
-    case NoteValue::DottedSixteenth:  return { AssembledNoteType::Sixteenth,    true,  0,  0.09375,    0 };
-    case NoteValue::ThirtySecond:     return { AssembledNoteType::ThirtySecond, false, 0,  0.03125,    0 };
-    case NoteValue::SixtyFourth:      return { AssembledNoteType::SixtyFourth,  false, 0,  0.015625,   0 };
-    case NoteValue::TripletQuarter:   return { AssembledNoteType::Quarter,      false, 3,  1.0/6.0,    0 };
-    case NoteValue::TripletEighth:    return { AssembledNoteType::Eighth,       false, 3,  1.0/12.0,   0 };
-    case NoteValue::TripletSixteenth: return { AssembledNoteType::Sixteenth,    false, 3,  1.0/24.0,   0 };
-    case NoteValue::QuintupletNote:   return { AssembledNoteType::Sixteenth,    false, 5,  -1.0,       5 };
-    case NoteValue::SeptupletNote:    return { AssembledNoteType::Sixteenth,    false, 7,  -1.0,       7 };
-    case NoteValue::DupletNote:       return { AssembledNoteType::Quarter,      false, 2,  -1.0,       2 };
-    case NoteValue::QuartupletNote:   return { AssembledNoteType::Sixteenth,    false, 4,  -1.0,       4 };
-    // ── Expanded tuplets ────────────────────────────────────────────────────
-    case NoteValue::DupletQuarter:       return { AssembledNoteType::Quarter,      false, 2, -1.0, 2 };
-    case NoteValue::DupletEighth:        return { AssembledNoteType::Eighth,       false, 2, -1.0, 2 };
-    case NoteValue::DupletSixteenth:     return { AssembledNoteType::Sixteenth,    false, 2, -1.0, 2 };
-    case NoteValue::TripletThirtySecond: return { AssembledNoteType::ThirtySecond, false, 3, -1.0, 3 };
-    case NoteValue::QuadrupletQuarter:   return { AssembledNoteType::Quarter,      false, 4, -1.0, 4 };
-    case NoteValue::QuadrupletEighth:    return { AssembledNoteType::Eighth,       false, 4, -1.0, 4 };
-    case NoteValue::QuadrupletSixteenth: return { AssembledNoteType::Sixteenth,    false, 4, -1.0, 4 };
-    case NoteValue::QuintupletQuarter:   return { AssembledNoteType::Quarter,      false, 5, -1.0, 5 };
-    case NoteValue::QuintupletEighth:    return { AssembledNoteType::Eighth,       false, 5, -1.0, 5 };
-    case NoteValue::QuintupletSixteenth: return { AssembledNoteType::Sixteenth,    false, 5, -1.0, 5 };
-    case NoteValue::SextupletQuarter:    return { AssembledNoteType::Quarter,      false, 6, -1.0, 6 };
-    case NoteValue::SextupletEighth:     return { AssembledNoteType::Eighth,       false, 6, -1.0, 6 };
-    case NoteValue::SextupletSixteenth:  return { AssembledNoteType::Sixteenth,    false, 6, -1.0, 6 };
-    case NoteValue::SeptupletQuarter:    return { AssembledNoteType::Quarter,      false, 7, -1.0, 7 };
-    case NoteValue::SeptupletEighth:     return { AssembledNoteType::Eighth,       false, 7, -1.0, 7 };
-    case NoteValue::SeptupletSixteenth:  return { AssembledNoteType::Sixteenth,    false, 7, -1.0, 7 };
-    case NoteValue::OctupletEighth:      return { AssembledNoteType::Eighth,       false, 8, -1.0, 8 };
-    case NoteValue::OctupletSixteenth:   return { AssembledNoteType::Sixteenth,    false, 8, -1.0, 8 };
-    case NoteValue::NonupletEighth:      return { AssembledNoteType::Eighth,       false, 9, -1.0, 9 };
-    case NoteValue::NonupletSixteenth:   return { AssembledNoteType::Sixteenth,    false, 9, -1.0, 9 };
-    }
-    return { AssembledNoteType::Quarter, false, 0, 0.25, 0 }; // fallback
-}
-
-// ---------------------------------------------------------------------------
-// Beat-fraction conversion
-// ---------------------------------------------------------------------------
-double noteValueBeatFraction(NoteValue nv, bool compoundTime) {
-    NoteValueInfo info = getNoteValueInfo(nv);
-    if (info.beatDivisor > 0) {
-        // Beat-relative tuplet: exactly 1/N of one beat
-        return 1.0 / info.beatDivisor;
-    }
-    // Absolute: convert whole-note fraction to beat fraction
-    double beatWhole = compoundTime ? (3.0 / 8.0) : (1.0 / 4.0);
-    return info.wholeNoteFraction / beatWhole;
-}
-
 // ---------------------------------------------------------------------------
 // Legacy migration helper
 // ---------------------------------------------------------------------------
@@ -330,3 +268,43 @@ NoteValue resolveTupletNoteValue(NoteValue base, int tupletN) {
     }
     return base; // unsupported combination → return plain base
 }
+
+Fraction patternBeats(const SubdivisionPattern& pattern, bool compoundTime) {
+    Fraction total;
+    for (const SubdivisionPulse& pulse : pattern.pulses)
+        total += noteValueBeats(pulse.noteValue, compoundTime);
+    return total;
+}
+
+bool isStandardPattern(const SubdivisionPattern& pattern, bool compoundTime) {
+    return pattern.category != SubdivisionCategory::Custom &&
+           patternBeats(pattern, compoundTime) == Fraction(1);
+}
+
+int polyrhythmColumns(int main, int poly) {
+    if (main <= 0 || poly <= 0) return 0;
+    return main / std::gcd(main, poly) * poly;
+}
+
+std::vector<PolyrhythmHit> polyrhythmHits(int main, int poly) {
+    std::vector<PolyrhythmHit> hits;
+    const int columns = polyrhythmColumns(main, poly);
+    if (columns == 0) return hits;
+
+    // Both layers are arithmetic sequences on the grid; walk them together.
+    const int mainStep = columns / main;
+    const int polyStep = columns / poly;
+    hits.reserve(size_t(main + poly - std::gcd(main, poly)));
+    int m = 0, p = 0;
+    while (m < columns || p < columns) {
+        const int col = std::min(m, p);
+        PolyrhythmHit hit;
+        hit.column = col;
+        hit.isMain = (m == col);
+        hit.isPoly = (p == col);
+        if (hit.isMain) m += mainStep;
+        if (hit.isPoly) p += polyStep;
+        hits.push_back(hit);
+    }
+    return hits;
+}
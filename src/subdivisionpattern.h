@@ -2,6 +2,10 @@
 
 #include <QString>
 #include <QVector>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <vector>
 #include "noteassembler.h" // for AssembledNoteType and NoteAssemblerConfig
 
 // ---------------------------------------------------------------------------
@@ -59,26 +63,146 @@ enum class NoteValue {
     NonupletEighth,     NonupletSixteenth,
 };
 
+// ---------------------------------------------------------------------------
+// Fraction: an exact rational duration, kept reduced with den > 0.
+// ---------------------------------------------------------------------------
+struct Fraction {
+    int64_t num = 0;
+    int64_t den = 1;
+
+    constexpr Fraction() = default;
+    constexpr Fraction(int64_t n, int64_t d = 1) : num(n), den(d) {
+        if (den < 0) { num = -num; den = -den; }
+        const int64_t g = std::gcd(num, den);
+        if (g > 1) { num /= g; den /= g; }
+    }
+
+    constexpr bool   isInteger() const { return den == 1; }
+    constexpr double toDouble() const  { return double(num) / double(den); }
+
+    constexpr Fraction& operator+=(Fraction o) { return *this = *this + o; }
+    friend constexpr Fraction operator+(Fraction a, Fraction b) { return {a.num * b.den + b.num * a.den, a.den * b.den}; }
+    friend constexpr Fraction operator*(Fraction a, Fraction b) { return {a.num * b.num, a.den * b.den}; }
+    friend constexpr Fraction operator/(Fraction a, Fraction b) { return {a.num * b.den, a.den * b.num}; }
+    friend constexpr bool operator==(Fraction a, Fraction b) { return a.num == b.num && a.den == b.den; }
+    friend constexpr bool operator!=(Fraction a, Fraction b) { return !(a == b); }
+    friend constexpr bool operator<(Fraction a, Fraction b)  { return a.num * b.den < b.num * a.den; }
+};
+
 // ---------------------------------------------------------------------------
 // Per-NoteValue rendering + duration metadata (returned by getNoteValueInfo)
 // ---------------------------------------------------------------------------
 struct NoteValueInfo {
+    NoteValue         value;
     AssembledNoteType noteType;  // glyph to render  (dotted notes use their base glyph + dot)
     bool              dotted;    // draw augmentation dot
     int               tupletNumber; // 0 = no marker; 3 = triplet; 5 = quint; 7 = sept
-    double            wholeNoteFraction; // absolute duration as fraction of a whole note
-                                         // < 0  ⟹  beat-relative (use beatDivisor)
-    int               beatDivisor;       // if wholeNoteFraction < 0:  duration = 1/beatDivisor beat
-                                         // else 0
+    Fraction          wholeNote;    // absolute duration in whole notes; 0 ⟹ beat-relative
+    int               beatDivisor;  // if beat-relative: duration = 1/beatDivisor beat, else 0
+};
+
+// One row per NoteValue, in enum order (checked below).
+inline constexpr NoteValueInfo kNoteValueInfo[] = {
+    // { value,                          noteType,                     dotted, tuplet, wholeNote, beatDivisor }
+    { NoteValue::Whole,               AssembledNoteType::Whole,        false, 0, {1, 1},  0 },
+    { NoteValue::Half,                AssembledNoteType::Half,         false, 0, {1, 2},  0 },
+    { NoteValue::DottedHalf,          AssembledNoteType::Half,         true,  0, {3, 4},  0 },
+    { NoteValue::Quarter,             AssembledNoteType::Quarter,      false, 0, {1, 4},  0 },
+    { NoteValue::DottedQuarter,       AssembledNoteType::Quarter,      true,  0, {3, 8},  0 },
+    { NoteValue::Eighth,              AssembledNoteType::Eighth,       false, 0, {1, 8},  0 },
+    { NoteValue::DottedEighth,        AssembledNoteType::Eighth,       true,  0, {3, 16}, 0 },
+    { NoteValue::Sixteenth,           AssembledNoteType::Sixteenth,    false, 0, {1, 16}, 0 },
+    { NoteValue::DottedSixteenth,     AssembledNoteType::Sixteenth,    true,  0, {3, 32}, 0 },
+    { NoteValue::ThirtySecond,        AssembledNoteType::ThirtySecond, false, 0, {1, 32}, 0 },
+    { NoteValue::SixtyFourth,         AssembledNoteType::SixtyFourth,  false, 0, {1, 64}, 0 },
+    { NoteValue::TripletQuarter,      AssembledNoteType::Quarter,      false, 3, {1, 6},  0 },
+    { NoteValue::TripletEighth,       AssembledNoteType::Eighth,       false, 3, {1, 12}, 0 },
+    { NoteValue::TripletSixteenth,    AssembledNoteType::Sixteenth,    false, 3, {1, 24}, 0 },
+    { NoteValue::QuintupletNote,      AssembledNoteType::Sixteenth,    false, 5, {},      5 },
+    { NoteValue::SeptupletNote,       AssembledNoteType::Sixteenth,    false, 7, {},      7 },
+    { NoteValue::DupletNote,          AssembledNoteType::Quarter,      false, 2, {},      2 },
+    { NoteValue::QuartupletNote,      AssembledNoteType::Sixteenth,    false, 4, {},      4 },
+    // ── Expanded tuplets ────────────────────────────────────────────────────
+    { NoteValue::DupletQuarter,       AssembledNoteType::Quarter,      false, 2, {},      2 },
+    { NoteValue::DupletEighth,        AssembledNoteType::Eighth,       false, 2, {},      2 },
+    { NoteValue::DupletSixteenth,     AssembledNoteType::Sixteenth,    false, 2, {},      2 },
+    { NoteValue::TripletThirtySecond, AssembledNoteType::ThirtySecond, false, 3, {},      3 },
+    { NoteValue::QuadrupletQuarter,   AssembledNoteType::Quarter,      false, 4, {},      4 },
+    { NoteValue::QuadrupletEighth,    AssembledNoteType::Eighth,       false, 4, {},      4 },
+    { NoteValue::QuadrupletSixteenth, AssembledNoteType::Sixteenth,    false, 4, {},      4 },
+    { NoteValue::QuintupletQuarter,   AssembledNoteType::Quarter,      false, 5, {},      5 },
+    { NoteValue::QuintupletEighth,    AssembledNoteType::Eighth,       false, 5, {},      5 },
+    { NoteValue::QuintupletSixteenth, AssembledNoteType::Sixteenth,    false, 5, {},      5 },
+    { NoteValue::SextupletQuarter,    AssembledNoteType::Quarter,      false, 6, {},      6 },
+    { NoteValue::SextupletEighth,     AssembledNoteType::Eighth,       false, 6, {},      6 },
+    { NoteValue::SextupletSixteenth,  AssembledNoteType::Sixteenth,    false, 6, {},      6 },
+    { NoteValue::SeptupletQuarter,    AssembledNoteType::Quarter,      false, 7, {},      7 },
+    { NoteValue::SeptupletEighth,     AssembledNoteType::Eighth,       false, 7, {},      7 },
+    { NoteValue::SeptupletSixteenth,  AssembledNoteType::Sixteenth,    false, 7, {},      7 },
+    { NoteValue::OctupletEighth,      AssembledNoteType::Eighth,       false, 8, {},      8 },
+    { NoteValue::OctupletSixteenth,   AssembledNoteType::Sixteenth,    false, 8, {},      8 },
+    { NoteValue::NonupletEighth,      AssembledNoteType::Eighth,       false, 9, {},      9 },
+    { NoteValue::NonupletSixteenth,   AssembledNoteType::Sixteenth,    false, 9, {},      9 },
 };
 
 // Return metadata for any NoteValue
-NoteValueInfo getNoteValueInfo(NoteValue nv);
+constexpr const NoteValueInfo& getNoteValueInfo(NoteValue nv) {
+    const size_t i = size_t(nv);
+    return kNoteValueInfo[i < std::size(kNoteValueInfo) ? i : size_t(NoteValue::Quarter)];
+}
 
-// Return fraction of ONE beat this NoteValue occupies.
+// Exact length of a NoteValue in beats.
 //   compoundTime = true  → beat = dotted quarter (3/8 of whole)
 //   compoundTime = false → beat = quarter        (1/4 of whole)
-double noteValueBeatFraction(NoteValue nv, bool compoundTime);
+constexpr Fraction noteValueBeats(NoteValue nv, bool compoundTime) {
+    const NoteValueInfo& info = getNoteValueInfo(nv);
+    if (info.beatDivisor > 0)
+        return Fraction(1, info.beatDivisor);
+    return info.wholeNote / (compoundTime ? Fraction(3, 8) : Fraction(1, 4));
+}
+
+// Beat ticks: kBeatTicks per beat is a whole number of ticks for every
+// NoteValue in simple and compound time, so schedules can add durations as
+// integers.
+constexpr int64_t kBeatTicks = 5040;
+
+constexpr int64_t noteValueTicks(NoteValue nv, bool compoundTime) {
+    const Fraction beats = noteValueBeats(nv, compoundTime);
+    return beats.num * (kBeatTicks / beats.den);
+}
+
+// Return fraction of ONE beat this NoteValue occupies (see noteValueBeats).
+inline double noteValueBeatFraction(NoteValue nv, bool compoundTime) {
+    return noteValueBeats(nv, compoundTime).toDouble();
+}
+
+namespace detail {
+constexpr bool noteValueTableIsValid() {
+    for (size_t i = 0; i < std::size(kNoteValueInfo); ++i) {
+        const NoteValueInfo& e = kNoteValueInfo[i];
+        if (e.value != NoteValue(i))
+            return false;
+        if ((e.beatDivisor > 0) == (e.wholeNote.num > 0))   // exactly one kind of duration
+            return false;
+        for (int compound = 0; compound < 2; ++compound)
+            if (kBeatTicks % noteValueBeats(e.value, compound != 0).den != 0)
+                return false;
+    }
+    return true;
+}
+} // namespace detail
+
+static_assert(std::size(kNoteValueInfo) == size_t(NoteValue::NonupletSixteenth) + 1,
+              "kNoteValueInfo needs one row per NoteValue");
+static_assert(detail::noteValueTableIsValid(),
+              "kNoteValueInfo rows must be in enum order, with one duration that fits the tick grid");
+static_assert(noteValueBeats(NoteValue::Quarter, false) == Fraction(1), "quarter = simple beat");
+static_assert(noteValueBeats(NoteValue::DottedQuarter, true) == Fraction(1), "dotted quarter = compound beat");
+static_assert(noteValueBeats(NoteValue::TripletEighth, false) == Fraction(1, 3), "triplet eighth");
+static_assert(noteValueBeats(NoteValue::TripletSixteenth, true) == Fraction(1, 9), "compound triplet sixteenth");
+static_assert(noteValueBeats(NoteValue::DottedSixteenth, false) == Fraction(3, 8), "dotted sixteenth");
+static_assert(noteValueBeats(NoteValue::SeptupletSixteenth, true) == Fraction(1, 7), "beat-relative tuplet");
+static_assert(noteValueTicks(NoteValue::SixtyFourth, true) == kBeatTicks / 24, "compound sixty-fourth");
 
 // Infer NoteValue from the legacy float-based format (used only when migrating
 // old presets/custom patterns that predate this system).
@@ -124,4 +248,29 @@ struct SubdivisionPattern {
 // This is THE single authoritative rendering function – replaces all three
 // copies of configForPattern() that existed previously.
 // ---------------------------------------------------------------------------
-NoteAssemblerConfig buildNoteAssemblerConfig(const SubdivisionPattern& pattern);
\ No newline at end of file
+NoteAssemblerConfig buildNoteAssemblerConfig(const SubdivisionPattern& pattern);
+
+// ---------------------------------------------------------------------------
+// Exact pattern timing, for the schedulers.
+// ---------------------------------------------------------------------------
+// Beats taken by one pass of the pattern.
+Fraction patternBeats(const SubdivisionPattern& pattern, bool compoundTime);
+// A standard pattern fills exactly one beat and repeats on every beat; any
+// other length, and every Custom pattern, defines its own bar.
+bool isStandardPattern(const SubdivisionPattern& pattern, bool compoundTime);
+
+// ---------------------------------------------------------------------------
+// Polyrhythm grid: main beats against poly beats on a shared grid of
+// lcm(main, poly) columns, so every onset of either layer lands on a column.
+// ---------------------------------------------------------------------------
+struct PolyrhythmHit {
+    int  column = 0;
+    bool isMain = false;
+    bool isPoly = false;
+};
+
+// lcm(main, poly); 0 when either is not positive.
+int polyrhythmColumns(int main, int poly);
+// Onsets of both layers in column order, coincident ones merged into one hit.
+// A single integer merge, linear in main + poly.
+std::vector<PolyrhythmHit> polyrhythmHits(int main, int poly);
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "tempodetector.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Levels below this are silence as far as the envelope is concerned.
+constexpr float kFloorDb = -60.0f;
+
+// Width of the tempo preference, in octaves.
+constexpr double kPreferenceOctaves = 1.0;
+
+// The comb refines the autocorrelation's period over +-2 % in 0.1 % steps.
+constexpr int    kRefineSteps = 20;
+constexpr double kRefineStep  = 0.001;
+
+} // namespace
+
+TempoDetector::TempoDetector(int hopFrames, int sampleRate, const MixKernel& kernel)
+    : m_kernel(&kernel)
+    , m_hopFrames(std::max(1, hopFrames))
+    , m_sampleRate(std::max(1, sampleRate))
+{
+    m_hopRate    = double(m_sampleRate) / m_hopFrames;
+    m_window     = int(kWindowSeconds * m_hopRate);
+    m_updateHops = std::max(1, int(kUpdateSeconds * m_hopRate));
+    m_minLag     = std::max(2, int(std::floor(60.0 / kMaxBpm * m_hopRate)));
+    m_maxLag     = int(std::ceil(60.0 / kMinBpm * m_hopRate));
+    m_envelope.reserve(size_t(2 * m_window));
+    m_centered.resize(size_t(m_window));
+    m_acf.resize(size_t(2 * m_maxLag + 2));
+}
+
+void TempoDetector::reset()
+{
+    m_envelope.clear();
+    m_nextPos     = -1;
+    m_lastDb      = kFloorDb;
+    m_sinceUpdate = 0;
+    m_history.clear();
+    m_estimate = TempoEstimate();
+}
+
+bool TempoDetector::addHop(int64_t samplePos, float levelDb)
+{
+    const bool restart = samplePos != m_nextPos;
+    if (restart)
+        reset();
+    m_nextPos = samplePos + m_hopFrames;
+
+    const float level = std::max(levelDb, kFloorDb);
+    m_envelope.push_back(restart ? 0.0f : std::max(0.0f, level - m_lastDb));
+    m_lastDb = level;
+    if (int(m_envelope.size()) >= 2 * m_window)
+        m_envelope.erase(m_envelope.begin(), m_envelope.end() - m_window);
+
+    if (++m_sinceUpdate < m_updateHops || int(m_envelope.size()) < int(kFirstSeconds * m_hopRate))
+        return false;
+    m_sinceUpdate = 0;
+    update();
+    return true;
+}
+
+// The envelope summed within `spread` hops of last, last - step,
+// last - 2 step, ...
+double TempoDetector::combScore(const float* env, int n, double last, double step, int spread) const
+{
+    double sum = 0.0;
+    for (double at = last; at >= spread; at -= step) {
+        const int i = int(std::lround(at));
+        for (int k = std::max(0, i - spread); k <= std::min(n - 1, i + spread); ++k)
+            sum += env[k];
+    }
+    return sum;
+}
+
+void TempoDetector::update()
+{
+    const int    n   = std::min(int(m_envelope.size()), m_window);
+    const float* env = m_envelope.data() + m_envelope.size() - size_t(n);
+    const int64_t lastPos = m_nextPos - m_hopFrames;   // position of env[n - 1]
+
+    // Smoothed over five hops, so a beat period that falls between two lags
+    // still lines its peaks up, then centred.
+    float* c = m_centered.data();
+    double mean = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const auto at = [&](int k) { return k >= 0 && k < n ? env[k] : 0.0f; };
+        c[i] = (at(i - 2) + 2.0f * at(i - 1) + 3.0f * env[i] + 2.0f * at(i + 1) + at(i + 2)) / 9.0f;
+        mean += c[i];
+    }
+    mean /= n;
+    for (int i = 0; i < n; ++i) c[i] -= float(mean);
+
+    const double r0 = double(m_kernel->dot(c, c, n)) / n;
+    const int lastLag = std::min(2 * m_maxLag + 1, n * 3 / 4);
+    if (r0 <= 1e-9 || lastLag <= m_minLag + 1) {
+        m_estimate.confidence = 0.0;
+        m_estimate.stable     = false;
+        m_history.clear();
+        return;
+    }
+    // Unbiased, so a lag is not favoured for being short.
+    for (int lag = m_minLag - 1; lag <= lastLag; ++lag)
+        m_acf[size_t(lag)] = float(m_kernel->dot(c, c + lag, n - lag) / ((n - lag) * r0));
+
+    auto score = [&](int lag) {
+        const double bpm    = 60.0 * m_hopRate / lag;
+        const double octave = std::log2(bpm / kPreferredBpm) / kPreferenceOctaves;
+        double s = m_acf[size_t(lag)];
+        if (2 * lag + 1 <= lastLag)
+            s += 0.5 * std::max({m_acf[size_t(2 * lag - 1)], m_acf[size_t(2 * lag)], m_acf[size_t(2 * lag + 1)]});
+        return s * std::exp(-0.5 * octave * octave);
+    };
+    int    best      = -1;
+    double bestScore = 0.0;
+    for (int lag = m_minLag; lag <= std::min(m_maxLag, lastLag - 1); ++lag) {
+        const double s = score(lag);
+        if (best < 0 || s > bestScore) { best = lag; bestScore = s; }
+    }
+    if (best < 0 || bestScore <= 0.0) {
+        m_estimate.confidence = 0.0;
+        m_estimate.stable     = false;
+        m_history.clear();
+        return;
+    }
+
+    // Parabola through the winner and its neighbours.
+    double period = best;
+    if (best > m_minLag && best < std::min(m_maxLag, lastLag - 1)) {
+        const double a = score(best - 1), b = bestScore, d = score(best + 1);
+        const double den = a - 2.0 * b + d;
+        if (den < 0.0)
+            period += std::clamp(0.5 * (a - d) / den, -0.5, 0.5);
+    }
+
+    // Beat phase, with the period refined alongside it: the comb across the
+    // window that lines up with the most onset energy.  An attack's rise is
+    // often split over two hops, hence the spread.
+    const double lagPeriod = period;
+    double lastBeat  = n - 1;
+    double bestComb  = -1.0;
+    for (int k = -kRefineSteps; k <= kRefineSteps; ++k) {
+        const double p = lagPeriod * (1.0 + k * kRefineStep);
+        for (int off = 0; off < int(std::ceil(p)); ++off) {
+            const double s = combScore(env, n, n - 1 - off, p, 2);
+            if (s > bestComb) { bestComb = s; period = p; lastBeat = n - 1 - off; }
+        }
+    }
+    // Then the newest beat goes on the single hop that rises most across it.
+    const double coarse = lastBeat;
+    bestComb = -1.0;
+    for (int d = -2; d <= 2; ++d) {
+        if (coarse + d > n - 1) break;
+        const double s = combScore(env, n, coarse + d, period, 0);
+        if (s > bestComb) { bestComb = s; lastBeat = coarse + d; }
+    }
+    // Downbeat: the strongest beat of the bar.
+    int    downbeat      = 0;
+    double downbeatScore = -1.0;
+    for (int b = 0; b < m_beatsPerBar; ++b) {
+        const double s = combScore(env, n, lastBeat - b * period, period * m_beatsPerBar, 2);
+        if (s > downbeatScore) { downbeat = b; downbeatScore = s; }
+    }
+
+    const double bpm = 60.0 * m_hopRate / period;
+    m_history.push_back(bpm);
+    if (int(m_history.size()) > kStableUpdates)
+        m_history.erase(m_history.begin());
+
+    m_estimate.bpm         = bpm;
+    m_estimate.confidence  = std::clamp(double(m_acf[size_t(best)]), 0.0, 1.0);
+    // The attack is somewhere in its hop; call it the middle.
+    m_estimate.beatPos     = lastPos - int64_t(std::lround((n - 1 - lastBeat) * m_hopFrames)) + m_hopFrames / 2;
+    m_estimate.downbeatPos = m_estimate.beatPos - int64_t(std::lround(downbeat * period * m_hopFrames));
+    m_estimate.beatNs      = 0;
+    m_estimate.downbeatNs  = 0;
+    m_estimate.stable = int(m_history.size()) == kStableUpdates && m_estimate.confidence >= kMinConfidence
+        && std::all_of(m_history.begin(), m_history.end(),
+                       [bpm](double h) { return std::fabs(h - bpm) <= kStableTolerance * bpm; });
+}
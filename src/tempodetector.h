@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "mixkernel.h"
+
+// What TempoDetector hears in the input.  Positions are on the input
+// timeline; the *Ns fields are steady_clock times, filled in by whoever knows
+// when the input was captured (0 = unknown).
+struct TempoEstimate {
+    double  bpm         = 0.0;   // 0 = nothing yet
+    double  confidence  = 0.0;   // 0..1: how periodic the onset envelope is
+    bool    stable      = false; // held within kStableTolerance for kStableUpdates
+    int64_t beatPos     = -1;    // the most recent beat
+    int64_t downbeatPos = -1;    // the most recent first beat of a bar
+    int64_t beatNs      = 0;
+    int64_t downbeatNs  = 0;
+};
+
+// ---------------------------------------------------------------------------
+// TempoDetector: streaming tempo and beat phase from an onset envelope.
+//
+// It is fed the hop levels an OnsetDetector measures; their half-wave
+// rectified rise is the onset envelope, kept for the last kWindowSeconds.
+// Every kUpdateSeconds the envelope's autocorrelation is taken (one
+// MixKernel::dot per lag, so the cost per update is fixed by the window) and
+// each beat period between kMinBpm and kMaxBpm is scored on its own lag and
+// twice its lag, weighted by a log-normal preference around kPreferredBpm:
+// an even pulse correlates as well at two beats as at one, so the preference
+// is what settles its octave (quarters read as such up to about 170 BPM,
+// eighths from about 85).  The winning lag is interpolated between its
+// neighbours.  A comb over the window then finds the beat phase, and the
+// strongest of beatsPerBar beats is taken as the downbeat.
+//
+// Hops must be contiguous; a gap restarts the estimate.  Not thread-safe;
+// meant for a worker thread.
+// ---------------------------------------------------------------------------
+class TempoDetector {
+public:
+    static constexpr double kMinBpm          = 40.0;
+    static constexpr double kMaxBpm          = 240.0;
+    static constexpr double kPreferredBpm    = 120.0;
+    static constexpr double kWindowSeconds   = 8.0;
+    static constexpr double kFirstSeconds    = 2.5;    // envelope needed before the first estimate
+    static constexpr double kUpdateSeconds   = 0.25;
+    static constexpr double kStableTolerance = 0.02;
+    static constexpr int    kStableUpdates   = 6;
+    static constexpr double kMinConfidence   = 0.15;
+
+    TempoDetector(int hopFrames = 128, int sampleRate = 48000, const MixKernel& kernel = bestMixKernel());
+
+    void setBeatsPerBar(int beats) { m_beatsPerBar = beats > 0 ? beats : 1; }
+    // One hop of the envelope; true when the estimate was updated.
+    bool addHop(int64_t samplePos, float levelDb);
+    const TempoEstimate& estimate() const { return m_estimate; }
+    void reset();
+
+    int sampleRate() const { return m_sampleRate; }
+    int hopFrames() const  { return m_hopFrames; }
+
+private:
+    void update();
+    double combScore(const float* env, int n, double last, double step, int spread) const;
+
+    const MixKernel* m_kernel;
+    int     m_hopFrames;
+    int     m_sampleRate;
+    double  m_hopRate;           // envelope samples per second
+    int     m_window;            // envelope samples kept
+    int     m_updateHops;
+    int     m_minLag, m_maxLag;
+
+    std::vector<float> m_envelope;   // oldest first; trimmed to m_window in place
+    std::vector<float> m_centered;   // scratch: the envelope less its mean
+    std::vector<float> m_acf;        // scratch, by lag
+    int64_t m_nextPos   = -1;        // where the next hop should start
+    float   m_lastDb    = 0.0f;
+    int     m_sinceUpdate = 0;
+    int     m_beatsPerBar = 4;
+    std::vector<double> m_history;   // recent estimates, for stability
+    TempoEstimate m_estimate;
+};
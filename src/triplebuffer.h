@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+// ---------------------------------------------------------------------------
+// TripleBuffer: wait-free single-reader snapshot publication.
+//
+// One slot belongs to the writer, one to the reader, and the third sits in the
+// middle.  publish() swaps the writer's slot with the middle one and marks it
+// fresh; update() swaps the reader's slot with the middle one only if it is
+// fresh.  Neither side ever waits for the other, so the audio thread can pick
+// up new parameters without taking a lock.
+//
+// Writers must be serialised by the caller (one writer at a time); the reader
+// must be a single thread.  All copying of T happens on the writer side.
+// ---------------------------------------------------------------------------
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // ── Writer side ───────────────────────────────────────────────────────
+    T& writeSlot() { return m_slots[m_writeIdx]; }
+
+    void publish() {
+        int prev   = m_middle.exchange(m_writeIdx | kFreshBit, std::memory_order_acq_rel);
+        m_writeIdx = prev & kIndexMask;
+    }
+
+    void publish(const T& value) {
+        writeSlot() = value;
+        publish();
+    }
+
+    // ── Reader side ───────────────────────────────────────────────────────
+    // Returns true if a newer snapshot was picked up.
+    bool update() {
+        if (!(m_middle.load(std::memory_order_relaxed) & kFreshBit))
+            return false;
+        int prev  = m_middle.exchange(m_readIdx, std::memory_order_acq_rel);
+        m_readIdx = prev & kIndexMask;
+        return true;
+    }
+
+    // Stable until the reader calls update() again.
+    const T& read() const { return m_slots[m_readIdx]; }
+
+private:
+    static constexpr int kIndexMask = 0x3;
+    static constexpr int kFreshBit  = 0x4;
+
+    T m_slots[3];
+    std::atomic<int> m_middle{1};
+    int m_writeIdx = 0;   // writer-owned
+    int m_readIdx  = 2;   // reader-owned
+};
@@ -0,0 +1,190 @@
+#include "voicepool.h"
+#include <algorithm>
+
+void VoicePool::setPolyphony(int voices)
+{
+    m_polyphony.store(std::clamp(voices, 1, kMaxPolyphony), std::memory_order_relaxed);
+}
+
+int VoicePool::worstCaseVoices() const
+{
+    return std::min(kSlotCount, 2 * polyphony());
+}
+
+void VoicePool::resetStats()
+{
+    m_peakVoices.store(0, std::memory_order_relaxed);
+    m_stolen.store(0, std::memory_order_relaxed);
+    m_choked.store(0, std::memory_order_relaxed);
+    m_hardCut.store(0, std::memory_order_relaxed);
+}
+
+void VoicePool::clear()
+{
+    for (Voice& v : m_voices)
+        v.active = false;
+    m_activeCount = 0;
+}
+
+void VoicePool::retune(double factor)
+{
+    for (Voice& v : m_voices)
+        if (v.active)
+            v.step = std::clamp(v.step * factor, kMinRateStep, kMaxRateStep);
+}
+
+void VoicePool::release(Voice& v, int atFrame)
+{
+    if (v.releaseAt >= 0) return;           // already fading out
+    v.releaseAt = std::max(atFrame, v.outPos);
+    v.fadeLeft  = kReleaseFadeFrames;
+}
+
+void VoicePool::retire(Voice& v)
+{
+    v.active = false;
+    --m_activeCount;
+}
+
+void VoicePool::trigger(const float* data, int length, int startPos, int outPos,
+                        float gain, int chokeGroup, double rateStep,
+                        const float* channelGains)
+{
+    if (!data || startPos >= length) return;
+
+    // Choke: an incoming voice releases every sounding voice in its group.
+    int sounding = 0;
+    Voice* oldestSounding = nullptr;
+    for (Voice& v : m_voices) {
+        if (!v.active || v.releaseAt >= 0) continue;
+        if (chokeGroup != 0 && v.chokeGroup == chokeGroup) {
+            release(v, outPos);
+            m_choked.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        ++sounding;
+        if (!oldestSounding || v.serial < oldestSounding->serial)
+            oldestSounding = &v;
+    }
+
+    // Steal: keep the number of sounding voices within the polyphony cap.
+    if (sounding >= polyphony() && oldestSounding) {
+        release(*oldestSounding, outPos);
+        m_stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Find a free slot; if every slot is still fading, cut the oldest outright.
+    Voice* slot = nullptr;
+    for (Voice& v : m_voices) {
+        if (!v.active) { slot = &v; break; }
+    }
+    if (!slot) {
+        for (Voice& v : m_voices) {
+            if (!slot || v.serial < slot->serial)
+                slot = &v;
+        }
+        retire(*slot);
+        m_hardCut.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    slot->data       = data;
+    slot->length     = length;
+    slot->pos        = startPos;
+    slot->outPos     = outPos;
+    for (int c = 0; c < kMaxChannels; ++c)
+        slot->gains[c] = channelGains ? gain * channelGains[c] : gain;
+    slot->chokeGroup = chokeGroup;
+    slot->releaseAt  = -1;
+    slot->fadeLeft   = 0;
+    slot->step       = std::clamp(rateStep, kMinRateStep, kMaxRateStep);
+    slot->frac       = 0.0;
+    slot->serial     = m_nextSerial++;
+    slot->active     = true;
+    ++m_activeCount;
+
+    if (m_activeCount > m_peakVoices.load(std::memory_order_relaxed))
+        m_peakVoices.store(m_activeCount, std::memory_order_relaxed);
+}
+
+void VoicePool::mix(float* out, int frames, int channels)
+{
+    if (m_activeCount == 0) return;
+    channels = std::clamp(channels, 1, kMaxChannels);
+
+    for (Voice& v : m_voices) {
+        if (!v.active) continue;
+        if (v.step != 1.0) {
+            mixInterpolated(v, out, frames, channels);
+            continue;
+        }
+
+        int frame = v.outPos;
+        // Full-gain part: up to the release point (or the end of the buffer).
+        int sustainEnd = (v.releaseAt >= 0) ? std::min(v.releaseAt, frames) : frames;
+        int n = std::min(sustainEnd - frame, v.length - v.pos);
+        if (n > 0) {
+            m_kernel->addInterleaved(out + size_t(frame) * size_t(channels), v.data + v.pos,
+                                     v.gains, channels, n);
+            v.pos += n;
+            frame += n;
+        }
+
+        // Release fade: linear ramp to silence over kReleaseFadeFrames.
+        if (v.releaseAt >= 0 && frame >= v.releaseAt) {
+            float step[kMaxChannels];
+            for (int c = 0; c < channels; ++c)
+                step[c] = v.gains[c] / float(kReleaseFadeFrames);
+            while (frame < frames && v.fadeLeft > 0 && v.pos < v.length) {
+                const float s = v.data[v.pos++];
+                float* o = out + size_t(frame++) * size_t(channels);
+                for (int c = 0; c < channels; ++c)
+                    o[c] += s * step[c] * float(v.fadeLeft);
+                --v.fadeLeft;
+            }
+            if (v.fadeLeft <= 0) {
+                retire(v);
+                continue;
+            }
+            v.releaseAt = 0;   // fade continues from the top of the next buffer
+        }
+
+        if (v.pos >= v.length) {
+            retire(v);
+            continue;
+        }
+        v.outPos = 0;
+    }
+}
+
+// Same sustain / release logic as mix(), one frame at a time, reading the
+// sample at v.step source samples per frame.
+void VoicePool::mixInterpolated(Voice& v, float* out, int frames, int channels)
+{
+    float fadeStep[kMaxChannels];
+    for (int c = 0; c < channels; ++c)
+        fadeStep[c] = v.gains[c] / float(kReleaseFadeFrames);
+    int frame = v.outPos;
+    while (frame < frames && v.pos < v.length) {
+        const bool fading = v.releaseAt >= 0 && frame >= v.releaseAt;
+        if (fading && v.fadeLeft <= 0) break;
+        const float fade = fading ? float(v.fadeLeft--) : 0.0f;
+        const float a = v.data[v.pos];
+        const float b = v.pos + 1 < v.length ? v.data[v.pos + 1] : 0.0f;
+        const float s = a + (b - a) * float(v.frac);
+        float* o = out + size_t(frame++) * size_t(channels);
+        for (int c = 0; c < channels; ++c)
+            o[c] += s * (fading ? fadeStep[c] * fade : v.gains[c]);
+        v.frac += v.step;
+        const int whole = int(v.frac);
+        v.pos  += whole;
+        v.frac -= whole;
+    }
+
+    if (v.pos >= v.length || (v.releaseAt >= 0 && v.fadeLeft <= 0)) {
+        retire(v);
+        return;
+    }
+    if (v.releaseAt >= 0)
+        v.releaseAt = 0;
+    v.outPos = 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "mixkernel.h"
+
+// ---------------------------------------------------------------------------
+// VoicePool: fixed-capacity sample playback for the audio callback.
+//
+// All voices live in a preallocated array, so triggering and mixing never
+// allocate and the per-callback cost has a fixed upper bound.  The number of
+// voices that may sound at once is capped by the polyphony setting; when the
+// cap is hit, the oldest sounding voice is released with a short fade (voice
+// stealing).  A voice started with a non-zero choke group releases every
+// other voice in the same group, so an accent retrigger cuts its own tail.
+//
+// Released voices keep their slot until the fade finishes, which is why the
+// slot count is twice the polyphony cap.  The worst-case mix cost of one
+// callback is therefore worstCaseVoices() × frames × channels multiply-adds.
+//
+// The sustain part of each voice goes through the SIMD kernel chosen by
+// bestMixKernel() when the pool is constructed.  A voice whose sample was
+// prepared for another rate (between a device rate change and the reload
+// that follows it) is read at a fractional step with linear interpolation
+// instead; that path is scalar and only meant to bridge the gap.
+//
+// The mix may be interleaved over up to kMaxChannels output channels.  Each
+// voice carries its own gain per channel, fixed when it is triggered, so one
+// pass of MixKernel::addInterleaved places it wherever it was routed.
+//
+// trigger()/mix()/clear() are audio-thread only; the setters and counters
+// may be used from any thread.
+// ---------------------------------------------------------------------------
+class VoicePool {
+public:
+    static constexpr int kMaxPolyphony     = 32;
+    static constexpr int kSlotCount        = 2 * kMaxPolyphony;
+    static constexpr int kDefaultPolyphony = 16;
+    static constexpr int kMaxChannels      = 8;
+    static constexpr int kReleaseFadeFrames = 64;   // ~1.3 ms at 48 kHz
+    static constexpr double kMinRateStep    = 0.25;  // slowest playback of a mismatched sample
+    static constexpr double kMaxRateStep    = 4.0;
+
+    VoicePool() : m_kernel(&bestMixKernel()) {}
+
+    // Not thread-safe against mix(); for benchmarks and diagnostics.
+    void setMixKernel(const MixKernel& kernel) { m_kernel = &kernel; }
+    const MixKernel& mixKernel() const { return *m_kernel; }
+
+    // ── Any thread ────────────────────────────────────────────────────────
+    void setPolyphony(int voices);
+    int  polyphony() const { return m_polyphony.load(std::memory_order_relaxed); }
+    int  worstCaseVoices() const;
+
+    int      peakVoices() const    { return m_peakVoices.load(std::memory_order_relaxed); }
+    uint64_t stolenVoices() const  { return m_stolen.load(std::memory_order_relaxed); }
+    uint64_t chokedVoices() const  { return m_choked.load(std::memory_order_relaxed); }
+    uint64_t hardCutVoices() const { return m_hardCut.load(std::memory_order_relaxed); }
+    void     resetStats();
+
+    // ── Audio thread ──────────────────────────────────────────────────────
+    // Start playing data[startPos..length) at frame outPos of the current buffer.
+    // rateStep is source samples per output frame: the sample's rate over the
+    // device rate, 1.0 when they match.  channelGains, if given, holds
+    // kMaxChannels multipliers of gain, one per output channel; without it
+    // the voice plays at gain on every channel.
+    void trigger(const float* data, int length, int startPos, int outPos,
+                 float gain, int chokeGroup, double rateStep = 1.0,
+                 const float* channelGains = nullptr);
+
+    // Add all voices into out[0..frames * channels), interleaved, and advance
+    // them by one buffer.
+    void mix(float* out, int frames, int channels = 1);
+
+    // The device rate changed: scale every voice's step by oldRate / newRate
+    // so what is already sounding keeps its pitch.
+    void retune(double factor);
+
+    void clear();
+    int  activeVoices() const { return m_activeCount; }
+
+private:
+    struct Voice {
+        const float* data  = nullptr;
+        int      length    = 0;
+        int      pos       = 0;      // next sample to read
+        int      outPos    = 0;      // first output frame to write in the current buffer
+        float    gains[kMaxChannels] = {};   // per output channel
+        int      chokeGroup = 0;
+        int      releaseAt = -1;     // output frame where the release fade begins (-1 = sounding)
+        int      fadeLeft  = 0;      // release fade frames remaining
+        double   step      = 1.0;    // source samples per output frame
+        double   frac      = 0.0;    // position between pos and pos + 1 when step != 1
+        uint64_t serial    = 0;      // start order, for oldest-first stealing
+        bool     active    = false;
+    };
+
+    void release(Voice& v, int atFrame);
+    void retire(Voice& v);
+    void mixInterpolated(Voice& v, float* out, int frames, int channels);
+
+    const MixKernel* m_kernel;
+    Voice    m_voices[kSlotCount];
+    int      m_activeCount = 0;
+    uint64_t m_nextSerial  = 0;
+
+    std::atomic<int>      m_polyphony{kDefaultPolyphony};
+    std::atomic<int>      m_peakVoices{0};
+    std::atomic<uint64_t> m_stolen{0};
+    std::atomic<uint64_t> m_choked{0};
+    std::atomic<uint64_t> m_hardCut{0};
+};